@@ -173,7 +173,7 @@ class DiscoveryCommand(BaseCommand):
         if len(words) > 1 and (words[-2] == '--plugins' or words[-2] == '-p'):
             # We're completing plugin names
             # This would be populated from actual plugins in a real implementation
-            plugins = ['disk_space', 'mount_points']
+            plugins = ['disk_space', 'logger_processes', 'mount_points']
             
             for plugin in plugins:
                 if plugin.startswith(last_word):
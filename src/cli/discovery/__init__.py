@@ -8,12 +8,14 @@ information about target systems.
 from .base import DiscoveryPlugin
 from .coordinator import DiscoveryCoordinator
 from .disk_space import DiskSpaceDiscovery
+from .logger_processes import LoggerProcessesDiscovery
 from .mount_points import MountPointsDiscovery
 
 __all__ = [
     'DiscoveryPlugin',
     'DiscoveryCoordinator',
     'DiskSpaceDiscovery',
+    'LoggerProcessesDiscovery',
     'MountPointsDiscovery'
 ]
 
@@ -28,5 +30,6 @@ def register_plugins():
     """
     return [
         DiskSpaceDiscovery(),
+        LoggerProcessesDiscovery(),
         MountPointsDiscovery()
     ]
\ No newline at end of file
@@ -1,52 +1,106 @@
 """
 Disk space discovery plugin.
 """
+import json
+import os
+import shlex
 from typing import Dict, Any, List, Optional, Set
 
-from .base import DiscoveryPlugin
+from .base import DiscoveryPlugin, DiscoveryError
+from .probe import run_command, run_probe
+
+
+# Runs on the target system under python3. Takes a JSON list of paths and
+# prints, for each, the mount point it lives on and that filesystem's size,
+# used and available bytes (as df reports them for an unprivileged user).
+PROBE_SCRIPT = r'''
+import json, os, sys
+
+result = {}
+for path in json.loads(sys.argv[1]):
+    try:
+        mount = os.path.realpath(path)
+        while not os.path.ismount(mount):
+            mount = os.path.dirname(mount)
+        st = os.statvfs(mount)
+    except OSError as e:
+        result[path] = {"error": str(e)}
+        continue
+    result[path] = {
+        "mount": mount,
+        "total": st.f_blocks * st.f_frsize,
+        "used": (st.f_blocks - st.f_bfree) * st.f_frsize,
+        "avail": st.f_bavail * st.f_frsize,
+    }
+print(json.dumps(result))
+'''
+
+GB = 1 << 30
 
 
 class DiskSpaceDiscovery(DiscoveryPlugin):
     """
     Discovery plugin for disk space information.
+
+    Besides static usage, it forecasts when each mount fills up from the
+    write rates of the loggers writing there (found by logger_processes).
+    A mount that fills within the global setting disk_full_horizon_seconds
+    (default 6 hours) gets its hottest log files planned for a hotswap to
+    the local mount with the most headroom, until the rest of its writers
+    last past the horizon. The plan is stored in the log_relocation_needed
+    role. With disk_forecast_auto_hotswap set it is also carried out with
+    hotswap_command (default "hotswap").
     """
-    
+
+    DEFAULT_HORIZON_SECONDS = 6 * 3600
+    DEFAULT_RELOCATION_DIR = "hotswap-logs"
+
     def get_name(self) -> str:
         return "disk_space"
-    
+
     def get_description(self) -> str:
-        return "Discovers disk space usage on target systems"
-    
+        return "Discovers disk space usage on target systems and forecasts when log writers fill it"
+
     def get_dependencies(self) -> List[str]:
-        # This discovery depends on mount points being discovered first
-        return ["mount_points"]
-    
+        # This discovery depends on mount points being discovered first, and
+        # uses the logger write rates when they have been discovered too
+        return ["mount_points", "logger_processes"]
+
     def get_tags_added(self) -> Set[str]:
-        return {"low_disk_space", "high_disk_space"}
-    
+        return {"low_disk_space", "healthy_disk_space", "disk_filling"}
+
     def get_roles_added(self) -> Set[str]:
-        return {"disk_cleanup_needed"}
-    
+        return {"disk_cleanup_needed", "log_relocation_needed"}
+
     def get_properties_added(self) -> Set[str]:
-        return {"disk_usage", "disk_free", "disk_total"}
-    
+        return {"disk_usage", "disk_free", "disk_total", "disk_forecast"}
+
     def discover(self, config_store, system_names: Optional[List[str]] = None) -> Dict[str, Any]:
         """
         Discover disk space information.
-        
+
         Args:
             config_store: The configuration store to update
             system_names: Optional list of system names to limit discovery to
-            
+
         Returns:
             Dictionary with discovery results
         """
         results = {
             "systems_checked": 0,
             "systems_updated": 0,
-            "low_disk_space_found": 0
+            "low_disk_space_found": 0,
+            "filling_mounts_found": 0,
+            "relocations_planned": 0,
+            "relocations_triggered": 0
         }
-        
+
+        horizon = float(config_store.get_global_setting("disk_full_horizon_seconds",
+                                                        self.DEFAULT_HORIZON_SECONDS))
+        relocation_dir = config_store.get_global_setting("log_relocation_dir", self.DEFAULT_RELOCATION_DIR)
+        auto_hotswap = config_store.get_global_setting("disk_forecast_auto_hotswap", False)
+        hotswap_command = config_store.get_global_setting("hotswap_command", "hotswap")
+
         # Get systems to check
         systems = []
         if system_names:
@@ -58,68 +112,186 @@ class DiskSpaceDiscovery(DiscoveryPlugin):
         else:
             # Check all systems
             systems = config_store.list_systems()
-        
+
         results["systems_checked"] = len(systems)
-        
+
         # Check each system
         for system in systems:
-            # In a real implementation, this would connect to the system and check disk space
-            # For now, we'll simulate some discovery
-            
             try:
-                # First, check if we're connected or can connect
-                if not system.is_connected():
-                    agent = system.connect()
-                else:
-                    agent = system.endpoint.agent
-                
-                # This would normally execute df command or similar
-                # Here we'll just simulate disk usage for demonstration
-                
                 # Get mount points (should have been discovered by MountPointsDiscovery)
                 mount_points = system.get_property("mount_points", [])
-                
+                nfs_mounts = set(system.get_property("nfs_mounts", []))
+                loggers = system.get_property("loggers", [])
+
+                # Each logger's rate is charged to the mount of its log file
+                log_paths = {}
+                for logger in loggers:
+                    path = logger.get("log_path")
+                    if path not in logger.get("files", []) and logger.get("files"):
+                        path = logger["files"][0]
+                    if path:
+                        log_paths[logger["pid"]] = path
+
+                usage = self.probe(system, list(mount_points) + sorted(set(log_paths.values())))
+
                 disk_usage = {}
-                low_space_detected = False
-                
-                for mount in mount_points:
-                    # Simulate getting disk usage
-                    total = 100  # GB
-                    used = total * 0.75  # 75% used
-                    free = total - used
-                    
-                    disk_usage[mount] = {
-                        "total_gb": total,
-                        "used_gb": used,
-                        "free_gb": free,
-                        "percent_used": used / total * 100
+                for info in usage.values():
+                    if "mount" not in info or info["mount"] in disk_usage:
+                        continue
+                    total = info["total"]
+                    disk_usage[info["mount"]] = {
+                        "total_gb": total / GB,
+                        "used_gb": info["used"] / GB,
+                        "free_gb": info["avail"] / GB,
+                        "percent_used": info["used"] / total * 100 if total else 0.0,
+                        "avail_bytes": info["avail"],
+                        "log_write_bytes_per_sec": 0.0,
+                        "seconds_to_full": None
                     }
-                    
-                    # Check for low disk space
-                    if used / total > 0.9:  # 90% used
-                        low_space_detected = True
-                
+
+                writers = {}
+                for logger in loggers:
+                    info = usage.get(log_paths.get(logger["pid"]), {})
+                    if "mount" in info:
+                        writers.setdefault(info["mount"], []).append(logger)
+                        disk_usage[info["mount"]]["log_write_bytes_per_sec"] += logger.get("write_bytes_per_sec", 0)
+
+                for mount, info in disk_usage.items():
+                    info["seconds_to_full"] = self.time_to_full(info["avail_bytes"], info["log_write_bytes_per_sec"])
+
+                moves = self.plan_relocations(disk_usage, writers, log_paths, nfs_mounts, horizon, relocation_dir)
+                for move in moves:
+                    move["command"] = " ".join(shlex.quote(arg) for arg in self.hotswap_argv(hotswap_command, move))
+                    if auto_hotswap:
+                        move["output"] = run_command(system, self.hotswap_argv(hotswap_command, move)).strip()
+                        results["relocations_triggered"] += 1
+
                 # Update system properties
                 system.add_property("disk_usage", disk_usage)
                 system.add_property("disk_free", sum(info["free_gb"] for info in disk_usage.values()))
                 system.add_property("disk_total", sum(info["total_gb"] for info in disk_usage.values()))
-                
+                system.add_property("disk_forecast", moves)
+
+                # Tags and roles reflect this run only
+                for tag in self.get_tags_added():
+                    system.remove_tag(tag)
+                for role in self.get_roles_added():
+                    system.remove_role(role)
+
+                low_space_detected = any(info["percent_used"] > 90 for info in disk_usage.values())
+                filling = [mount for mount, info in disk_usage.items()
+                           if info["seconds_to_full"] is not None and info["seconds_to_full"] < horizon]
+
                 # Update tags and roles based on findings
                 if low_space_detected:
                     system.add_tag("low_disk_space")
-                    system.add_role("disk_cleanup_needed", 
+                    system.add_role("disk_cleanup_needed",
                                    "System needs disk cleanup due to low disk space")
                     results["low_disk_space_found"] += 1
                 else:
                     system.add_tag("healthy_disk_space")
-                
+
+                if filling:
+                    system.add_tag("disk_filling")
+                    results["filling_mounts_found"] += len(filling)
+                if moves:
+                    role = system.add_role("log_relocation_needed",
+                                           "Log files should be hotswapped before their mount fills up")
+                    role.add_property("moves", moves)
+                    results["relocations_planned"] += len(moves)
+
                 results["systems_updated"] += 1
-                
+
             except Exception as e:
                 # Log the error but continue with other systems
                 results.setdefault("errors", []).append({
                     "system": system.name,
                     "error": str(e)
                 })
-        
-        return results
\ No newline at end of file
+
+        return results
+
+    def probe(self, system, paths: List[str]) -> Dict[str, Dict[str, Any]]:
+        """
+        Measure the filesystems holding paths on a system.
+
+        Args:
+            system: The system to probe
+            paths: Mount points and files to measure
+
+        Returns:
+            Dictionary of path -> mount, total, used and avail bytes (or error)
+
+        Raises:
+            DiscoveryError: If the probe produced no usable output
+        """
+        usage = run_probe(system, PROBE_SCRIPT, [json.dumps(paths)])
+        if not isinstance(usage, dict):
+            raise DiscoveryError(f"unexpected disk probe output from {system.endpoint.hostname}")
+        return usage
+
+    @staticmethod
+    def time_to_full(avail_bytes: float, bytes_per_sec: float) -> Optional[float]:
+        """
+        Seconds until a mount fills at a write rate, or None if it does not grow.
+        """
+        if bytes_per_sec <= 0:
+            return None
+        return avail_bytes / bytes_per_sec
+
+    def plan_relocations(self, disk_usage: Dict[str, Dict[str, Any]], writers: Dict[str, List[Dict[str, Any]]],
+                         log_paths: Dict[int, str], nfs_mounts: Set[str], horizon: float,
+                         relocation_dir: str) -> List[Dict[str, Any]]:
+        """
+        Plan hotswaps that keep every mount from filling within the horizon.
+
+        The hottest writers of a filling mount move first, each to the local
+        mount that would still last longest with it, as long as that mount
+        then lasts past the horizon itself.
+
+        Returns:
+            One dictionary per planned move
+        """
+        rates = {mount: info["log_write_bytes_per_sec"] for mount, info in disk_usage.items()}
+        moves = []
+        filling = sorted((mount for mount, info in disk_usage.items()
+                          if info["seconds_to_full"] is not None and info["seconds_to_full"] < horizon),
+                         key=lambda mount: disk_usage[mount]["seconds_to_full"])
+        for mount in filling:
+            hottest = sorted(writers.get(mount, []), key=lambda logger: logger.get("write_bytes_per_sec", 0),
+                             reverse=True)
+            for logger in hottest:
+                left = self.time_to_full(disk_usage[mount]["avail_bytes"], rates[mount])
+                if left is None or left >= horizon:
+                    break
+                rate = logger.get("write_bytes_per_sec", 0)
+                best, best_left = None, horizon
+                for target, info in disk_usage.items():
+                    if target == mount or target in nfs_mounts:
+                        continue
+                    target_left = self.time_to_full(info["avail_bytes"], rates[target] + rate)
+                    if target_left is not None and target_left >= best_left:
+                        best, best_left = target, target_left
+                if best is None:
+                    continue
+                rates[mount] -= rate
+                rates[best] += rate
+                source = log_paths[logger["pid"]]
+                moves.append({
+                    "pid": logger["pid"],
+                    "file": source,
+                    "from_mount": mount,
+                    "to_mount": best,
+                    "to": os.path.join(best, relocation_dir, os.path.basename(source)),
+                    "write_bytes_per_sec": rate,
+                    "seconds_to_full": disk_usage[mount]["seconds_to_full"],
+                    "target_seconds_to_full": best_left
+                })
+        return moves
+
+    @staticmethod
+    def hotswap_argv(hotswap_command: str, move: Dict[str, Any]) -> List[str]:
+        """
+        Command line of the hotswap that carries out a planned move.
+        """
+        return shlex.split(hotswap_command) + ["--pid", str(move["pid"]), "--from", move["file"], "--to", move["to"]]
@@ -0,0 +1,275 @@
+"""
+Logger processes discovery plugin.
+"""
+from typing import Dict, Any, List, Optional, Set
+
+from .base import DiscoveryPlugin, DiscoveryError
+from .probe import run_probe
+
+
+# Runs on the target system under python3. Finds ThreadedLogger and
+# threaded_logger processes with the files they write, samples /proc/PID/io
+# and the stats of their control sockets twice, argv[1] seconds apart, and
+# prints one JSON list with a rate for every counter.
+PROBE_SCRIPT = r'''
+import json, os, socket, sys, time
+
+NAMES = ("ThreadedLogger", "threaded_logger")
+
+def read(path):
+    try:
+        with open(path, "rb") as f:
+            return f.read()
+    except OSError:
+        return b""
+
+def stats(path):
+    if not path:
+        return None
+    data = b""
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+            s.settimeout(2)
+            s.connect(path)
+            s.sendall(b"stats\n")
+            s.shutdown(socket.SHUT_WR)
+            while True:
+                chunk = s.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+    except OSError:
+        return None
+    values = {}
+    for line in data.decode(errors="replace").splitlines():
+        key, eq, value = line.partition("=")
+        if eq:
+            values[key] = value
+    return values
+
+def written_files(pid):
+    files = []
+    fd_dir = "/proc/%d/fd" % pid
+    try:
+        fds = os.listdir(fd_dir)
+    except OSError:
+        return files
+    for fd in fds:
+        try:
+            target = os.readlink(os.path.join(fd_dir, fd))
+            flags = int(read("/proc/%d/fdinfo/%s" % (pid, fd)).split(b"flags:")[1].split()[0], 8)
+        except (OSError, IndexError, ValueError):
+            continue
+        if target.startswith("/") and flags & 3 and os.path.isfile(os.path.join(fd_dir, fd)):
+            files.append(target)
+    return sorted(set(files))
+
+def sample(logger):
+    io = {}
+    for line in read("/proc/%d/io" % logger["pid"]).decode().splitlines():
+        key, _, value = line.partition(":")
+        io[key] = int(value or 0)
+    return time.monotonic(), io.get("wchar"), stats(logger["control"])
+
+loggers = []
+for entry in os.listdir("/proc"):
+    if not entry.isdigit():
+        continue
+    pid = int(entry)
+    name = read("/proc/%d/comm" % pid).decode(errors="replace").strip()
+    if not name.startswith(NAMES):
+        continue
+    argv = [a.decode(errors="replace") for a in read("/proc/%d/cmdline" % pid).split(b"\0")[:-1]]
+    cwd = ""
+    try:
+        cwd = os.readlink("/proc/%d/cwd" % pid)
+    except OSError:
+        pass
+    control = next((a.split("=", 1)[1] for a in argv if a.startswith("--control=")), None)
+    if control:
+        control = os.path.join(cwd, control)
+    loggers.append({
+        "pid": pid,
+        "name": name,
+        "cmdline": argv,
+        "log_path": os.path.normpath(os.path.join(cwd, argv[1])) if len(argv) > 1 else None,
+        "files": written_files(pid),
+        "control": control,
+    })
+
+seconds = float(sys.argv[1]) if len(sys.argv) > 1 else 1.0
+first = [sample(logger) for logger in loggers]
+time.sleep(seconds)
+for logger, before in zip(loggers, first):
+    after = sample(logger)
+    elapsed = max(after[0] - before[0], 1e-3)
+    if before[1] is not None and after[1] is not None:
+        logger["write_bytes_per_sec"] = (after[1] - before[1]) / elapsed
+    logger["stats_available"] = after[2] is not None
+    if before[2] is not None and after[2] is not None:
+        for key in ("records", "bytes", "dropped", "io.throttled_ms"):
+            try:
+                logger[key.replace("io.", "") + "_per_sec"] = \
+                    (float(after[2][key]) - float(before[2][key])) / elapsed
+            except (KeyError, ValueError):
+                pass
+        for key in ("dropped", "queue_bytes", "peak_queue_bytes", "write_errors"):
+            try:
+                logger[key] = int(after[2][key])
+            except (KeyError, ValueError):
+                pass
+        # Queue memory is held in whole segments, so its growth shows a backlog
+        # better than its size does
+        try:
+            logger["queue_growth_bytes"] = int(after[2]["queue_bytes"]) - int(before[2]["queue_bytes"])
+        except (KeyError, ValueError):
+            pass
+print(json.dumps(loggers))
+'''
+
+class LoggerProcessesDiscovery(DiscoveryPlugin):
+    """
+    Discovery plugin for running loggers, their log files and live throughput.
+
+    A logger is hot when it writes at least the global setting
+    log_hot_bytes_per_sec (default 1 MiB/s), and backpressured when it drops
+    records, its queues grow by log_backpressure_queue_bytes (default 1 MiB)
+    during the sample, or its writer is throttled for half of the sample. Both make the
+    system a hotswap target. Queue and drop figures need the logger's
+    --control socket; without it only the write rate is known.
+    """
+
+    DEFAULT_HOT_BYTES_PER_SEC = 1 << 20
+    DEFAULT_BACKPRESSURE_QUEUE_BYTES = 1 << 20
+    DEFAULT_SAMPLE_SECONDS = 1.0
+    THROTTLED_MS_PER_SEC = 500
+
+    def get_name(self) -> str:
+        return "logger_processes"
+
+    def get_description(self) -> str:
+        return "Discovers running loggers, their log files and live write rates"
+
+    def get_dependencies(self) -> List[str]:
+        # This discovery has no dependencies
+        return []
+
+    def get_tags_added(self) -> Set[str]:
+        return {"log_hot", "log_backpressured"}
+
+    def get_roles_added(self) -> Set[str]:
+        return {"hotswap_target"}
+
+    def get_properties_added(self) -> Set[str]:
+        return {"loggers", "log_files", "log_write_rate"}
+
+    def discover(self, config_store, system_names: Optional[List[str]] = None) -> Dict[str, Any]:
+        """
+        Discover running loggers.
+
+        Args:
+            config_store: The configuration store to update
+            system_names: Optional list of system names to limit discovery to
+
+        Returns:
+            Dictionary with discovery results
+        """
+        results = {
+            "systems_checked": 0,
+            "systems_updated": 0,
+            "loggers_found": 0,
+            "hot_loggers": 0,
+            "backpressured_loggers": 0
+        }
+
+        hot_rate = config_store.get_global_setting("log_hot_bytes_per_sec", self.DEFAULT_HOT_BYTES_PER_SEC)
+        queue_limit = config_store.get_global_setting("log_backpressure_queue_bytes",
+                                                      self.DEFAULT_BACKPRESSURE_QUEUE_BYTES)
+        seconds = config_store.get_global_setting("log_sample_seconds", self.DEFAULT_SAMPLE_SECONDS)
+
+        # Get systems to check
+        systems = []
+        if system_names:
+            # Only check specified systems
+            for name in system_names:
+                system = config_store.get_system(name)
+                if system:
+                    systems.append(system)
+        else:
+            # Check all systems
+            systems = config_store.list_systems()
+
+        results["systems_checked"] = len(systems)
+
+        # Check each system
+        for system in systems:
+            try:
+                loggers = self.probe(system, float(seconds))
+
+                hot_files = []
+                for logger in loggers:
+                    logger["hot"] = logger.get("write_bytes_per_sec", 0) >= float(hot_rate)
+                    logger["backpressured"] = (
+                        logger.get("dropped_per_sec", 0) > 0 or
+                        logger.get("queue_growth_bytes", 0) >= int(queue_limit) or
+                        logger.get("throttled_ms_per_sec", 0) >= self.THROTTLED_MS_PER_SEC
+                    )
+                    if logger["hot"] or logger["backpressured"]:
+                        hot_files.extend(logger["files"] or [path for path in [logger["log_path"]] if path])
+
+                # Hottest first, so hotswaps can start at the top
+                loggers.sort(key=lambda logger: logger.get("write_bytes_per_sec", 0), reverse=True)
+
+                # Update system properties
+                system.add_property("loggers", loggers)
+                system.add_property("log_files", sorted({f for logger in loggers for f in logger["files"]}))
+                system.add_property("log_write_rate", sum(logger.get("write_bytes_per_sec", 0) for logger in loggers))
+
+                # Tags reflect this sample only
+                for tag in self.get_tags_added():
+                    system.remove_tag(tag)
+                system.remove_role("hotswap_target")
+
+                hot = sum(1 for logger in loggers if logger["hot"])
+                backpressured = sum(1 for logger in loggers if logger["backpressured"])
+                if hot:
+                    system.add_tag("log_hot")
+                if backpressured:
+                    system.add_tag("log_backpressured")
+                if hot_files:
+                    role = system.add_role("hotswap_target",
+                                           "Loggers that would benefit from moving their log files")
+                    role.add_property("files", sorted(set(hot_files)))
+
+                results["loggers_found"] += len(loggers)
+                results["hot_loggers"] += hot
+                results["backpressured_loggers"] += backpressured
+                results["systems_updated"] += 1
+
+            except Exception as e:
+                # Log the error but continue with other systems
+                results.setdefault("errors", []).append({
+                    "system": system.name,
+                    "error": str(e)
+                })
+
+        return results
+
+    def probe(self, system, seconds: float) -> List[Dict[str, Any]]:
+        """
+        Run the probe on a system and return its loggers.
+
+        Args:
+            system: The system to probe
+            seconds: Time between the two samples
+
+        Returns:
+            One dictionary per logger process
+
+        Raises:
+            DiscoveryError: If the probe produced no usable output
+        """
+        loggers = run_probe(system, PROBE_SCRIPT, [str(seconds)], timeout=seconds + 30)
+        if not isinstance(loggers, list):
+            raise DiscoveryError(f"unexpected logger probe output from {system.endpoint.hostname}")
+        return loggers
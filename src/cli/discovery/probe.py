@@ -0,0 +1,75 @@
+"""
+Helpers for running discovery probes on target systems.
+"""
+import json
+import shlex
+import socket
+import subprocess
+import sys
+from typing import Any, List
+
+from .base import DiscoveryError
+
+
+# Hostnames probes run on directly instead of through the remote agent
+LOCAL_HOSTS = {"localhost", "127.0.0.1", "::1"}
+
+
+def is_local(system) -> bool:
+    """
+    Check whether a system is the machine the CLI runs on.
+
+    Args:
+        system: The system to check
+
+    Returns:
+        True if commands for the system can run locally
+    """
+    hostname = system.endpoint.hostname
+    return hostname in LOCAL_HOSTS or hostname == socket.gethostname()
+
+
+def run_command(system, argv: List[str], timeout: float = 60) -> str:
+    """
+    Run a command on a system and return its output.
+
+    Args:
+        system: The system to run the command on
+        argv: The command and its arguments
+        timeout: Seconds to wait for a local command
+
+    Returns:
+        The command's standard output
+    """
+    if is_local(system):
+        completed = subprocess.run(argv, capture_output=True, text=True, timeout=timeout)
+        return completed.stdout
+    if not system.is_connected():
+        agent = system.connect()
+    else:
+        agent = system.endpoint.agent
+    return agent.execute(" ".join(shlex.quote(arg) for arg in argv))
+
+
+def run_probe(system, script: str, args: List[str], timeout: float = 60) -> Any:
+    """
+    Run a Python probe script on a system and parse the JSON it prints.
+
+    Args:
+        system: The system to probe
+        script: Python source run with python3 -c
+        args: Arguments passed to the script
+        timeout: Seconds to wait for a local probe
+
+    Returns:
+        The decoded JSON value
+
+    Raises:
+        DiscoveryError: If the probe produced no JSON
+    """
+    interpreter = sys.executable if is_local(system) else "python3"
+    output = run_command(system, [interpreter, "-c", script] + list(args), timeout)
+    try:
+        return json.loads(output)
+    except (TypeError, ValueError):
+        raise DiscoveryError(f"no probe output from {system.endpoint.hostname}")
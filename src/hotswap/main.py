@@ -6,6 +6,10 @@ This tool allows redirecting file descriptors in a running process without
 requiring a restart. It's particularly useful for log file rotation in
 third-party applications where restart is complex or disruptive.
 
+Besides another file, the descriptor can be pointed at a FIFO, an AF_UNIX
+stream socket or a memfd, to stream a running process's log into an analyzer
+without touching disk, and later swapped back with --fd.
+
 This tool requires the same user permissions as the target process.
 """
 
@@ -20,6 +24,10 @@ from pathlib import Path
 from typing import Dict, List, Optional, Tuple, Union, Set
 
 
+# Kinds of target a descriptor can be redirected to
+TARGET_KINDS = ("file", "fifo", "socket", "memfd")
+
+
 def find_processes_with_file(file_path: Path) -> List[int]:
     """
     Find all processes that have the specified file open.
@@ -65,21 +73,29 @@ class FdHotSwap:
     one file to another in a running process, without requiring a restart.
     """
     
-    def __init__(self, pid: int, old_path: str, new_path: str, verbose: bool = True) -> None:
+    def __init__(self, pid: int, old_path: Optional[str], new_path: str, verbose: bool = True,
+                 kind: str = "file", fd_number: Optional[int] = None,
+                 ignore_sigpipe: bool = False) -> None:
         """
         Initialize the FdHotSwap instance.
         
         Args:
             pid: The process ID of the target process.
-            old_path: The current file path to be redirected.
-            new_path: The new file path to redirect to.
+            old_path: The current file path to be redirected (None with fd_number).
+            new_path: The new file, FIFO or socket path, or the memfd name.
             verbose: Whether to print detailed progress messages.
+            kind: One of TARGET_KINDS.
+            fd_number: The descriptor to redirect, instead of looking up old_path.
+            ignore_sigpipe: Make the process ignore SIGPIPE, so it survives
+                the reader of a FIFO or socket going away.
         """
         self.pid = pid
-        self.old_path = Path(old_path).absolute()
-        self.new_path = Path(new_path).absolute()
+        self.old_path = Path(old_path).absolute() if old_path else None
+        self.kind = kind
+        self.new_path = Path(new_path) if kind == "memfd" else Path(new_path).absolute()
         self.verbose = verbose
-        self.fd_number: Optional[int] = None
+        self.fd_number: Optional[int] = fd_number
+        self.ignore_sigpipe = ignore_sigpipe
     
     def log(self, message: str) -> None:
         """
@@ -147,6 +163,14 @@ class FdHotSwap:
         Returns:
             True if the file descriptor was found, False otherwise.
         """
+        if self.fd_number is not None:
+            try:
+                target = os.readlink(f"/proc/{self.pid}/fd/{self.fd_number}")
+                self.log(f"Using fd: {self.fd_number} -> {target}")
+                return True
+            except OSError as e:
+                self.log(f"Error: fd {self.fd_number} is not open in process {self.pid}: {e}")
+                return False
         try:
             fd_dir = Path(f"/proc/{self.pid}/fd")
             for fd_path in fd_dir.iterdir():
@@ -205,6 +229,86 @@ class FdHotSwap:
             self.log(f"Error creating new file: {e}")
             return False
     
+    def check_target(self) -> bool:
+        """
+        Check that a FIFO or socket target exists and has the right type.
+        
+        The tool does not create them: the analyzer reading the log owns the
+        FIFO or listening socket and must have it open before the swap.
+        
+        Returns:
+            True if the target can be used, False otherwise.
+        """
+        if self.kind == "memfd":
+            if not str(self.new_path) or "/" in str(self.new_path):
+                self.log(f"Error: Invalid memfd name: {self.new_path}")
+                return False
+            return True
+        expected = stat.S_ISFIFO if self.kind == "fifo" else stat.S_ISSOCK
+        try:
+            if not expected(self.new_path.stat().st_mode):
+                self.log(f"Error: {self.new_path} is not a {'FIFO' if self.kind == 'fifo' else 'socket'}.")
+                return False
+            return True
+        except OSError as e:
+            self.log(f"Error: Cannot use {self.new_path}: {e}")
+            return False
+
+    def redirect_commands(self) -> str:
+        """
+        GDB commands that open a FIFO, socket or memfd target in the process
+        and move it onto the descriptor with dup2.
+        
+        Returns:
+            The commands, ending with REDIRECT_SUCCESS or REDIRECT_FAILED.
+        """
+        target = str(self.new_path).replace('\\', '\\\\').replace('"', '\\"')
+        if self.kind == "fifo":
+            # O_WRONLY|O_NONBLOCK fails instead of hanging without a reader;
+            # clearing the flags again gives the process ordinary blocking writes
+            open_commands = f"""
+set $newfd = (int)open("{target}", 04001)
+if $newfd >= 0
+    call (int)fcntl($newfd, 4, 0)
+end
+"""
+        elif self.kind == "socket":
+            # struct sockaddr_un: sa_family_t then a 108-byte path
+            open_commands = f"""
+set $addr = (char *)malloc(110)
+call (void *)memset($addr, 0, 110)
+set *(unsigned short *)$addr = 1
+call (char *)strncpy($addr + 2, "{target}", 107)
+set $newfd = (int)socket(1, 1, 0)
+if $newfd >= 0
+    if (int)connect($newfd, $addr, 110) != 0
+        call (int)close($newfd)
+        set $newfd = -1
+    end
+end
+call (void)free($addr)
+"""
+        else:
+            open_commands = f"""
+set $newfd = (int)memfd_create("{target}", 0)
+"""
+        sigpipe_commands = "call (void *)signal(13, (void *)1)\n" if self.ignore_sigpipe else ""
+        return open_commands + f"""
+if $newfd < 0
+    echo REDIRECT_FAILED\\n
+    detach
+    quit 1
+end
+set $result = (int)dup2($newfd, {self.fd_number})
+call (int)close($newfd)
+if $result < 0
+    echo REDIRECT_FAILED\\n
+    detach
+    quit 1
+end
+{sigpipe_commands}echo REDIRECT_SUCCESS\\n
+"""
+
     def create_gdb_script(self) -> Tuple[bool, Path]:
         """
         Create a temporary GDB script to perform the file descriptor redirection.
@@ -216,6 +320,23 @@ class FdHotSwap:
             fd, script_path = tempfile.mkstemp(suffix='.gdb')
             os.close(fd)
             
+            if self.kind != "file":
+                script_content = f"""
+set pagination off
+set confirm off
+set height 0
+set width 0
+
+# Attach to the process
+attach {self.pid}
+{self.redirect_commands()}
+# Detach and quit
+detach
+quit 0
+"""
+                Path(script_path).write_text(script_content)
+                return True, Path(script_path)
+
             # Escape backslashes in paths for GDB
             new_path_escaped = str(self.new_path).replace('\\', '\\\\')
         
@@ -269,7 +390,7 @@ quit 0
             True if GDB executed successfully, False otherwise.
         """
         try:
-            self.log(f"Executing GDB to redirect fd {self.fd_number} to {self.new_path}...")
+            self.log(f"Executing GDB to redirect fd {self.fd_number} to {self.kind} {self.new_path}...")
             result = subprocess.run(["gdb", "-batch", "-x", str(script_path)], 
                                    stdout=subprocess.PIPE, 
                                    stderr=subprocess.PIPE)
@@ -294,6 +415,22 @@ quit 0
         """
         try:
             fd_link = Path(f"/proc/{self.pid}/fd/{self.fd_number}")
+            if self.kind != "file":
+                # FIFOs read back as their path, sockets as socket:[inode]
+                # and memfds as /memfd:NAME (deleted)
+                link = os.readlink(fd_link)
+                if self.kind == "fifo":
+                    ok = Path(link) == self.new_path
+                elif self.kind == "socket":
+                    ok = link.startswith("socket:[")
+                else:
+                    ok = link.startswith(f"/memfd:{self.new_path}")
+                if ok:
+                    self.log(f"Success! File descriptor {self.fd_number} now points to {link}")
+                else:
+                    self.log(f"Warning: Verification failed. Current target is: {link}")
+                return ok
+
             new_target = fd_link.resolve()
             
             if new_target == self.new_path:
@@ -315,8 +452,8 @@ quit 0
         """
         # Header
         self.log(f"Starting log file descriptor hot-swap for process {self.pid}...")
-        self.log(f"Current log: {self.old_path}")
-        self.log(f"New log: {self.new_path}")
+        self.log(f"Current log: {self.old_path if self.old_path else f'fd {self.fd_number}'}")
+        self.log(f"New log: {self.new_path}" if self.kind == "file" else f"New target: {self.kind} {self.new_path}")
         self.log("")
         
         # Check prerequisites
@@ -332,7 +469,8 @@ quit 0
             self.log("\nOperation completed.")
             return False
         
-        if not self.create_new_file():
+        prepared = self.create_new_file() if self.kind == "file" else self.check_target()
+        if not prepared:
             self.log("\nOperation completed.")
             return False
         
@@ -349,7 +487,13 @@ quit 0
                 return False
             
             result = self.verify_redirection()
-            if result:
+            if result and self.kind == "memfd":
+                self.log(f"Read the log at /proc/{self.pid}/fd/{self.fd_number}; keep it open "
+                         f"before swapping back with --fd {self.fd_number}, which frees the memfd.")
+            elif result and self.kind != "file":
+                self.log(f"Swap back with --pid {self.pid} --fd {self.fd_number} --to <log file> "
+                         f"before the reader goes away.")
+            elif result and self.old_path:
                 self.log(f"You can now safely delete or compress the old log file: {self.old_path}")
             self.log("\nOperation completed.")
             return result
@@ -361,14 +505,17 @@ quit 0
                 pass
 
 
-def process_all_instances(old_path: str, new_path: str, verbose: bool = True) -> Tuple[bool, int]:
+def process_all_instances(old_path: str, new_path: str, verbose: bool = True, kind: str = "file",
+                          ignore_sigpipe: bool = False) -> Tuple[bool, int]:
     """
     Process all instances of processes that have the old file open.
     
     Args:
         old_path: Path to the old file.
-        new_path: Path to the new file.
+        new_path: Path to the new file, FIFO or socket, or the memfd name.
         verbose: Whether to print verbose output.
+        kind: One of TARGET_KINDS.
+        ignore_sigpipe: Make the processes ignore SIGPIPE.
         
     Returns:
         A tuple of (success, count) where:
@@ -391,36 +538,38 @@ def process_all_instances(old_path: str, new_path: str, verbose: bool = True) ->
     if verbose:
         print(f"Found {len(pids)} process(es) with file open: {', '.join(map(str, pids))}")
     
-    # Create the new file first (just once)
+    # Create the new file first (just once); other targets are checked
+    # by each swap, and every process gets its own connection or memfd
     new_path_abs = Path(new_path).absolute()
-    new_path_abs.parent.mkdir(parents=True, exist_ok=True)
     
     # Handle file creation or update permissions if it exists
     try:
-        if not new_path_abs.exists():
-            new_path_abs.touch()
-            if verbose:
-                print(f"Created new file: {new_path_abs}")
-            
-            if old_path_abs.exists():
-                old_stat = old_path_abs.stat()
-                os.chmod(new_path_abs, stat.S_IMODE(old_stat.st_mode))
+        if kind == "file":
+            new_path_abs.parent.mkdir(parents=True, exist_ok=True)
+            if not new_path_abs.exists():
+                new_path_abs.touch()
                 if verbose:
-                    print(f"Copied permissions from {old_path_abs} to {new_path_abs}")
+                    print(f"Created new file: {new_path_abs}")
+            
+                if old_path_abs.exists():
+                    old_stat = old_path_abs.stat()
+                    os.chmod(new_path_abs, stat.S_IMODE(old_stat.st_mode))
+                    if verbose:
+                        print(f"Copied permissions from {old_path_abs} to {new_path_abs}")
+                else:
+                    os.chmod(new_path_abs, 0o644)
+                    if verbose:
+                        print(f"Old file not found, set default permissions (644) on {new_path_abs}")
             else:
-                os.chmod(new_path_abs, 0o644)
                 if verbose:
-                    print(f"Old file not found, set default permissions (644) on {new_path_abs}")
-        else:
-            if verbose:
-                print(f"Using existing file: {new_path_abs}")
+                    print(f"Using existing file: {new_path_abs}")
             
-            # Update permissions on existing file
-            if old_path_abs.exists():
-                old_stat = old_path_abs.stat()
-                os.chmod(new_path_abs, stat.S_IMODE(old_stat.st_mode))
-                if verbose:
-                    print(f"Updated permissions on existing file to match {old_path_abs}")
+                # Update permissions on existing file
+                if old_path_abs.exists():
+                    old_stat = old_path_abs.stat()
+                    os.chmod(new_path_abs, stat.S_IMODE(old_stat.st_mode))
+                    if verbose:
+                        print(f"Updated permissions on existing file to match {old_path_abs}")
     except (OSError, PermissionError) as e:
         if verbose:
             print(f"Error setting up target file: {e}")
@@ -437,7 +586,8 @@ def process_all_instances(old_path: str, new_path: str, verbose: bool = True) ->
         if verbose:
             print(f"\n{'=' * 50}")
         
-        hotswap = FdHotSwap(pid, old_path, new_path, verbose=verbose)
+        hotswap = FdHotSwap(pid, old_path, new_path, verbose=verbose, kind=kind,
+                            ignore_sigpipe=ignore_sigpipe)
         success = hotswap.run()
         
         if success:
@@ -453,7 +603,7 @@ def process_all_instances(old_path: str, new_path: str, verbose: bool = True) ->
         print(f"Successfully redirected {len(successful_pids)} process(es): {', '.join(map(str, successful_pids)) if successful_pids else 'None'}")
         print(f"Failed to redirect {len(failed_pids)} process(es): {', '.join(map(str, failed_pids)) if failed_pids else 'None'}")
         
-        if successful_pids:
+        if successful_pids and kind == "file":
             print(f"\nYou can now safely delete or compress the old log file: {old_path_abs}")
         
         print("\nOperation completed.")
@@ -474,25 +624,50 @@ def main() -> int:
 Examples:
   %(prog)s --from /var/log/app/current.log --to /var/log/app/new.log
   %(prog)s --pid 12345 --from /var/log/app/current.log --to /var/log/app/new.log
-"""
+  %(prog)s --pid 12345 --from /var/log/app/current.log --to-fifo /tmp/analyzer.fifo
+  %(prog)s --pid 12345 --fd 3 --to /var/log/app/current.log
+""",
+        formatter_class=argparse.RawDescriptionHelpFormatter
     )
     
     parser.add_argument("-p", "--pid", type=int, help="Process ID of the target process (optional)")
-    parser.add_argument("-f", "--from", dest="old_path", type=str, required=True, help="Current log file path")
-    parser.add_argument("-t", "--to", dest="new_path", type=str, required=True, help="New log file path")
+    parser.add_argument("-f", "--from", dest="old_path", type=str, help="Current log file path")
+    parser.add_argument("--fd", dest="fd_number", type=int,
+                        help="Descriptor to redirect instead of --from, e.g. to swap a FIFO, socket "
+                             "or memfd back to a file (requires --pid)")
+    targets = parser.add_mutually_exclusive_group(required=True)
+    targets.add_argument("-t", "--to", dest="new_path", type=str, help="New log file path")
+    targets.add_argument("--to-fifo", type=str, help="FIFO an analyzer is already reading")
+    targets.add_argument("--to-socket", type=str, help="AF_UNIX stream socket an analyzer listens on")
+    targets.add_argument("--to-memfd", type=str, metavar="NAME",
+                         help="New memfd, read through /proc/PID/fd/FD")
+    parser.add_argument("--ignore-sigpipe", action="store_true",
+                        help="Make the process ignore SIGPIPE, so it survives the FIFO or socket "
+                             "reader going away (its writes then fail with EPIPE instead)")
     parser.add_argument("-q", "--quiet", action="store_true", help="Suppress detailed output")
     
     args = parser.parse_args()
     verbose = not args.quiet
     
+    kind, new_path = "file", args.new_path
+    for name in ("fifo", "socket", "memfd"):
+        if getattr(args, f"to_{name}") is not None:
+            kind, new_path = name, getattr(args, f"to_{name}")
+    if args.fd_number is not None and args.pid is None:
+        parser.error("--fd requires --pid")
+    if args.fd_number is None and args.old_path is None:
+        parser.error("one of --from or --fd is required")
+    
     if args.pid is not None:
         # Process a specific PID
-        hotswap = FdHotSwap(args.pid, args.old_path, args.new_path, verbose=verbose)
+        hotswap = FdHotSwap(args.pid, args.old_path, new_path, verbose=verbose, kind=kind,
+                            fd_number=args.fd_number, ignore_sigpipe=args.ignore_sigpipe)
         success = hotswap.run()
         return 0 if success else 1
     else:
         # Find and process all matching PIDs
-        success, count = process_all_instances(args.old_path, args.new_path, verbose=verbose)
+        success, count = process_all_instances(args.old_path, new_path, verbose=verbose, kind=kind,
+                                               ignore_sigpipe=args.ignore_sigpipe)
         if count == 0:
             # Special case: no error, but no processes found
             if verbose:
@@ -0,0 +1,228 @@
+#include "BatchFormatter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include "StackCapture.hpp"
+
+namespace {
+    constexpr char kThreadPrefix[] = "Thread ";
+    constexpr char kTimeOpen[] = ": [";
+    constexpr char kCounterPrefix[] = "] Has counter ";
+    constexpr char kChildPrefix[] = "Child ";
+    constexpr char kStreamOpen[2][11] = {" stdout: [", " stderr: ["};
+    constexpr char kCaptureClose[] = "] ";
+    constexpr char kStackOpen[] = " [stack";
+
+    constexpr size_t kThreadPrefixLength = sizeof(kThreadPrefix) - 1;
+    constexpr size_t kTimeOpenLength = sizeof(kTimeOpen) - 1;
+    constexpr size_t kCounterPrefixLength = sizeof(kCounterPrefix) - 1;
+    constexpr size_t kChildPrefixLength = sizeof(kChildPrefix) - 1;
+    constexpr size_t kStreamOpenLength = sizeof(kStreamOpen[0]) - 1;
+    constexpr size_t kCaptureCloseLength = sizeof(kCaptureClose) - 1;
+
+    // " +0x<offset>" for a frame in the executable, " 0x<address>" otherwise
+    void appendFrame(std::string& out, uint64_t frame) {
+        static constexpr char kHex[] = "0123456789abcdef";
+        char buffer[24];
+        char* end = buffer + sizeof(buffer);
+        char* p = end;
+        uint64_t value = frame & ~StackCapture::kImageOffset;
+        do {
+            *--p = kHex[value & 0xf];
+            value >>= 4;
+        } while (value != 0);
+        *--p = 'x';
+        *--p = '0';
+        if (frame & StackCapture::kImageOffset) {
+            *--p = '+';
+        }
+        *--p = ' ';
+        out.append(p, static_cast<size_t>(end - p));
+    }
+
+    inline char* putTwoDigits(char* p, int value) {
+        p[0] = static_cast<char>('0' + value / 10);
+        p[1] = static_cast<char>('0' + value % 10);
+        return p + 2;
+    }
+}
+
+void BatchFormatter::add(const char* data, uint32_t length) {
+    if (length < sizeof(RecordHeader)) {
+        return;
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    Entry entry{};
+    entry.kind = header.kind;
+    entry.thread_id = header.thread_id;
+    entry.seconds = header.timestamp_ns / 1000000000;
+
+    if (header.kind == RecordKind::Counter && length >= sizeof(CounterRecord)) {
+        std::memcpy(&entry.counter, data + offsetof(CounterRecord, counter), sizeof(entry.counter));
+    } else if (header.kind == RecordKind::Capture) {
+        entry.continued = header.continued != 0;
+        entry.text_offset = static_cast<uint32_t>(text_.size());
+        entry.text_length = length - static_cast<uint32_t>(sizeof(RecordHeader));
+        const char* text = data + sizeof(RecordHeader);
+        text_.append(text, entry.text_length);
+
+        // A line starts at the front (unless continued) and after every
+        // newline that is not the last byte
+        size_t newlines = static_cast<size_t>(std::count(text, text + entry.text_length, '\n'));
+        bool ends_line = entry.text_length > 0 && text[entry.text_length - 1] == '\n';
+        entry.line_starts = entry.text_length == 0 ? 0 :
+            static_cast<uint32_t>(newlines + (ends_line ? 0 : 1) - (entry.continued ? 1 : 0));
+    } else if (header.kind == RecordKind::Trace && length >= sizeof(TraceRecord)) {
+        // Rare, so rendered here: the line, then its frames before the newline
+        TraceRecord trace;
+        std::memcpy(&trace, data, sizeof(trace));
+        uint32_t frames = std::min<uint32_t>(trace.frame_count,
+            (length - static_cast<uint32_t>(sizeof(TraceRecord))) / sizeof(uint64_t));
+        const char* text = data + sizeof(TraceRecord) + frames * sizeof(uint64_t);
+        uint32_t text_length = length - static_cast<uint32_t>(text - data);
+        bool newline = text_length > 0 && text[text_length - 1] == '\n';
+
+        entry.kind = RecordKind::Text;
+        entry.text_offset = static_cast<uint32_t>(text_.size());
+        text_.append(text, text_length - (newline ? 1 : 0));
+        text_.append(kStackOpen, sizeof(kStackOpen) - 1);
+        for (uint32_t i = 0; i < frames; ++i) {
+            uint64_t frame;
+            std::memcpy(&frame, data + sizeof(TraceRecord) + i * sizeof(uint64_t), sizeof(frame));
+            appendFrame(text_, frame);
+        }
+        text_.append("]\n");
+        entry.text_length = static_cast<uint32_t>(text_.size()) - entry.text_offset;
+    } else {
+        entry.kind = RecordKind::Text;
+        entry.text_offset = static_cast<uint32_t>(text_.size());
+        entry.text_length = length - static_cast<uint32_t>(sizeof(RecordHeader));
+        text_.append(data + sizeof(RecordHeader), entry.text_length);
+    }
+    entries_.push_back(entry);
+}
+
+void BatchFormatter::render(std::string& out, std::vector<size_t>* line_ends) {
+    // Pass 1: convert every numeric field of the batch at once
+    values_.clear();
+    for (const auto& entry : entries_) {
+        if (entry.kind == RecordKind::Counter) {
+            values_.push_back(entry.thread_id);
+            values_.push_back(entry.counter);
+        } else if (entry.kind == RecordKind::Capture) {
+            values_.push_back(entry.thread_id / 2);
+        }
+    }
+    digits_.resize(values_.size());
+    DecimalFormat::convertBatch(values_.data(), values_.size(), digits_.data());
+
+    // Pass 2: size the output once
+    size_t total = 0;
+    size_t field = 0;
+    for (const auto& entry : entries_) {
+        if (entry.kind == RecordKind::Counter) {
+            total += kThreadPrefixLength + digits_[field].length + kTimeOpenLength + kTimeLength +
+                     kCounterPrefixLength + digits_[field + 1].length + 1;
+            field += 2;
+        } else if (entry.kind == RecordKind::Capture) {
+            total += entry.text_length + entry.line_starts * (kChildPrefixLength + digits_[field].length +
+                     kStreamOpenLength + kTimeLength + kCaptureCloseLength);
+            field += 1;
+        } else {
+            total += entry.text_length;
+        }
+    }
+
+    // Pass 3: scatter each line directly into the output buffer
+    size_t base = out.size();
+    out.resize(base + total);
+    char* p = out.data() + base;
+    field = 0;
+    for (const auto& entry : entries_) {
+        if (entry.kind == RecordKind::Counter) {
+            const auto& id = digits_[field];
+            const auto& counter = digits_[field + 1];
+            field += 2;
+
+            std::memcpy(p, kThreadPrefix, kThreadPrefixLength);
+            p += kThreadPrefixLength;
+            std::memcpy(p, id.data(), id.length);
+            p += id.length;
+            std::memcpy(p, kTimeOpen, kTimeOpenLength);
+            p += kTimeOpenLength;
+            std::memcpy(p, timeOfDay(entry.seconds), kTimeLength);
+            p += kTimeLength;
+            std::memcpy(p, kCounterPrefix, kCounterPrefixLength);
+            p += kCounterPrefixLength;
+            std::memcpy(p, counter.data(), counter.length);
+            p += counter.length;
+            *p++ = '\n';
+        } else if (entry.kind == RecordKind::Capture) {
+            const auto& child = digits_[field];
+            field += 1;
+            const char* time = timeOfDay(entry.seconds);
+            const char* text = text_.data() + entry.text_offset;
+            const char* end = text + entry.text_length;
+            bool line_start = !entry.continued;
+            while (text < end) {
+                if (line_start) {
+                    std::memcpy(p, kChildPrefix, kChildPrefixLength);
+                    p += kChildPrefixLength;
+                    std::memcpy(p, child.data(), child.length);
+                    p += child.length;
+                    std::memcpy(p, kStreamOpen[entry.thread_id & 1], kStreamOpenLength);
+                    p += kStreamOpenLength;
+                    std::memcpy(p, time, kTimeLength);
+                    p += kTimeLength;
+                    std::memcpy(p, kCaptureClose, kCaptureCloseLength);
+                    p += kCaptureCloseLength;
+                }
+                const char* newline = static_cast<const char*>(
+                    std::memchr(text, '\n', static_cast<size_t>(end - text)));
+                const char* line_end = newline ? newline + 1 : end;
+                std::memcpy(p, text, static_cast<size_t>(line_end - text));
+                p += line_end - text;
+                text = line_end;
+                line_start = true;
+            }
+        } else {
+            std::memcpy(p, text_.data() + entry.text_offset, entry.text_length);
+            p += entry.text_length;
+        }
+        if (line_ends) {
+            line_ends->push_back(static_cast<size_t>(p - out.data()));
+        }
+    }
+
+    entries_.clear();
+    text_.clear();
+}
+
+const char* BatchFormatter::timeOfDay(int64_t seconds) {
+    if (seconds != cached_second_) {
+        std::time_t time = static_cast<std::time_t>(seconds);
+        std::tm tm_info;
+        localtime_r(&time, &tm_info);
+
+        // YYYY-MM-DD HH:MM:SS
+        char* p = cached_time_;
+        int year = tm_info.tm_year + 1900;
+        p = putTwoDigits(p, year / 100 % 100);
+        p = putTwoDigits(p, year % 100);
+        *p++ = '-';
+        p = putTwoDigits(p, tm_info.tm_mon + 1);
+        *p++ = '-';
+        p = putTwoDigits(p, tm_info.tm_mday);
+        *p++ = ' ';
+        p = putTwoDigits(p, tm_info.tm_hour);
+        *p++ = ':';
+        p = putTwoDigits(p, tm_info.tm_min);
+        *p++ = ':';
+        putTwoDigits(p, tm_info.tm_sec);
+        cached_second_ = seconds;
+    }
+    return cached_time_;
+}
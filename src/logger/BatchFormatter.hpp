@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DecimalFormat.hpp"
+#include "LogRecord.hpp"
+
+// Renders a batch of queued records to text on the writer thread.
+//
+// Numeric fields of the whole batch (thread ids and counters) are converted
+// in one DecimalFormat::convertBatch() pass, the output buffer is sized once,
+// and each line is scattered straight into it. The "YYYY-MM-DD HH:MM:SS"
+// time of day is rendered once per distinct second and reused. Captured child
+// output gets a "Child N stream: [time] " prefix at the start of each line.
+class BatchFormatter {
+public:
+    // Copy one raw record (as stored in a SegmentQueue) into the batch
+    void add(const char* data, uint32_t length);
+
+    // Number of records waiting to be rendered
+    size_t pending() const { return entries_.size(); }
+
+    // Bytes of text carried by the pending records
+    size_t pendingTextBytes() const { return text_.size(); }
+
+    // Append every pending line to out and clear the batch.
+    // When line_ends is given it receives the end offset in out of each line.
+    void render(std::string& out, std::vector<size_t>* line_ends = nullptr);
+
+private:
+    struct Entry {
+        RecordKind kind;
+        uint32_t thread_id;
+        int64_t seconds;
+        uint64_t counter;
+        uint32_t text_offset;
+        uint32_t text_length;
+        uint32_t line_starts;   // Capture: lines that get a prefix
+        bool continued;         // Capture: text starts mid-line
+    };
+
+    // Refresh the cached time-of-day text if seconds changed
+    const char* timeOfDay(int64_t seconds);
+
+    std::vector<Entry> entries_;
+    std::string text_;                               // Payloads of Text records
+    std::vector<uint64_t> values_;                   // Numeric fields to convert
+    std::vector<DecimalFormat::Digits> digits_;      // Converted fields
+
+    static constexpr size_t kTimeLength = 19;
+    int64_t cached_second_ = INT64_MIN;
+    char cached_time_[kTimeLength];
+};
@@ -0,0 +1,238 @@
+#include "ChannelRouter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Render a channel's records once this many, or this much raw text,
+    // wait in its formatter (prefixes make the rendered text a few times larger)
+    constexpr size_t kMaxPendingRecords = 4096;
+    constexpr size_t kMaxPendingTextBytes = 64u << 10;
+
+    // Write a channel out once it holds this much text, flush delay or not
+    constexpr size_t kMaxHeldBytes = 1u << 20;
+
+    // Move held text to a fresh arena once the arena grows past this
+    constexpr size_t kMaxArenaBytes = 8u << 20;
+
+    // IOV_MAX on Linux
+    constexpr size_t kMaxIov = 1024;
+
+    int openChannelFile(const std::string& path, int extra_flags) {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | extra_flags, 0644);
+    }
+}
+
+ChannelRouter::ChannelRouter(const std::vector<ChannelConfig>& channels) {
+    if (channels.size() > UINT16_MAX) {
+        throw std::invalid_argument("too many channels");
+    }
+    for (const auto& config : channels) {
+        if (config.name.empty() || config.path.empty()) {
+            throw std::invalid_argument("a channel needs a name and a file");
+        }
+        for (const auto& route : routes_) {
+            if (route->config.name == config.name || route->config.path == config.path) {
+                throw std::invalid_argument("channel " + config.name + " repeats the name or file of " +
+                                            route->config.name);
+            }
+        }
+        auto route = std::make_unique<Route>();
+        route->config = config;
+        route->fd = openChannelFile(config.path, 0);
+        if (route->fd < 0) {
+            throw std::runtime_error("Error opening channel file: " + config.path);
+        }
+        struct stat st;
+        if (::fstat(route->fd, &st) == 0) {
+            route->file_bytes = static_cast<uint64_t>(st.st_size);
+        }
+        routes_.push_back(std::move(route));
+    }
+}
+
+ChannelRouter::Route::~Route() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+ChannelRouter::~ChannelRouter() {
+    flush(true);
+}
+
+uint16_t ChannelRouter::id(const std::string& name) const {
+    if (name.empty()) {
+        return 0;
+    }
+    for (size_t i = 0; i < routes_.size(); ++i) {
+        if (routes_[i]->config.name == name) {
+            return static_cast<uint16_t>(i + 1);
+        }
+    }
+    throw std::invalid_argument("unknown channel: " + name);
+}
+
+void ChannelRouter::add(uint16_t channel, const char* data, uint32_t length) {
+    Route& route = *routes_[channel - 1];
+    if (route.formatter.pending() == 0 && route.spans.empty()) {
+        route.pending_since = std::chrono::steady_clock::now();
+    }
+    route.formatter.add(data, length);
+    route.records.fetch_add(1, std::memory_order_relaxed);
+    if (route.formatter.pending() >= kMaxPendingRecords || route.formatter.pendingTextBytes() >= kMaxPendingTextBytes) {
+        render(route);
+        if (route.pending_bytes >= kMaxHeldBytes) {
+            write(route);
+        }
+    }
+}
+
+void ChannelRouter::flush(bool force) {
+    auto now = std::chrono::steady_clock::now();
+    bool held = false;
+    for (auto& route : routes_) {
+        if (route->formatter.pending() == 0 && route->spans.empty()) {
+            continue;
+        }
+        // Records of a held channel stay compact in its formatter until due
+        if (!force && route->config.flush_ms > 0 &&
+            now - route->pending_since < std::chrono::milliseconds(route->config.flush_ms) &&
+            route->pending_bytes + route->formatter.pendingTextBytes() < kMaxHeldBytes) {
+            held = held || !route->spans.empty();
+            continue;
+        }
+        render(*route);
+        write(*route);
+    }
+    if (!held) {
+        arena_.clear();
+    } else if (arena_.size() > kMaxArenaBytes) {
+        compact();
+    }
+}
+
+void ChannelRouter::render(Route& route) {
+    if (route.formatter.pending() == 0) {
+        return;
+    }
+    size_t start = arena_.size();
+    route.formatter.render(arena_);
+    size_t length = arena_.size() - start;
+    if (length == 0) {
+        return;
+    }
+    if (!route.spans.empty() && route.spans.back().offset + route.spans.back().length == start) {
+        route.spans.back().length += length;
+    } else {
+        route.spans.push_back({start, length});
+    }
+    route.pending_bytes += length;
+}
+
+void ChannelRouter::write(Route& route) {
+    if (route.spans.empty()) {
+        return;
+    }
+    const ChannelConfig& config = route.config;
+    if (config.rotate_bytes > 0 && route.file_bytes > 0 &&
+        route.file_bytes + route.pending_bytes > config.rotate_bytes && !rotate(route)) {
+        route.errors.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Error rotating channel file " << config.path << ": " << std::strerror(errno) << "\n";
+    }
+
+    std::vector<iovec>& iov = iov_;
+    iov.clear();
+    for (const Span& span : route.spans) {
+        iov.push_back({arena_.data() + span.offset, span.length});
+    }
+    size_t index = 0;
+    bool failed = false;
+    while (index < iov.size()) {
+        int count = static_cast<int>(std::min(kMaxIov, iov.size() - index));
+        ssize_t written = ::writev(route.fd, &iov[index], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        // Skip what was written; a short write resumes mid-piece
+        size_t left = static_cast<size_t>(written);
+        while (left > 0 && left >= iov[index].iov_len) {
+            left -= iov[index].iov_len;
+            ++index;
+        }
+        if (left > 0) {
+            iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + left;
+            iov[index].iov_len -= left;
+        }
+    }
+
+    if (failed) {
+        route.errors.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Error writing to channel file " << config.path << ": " << std::strerror(errno) << "\n";
+    } else {
+        route.file_bytes += route.pending_bytes;
+        route.bytes.fetch_add(route.pending_bytes, std::memory_order_relaxed);
+        route.writes.fetch_add(1, std::memory_order_relaxed);
+        if (config.sync && ::fdatasync(route.fd) != 0) {
+            route.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    route.spans.clear();
+    route.pending_bytes = 0;
+}
+
+bool ChannelRouter::rotate(Route& route) {
+    const std::string& path = route.config.path;
+    for (int i = route.config.keep; i > 1; --i) {
+        ::rename((path + "." + std::to_string(i - 1)).c_str(), (path + "." + std::to_string(i)).c_str());
+    }
+    if (route.config.keep > 0 && ::rename(path.c_str(), (path + ".1").c_str()) != 0) {
+        return false;
+    }
+    // Without history the file just starts over
+    int fd = openChannelFile(path, route.config.keep > 0 ? 0 : O_TRUNC);
+    if (fd < 0) {
+        return false;
+    }
+    ::close(route.fd);
+    route.fd = fd;
+    route.file_bytes = 0;
+    route.rotations.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ChannelRouter::compact() {
+    spare_.clear();
+    for (auto& route : routes_) {
+        if (route->spans.empty()) {
+            continue;
+        }
+        size_t start = spare_.size();
+        for (const Span& span : route->spans) {
+            spare_.append(arena_, span.offset, span.length);
+        }
+        route->spans.assign(1, {start, spare_.size() - start});
+    }
+    arena_.swap(spare_);
+}
+
+void ChannelRouter::appendStats(std::ostream& out) const {
+    for (const auto& route : routes_) {
+        const std::string prefix = "channel." + route->config.name + ".";
+        out << prefix << "records=" << route->records.load(std::memory_order_relaxed) << "\n"
+            << prefix << "bytes=" << route->bytes.load(std::memory_order_relaxed) << "\n"
+            << prefix << "writes=" << route->writes.load(std::memory_order_relaxed) << "\n"
+            << prefix << "rotations=" << route->rotations.load(std::memory_order_relaxed) << "\n"
+            << prefix << "errors=" << route->errors.load(std::memory_order_relaxed) << "\n";
+    }
+}
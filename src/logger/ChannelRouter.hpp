@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include "BatchFormatter.hpp"
+#include "LoggerConfig.hpp"
+
+// Writer-side routing table for records tagged with a channel.
+//
+// Channel names are interned once at startup: 0 is the main log and the
+// configured channels are 1..N in order. Producers put the id in each
+// record header and take no lock for it; the writer finds the route by
+// indexing a vector. Every channel has its own formatter, file, flush
+// delay, rotation and sync setting.
+//
+// The text rendered during one writer pass goes into a single shared
+// arena, and each channel remembers where its pieces are. A channel is
+// then written with one writev() over those pieces, however interleaved
+// its records were with other channels in the producer queues.
+class ChannelRouter {
+public:
+    // Constructor opens every channel's file for appending; throws on failure
+    explicit ChannelRouter(const std::vector<ChannelConfig>& channels);
+
+    // Destructor writes what is still held and closes the files
+    ~ChannelRouter();
+
+    // Non-copyable
+    ChannelRouter(const ChannelRouter&) = delete;
+    ChannelRouter& operator=(const ChannelRouter&) = delete;
+
+    // Interned id of a channel name, 0 for ""; throws if there is no such channel
+    uint16_t id(const std::string& name) const;
+
+    // True if records of this channel go to a channel file
+    bool routes(uint16_t channel) const { return channel != 0 && channel <= routes_.size(); }
+
+    // Writer thread: add one raw record of a routed channel
+    void add(uint16_t channel, const char* data, uint32_t length);
+
+    // Writer thread: write every channel whose flush delay has passed, or
+    // all of them with force
+    void flush(bool force);
+
+    // "key=value" lines for the control socket's stats
+    void appendStats(std::ostream& out) const;
+
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+
+    struct Route {
+        ~Route();   // Closes the file
+
+        ChannelConfig config;
+        int fd = -1;
+        uint64_t file_bytes = 0;
+        BatchFormatter formatter;
+        std::vector<Span> spans;        // Rendered text in arena_
+        size_t pending_bytes = 0;
+        std::chrono::steady_clock::time_point pending_since;
+
+        std::atomic<uint64_t> records{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> writes{0};
+        std::atomic<uint64_t> rotations{0};
+        std::atomic<uint64_t> errors{0};
+    };
+
+    // Render the route's pending records into the arena
+    void render(Route& route);
+
+    // writev() the route's pieces to its file
+    void write(Route& route);
+
+    // Rename path to path.1 (shifting older ones) and start a new file
+    bool rotate(Route& route);
+
+    // Move the pieces still held to the front of a fresh arena
+    void compact();
+
+    std::vector<std::unique_ptr<Route>> routes_;   // Channel id - 1
+    std::string arena_;
+    std::string spare_;
+    std::vector<iovec> iov_;
+};
@@ -0,0 +1,247 @@
+#include "ChildCapture.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "LogRecord.hpp"
+#include "ThreadLogger.hpp"
+
+extern char** environ;
+
+namespace {
+    constexpr int kPipeBytes = 1 << 20;                       // Room for bursts while the log is busy
+    constexpr int kPollMs = 100;
+    constexpr auto kStopGrace = std::chrono::seconds(2);     // Output read after SIGTERM
+    constexpr auto kDrainGrace = std::chrono::seconds(2);    // Output read after the child exits
+
+    int64_t nowNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t steadyNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+ChildCapture::ChildCapture(int child_id, const std::string& command, SegmentQueue& out_queue,
+                           SegmentQueue& err_queue, size_t max_record_bytes, uint16_t out_channel,
+                           uint16_t err_channel)
+    : child_id_(child_id), command_(command), out_queue_(out_queue), err_queue_(err_queue),
+      max_text_bytes_(max_record_bytes - sizeof(RecordHeader)), channels_{out_channel, err_channel} {
+    if (max_record_bytes <= sizeof(RecordHeader) + 1) {
+        throw std::invalid_argument("queue segments are too small for child output");
+    }
+}
+
+ChildCapture::~ChildCapture() {
+    stop();
+}
+
+void ChildCapture::start() {
+    int out_pipe[2];
+    int err_pipe[2];
+    if (::pipe2(out_pipe, O_CLOEXEC) != 0) {
+        throw std::runtime_error("Error creating pipe: " + std::string(std::strerror(errno)));
+    }
+    if (::pipe2(err_pipe, O_CLOEXEC) != 0) {
+        int saved = errno;
+        ::close(out_pipe[0]);
+        ::close(out_pipe[1]);
+        throw std::runtime_error("Error creating pipe: " + std::string(std::strerror(saved)));
+    }
+    for (int fd : {out_pipe[0], err_pipe[0]}) {
+        ::fcntl(fd, F_SETPIPE_SZ, kPipeBytes);   // Best effort; capped by pipe-max-size
+    }
+
+    // The write ends become the child's stdout and stderr; everything else
+    // of ours is close-on-exec
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+
+    std::vector<char*> argv{const_cast<char*>("sh"), const_cast<char*>("-c"),
+                            command_.data(), nullptr};
+    int rc = ::posix_spawn(&pid_, "/bin/sh", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(out_pipe[1]);
+    ::close(err_pipe[1]);
+    if (rc != 0) {
+        ::close(out_pipe[0]);
+        ::close(err_pipe[0]);
+        pid_ = -1;
+        throw std::runtime_error("Error starting " + command_ + ": " + std::strerror(rc));
+    }
+
+    out_fd_ = out_pipe[0];
+    err_fd_ = err_pipe[0];
+    open_streams_ = 2;
+    out_reader_ = std::thread(&ChildCapture::readStream, this, out_fd_, std::ref(out_queue_),
+                              captureStreamId(child_id_, 0));
+    err_reader_ = std::thread(&ChildCapture::readStream, this, err_fd_, std::ref(err_queue_),
+                              captureStreamId(child_id_, 1));
+}
+
+void ChildCapture::stop() {
+    if (!out_reader_.joinable()) {
+        return;
+    }
+    stop_deadline_ns_ = steadyNanoseconds() +
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(kStopGrace).count();
+    stopping_ = true;
+    if (!finished()) {
+        ::kill(pid_, SIGTERM);
+    }
+    out_reader_.join();
+    err_reader_.join();
+    ::close(out_fd_);
+    ::close(err_fd_);
+    out_fd_ = err_fd_ = -1;
+}
+
+void ChildCapture::readStream(int fd, SegmentQueue& queue, uint32_t stream_id) {
+    // Records are assembled in place: header, then the text read after it
+    std::vector<char> record(sizeof(RecordHeader) + max_text_bytes_);
+    char* text = record.data() + sizeof(RecordHeader);
+    size_t pending = 0;      // Unfinished line kept for the next read
+    bool continued = false;  // text[0] is not the start of a line
+    int64_t next_reap_ns = 0;
+
+    for (;;) {
+        int64_t now = steadyNanoseconds();
+        if (now >= next_reap_ns) {
+            reap(false);
+            next_reap_ns = now + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::milliseconds(kPollMs)).count();
+        }
+        if ((stopping_ && now > stop_deadline_ns_) || (exited_ && now > drain_deadline_ns_)) {
+            break;   // Something still holds the pipe open; give up on it
+        }
+        pollfd ready{fd, POLLIN, 0};
+        int polled = ::poll(&ready, 1, kPollMs);
+        if (polled < 0 && errno != EINTR) {
+            break;
+        }
+        if (polled <= 0) {
+            continue;
+        }
+
+        ssize_t got = ::read(fd, text + pending, max_text_bytes_ - pending);
+        if (got < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        bytes_.fetch_add(static_cast<uint64_t>(got), std::memory_order_relaxed);
+
+        // Queue everything up to the last newline; a line filling the whole
+        // buffer goes out as is and the next record continues it
+        size_t filled = pending + static_cast<size_t>(got);
+        const char* last = static_cast<const char*>(
+            ::memrchr(text + pending, '\n', static_cast<size_t>(got)));
+        size_t cut = last ? static_cast<size_t>(last - text) + 1 : 0;
+        if (!last && filled < max_text_bytes_) {
+            pending = filled;
+            continue;
+        }
+        if (!last) {
+            cut = filled;
+        }
+        enqueue(queue, record.data(), stream_id, cut, continued);
+        continued = !last;
+        std::memmove(text, text + cut, filled - cut);
+        pending = filled - cut;
+    }
+
+    // An unterminated last line still ends a line in the log; pending is
+    // always below max_text_bytes_ here
+    if (pending > 0) {
+        text[pending] = '\n';
+        enqueue(queue, record.data(), stream_id, pending + 1, continued);
+    }
+
+    // The last stream to close reaps the child and logs how it ended
+    if (open_streams_.fetch_sub(1) != 1) {
+        return;
+    }
+    if (!reap(!stopping_)) {
+        ::kill(pid_, SIGKILL);
+        reap(true);
+    }
+    std::lock_guard<std::mutex> lock(reap_mutex_);
+    int status = exit_status_;
+    std::string line = "Child " + std::to_string(child_id_) + ": ";
+    if (reap_failed_) {
+        line += "could not be reaped\n";
+    } else if (WIFSIGNALED(status)) {
+        line += "killed by signal " + std::to_string(WTERMSIG(status)) + "\n";
+    } else {
+        line += "exited with status " + std::to_string(WEXITSTATUS(status)) + "\n";
+    }
+
+    RecordHeader header{};
+    header.kind = RecordKind::Text;
+    header.channel = channels_[0];   // How the child ended goes with its stdout
+    header.thread_id = stream_id;
+    header.timestamp_ns = nowNanoseconds();
+    std::string exit_record(sizeof(header) + line.size(), '\0');
+    std::memcpy(exit_record.data(), &header, sizeof(header));
+    std::memcpy(exit_record.data() + sizeof(header), line.data(), line.size());
+    queue.pushWait(exit_record.data(), static_cast<uint32_t>(exit_record.size()),
+                   std::chrono::milliseconds(GlobalState::getBlockTimeoutMs()));
+}
+
+bool ChildCapture::reap(bool block) {
+    std::lock_guard<std::mutex> lock(reap_mutex_);
+    if (exited_) {
+        return true;
+    }
+    pid_t reaped;
+    do {
+        reaped = ::waitpid(pid_, &exit_status_, block ? 0 : WNOHANG);
+    } while (reaped < 0 && errno == EINTR);
+    if (reaped == 0) {
+        return false;
+    }
+    reap_failed_ = reaped < 0;
+    drain_deadline_ns_ = steadyNanoseconds() +
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(kDrainGrace).count();
+    exited_ = true;
+    return true;
+}
+
+void ChildCapture::enqueue(SegmentQueue& queue, char* record, uint32_t stream_id,
+                           size_t text_length, bool continued) {
+    RecordHeader header{};
+    header.kind = RecordKind::Capture;
+    header.continued = continued ? 1 : 0;
+    header.channel = channels_[stream_id & 1];
+    header.thread_id = stream_id;
+    header.timestamp_ns = nowNanoseconds();
+    std::memcpy(record, &header, sizeof(header));
+
+    const char* text = record + sizeof(header);
+    lines_.fetch_add(static_cast<uint64_t>(std::count(text, text + text_length, '\n')),
+                     std::memory_order_relaxed);
+
+    uint32_t size = static_cast<uint32_t>(sizeof(header) + text_length);
+    if (GlobalState::getOverflowPolicy() == OverflowPolicy::Block) {
+        queue.pushWait(record, size, std::chrono::milliseconds(GlobalState::getBlockTimeoutMs()));
+    } else {
+        queue.push(record, size);
+    }
+}
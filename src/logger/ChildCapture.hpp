@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include "SegmentQueue.hpp"
+
+// Runs a shell command as a child process and logs what it prints.
+//
+// stdout and stderr each go to a pipe with one reader thread. A reader takes
+// whatever the pipe holds in one read(), cuts it after the last complete
+// line and queues that as a single Capture record, so the writer prefixes
+// timestamps only at line boundaries and a line is never split across
+// records (unless it is longer than a whole record). The queues follow the
+// producers' overflow policy: with --overflow=block a slow log fills the
+// pipe and the child blocks in write().
+//
+// The child counts as finished once it is reaped, not once its pipes close:
+// a background grandchild may hold them open indefinitely. What is left in
+// the pipes is still read for a grace period after that.
+class ChildCapture {
+public:
+    // Constructor takes the child's index (used in its log prefix), the
+    // command for /bin/sh -c, one queue per stream, the largest record and
+    // the channel each stream's records are tagged with
+    ChildCapture(int child_id, const std::string& command, SegmentQueue& out_queue,
+                 SegmentQueue& err_queue, size_t max_record_bytes, uint16_t out_channel = 0,
+                 uint16_t err_channel = 0);
+
+    // Destructor stops the child and joins the readers
+    ~ChildCapture();
+
+    // Non-copyable
+    ChildCapture(const ChildCapture&) = delete;
+    ChildCapture& operator=(const ChildCapture&) = delete;
+
+    // Spawn the child and start reading its output; throws on failure
+    void start();
+
+    // Send SIGTERM if the child still runs, read what is left (for at most
+    // a grace period) and reap it
+    void stop();
+
+    // True once the child has been reaped; its output may still be draining
+    bool finished() const { return exited_.load(); }
+
+    // Statistics, safe to read from any thread
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t lines() const { return lines_.load(std::memory_order_relaxed); }
+    pid_t pid() const { return pid_; }
+
+private:
+    // Reader thread: move one pipe into its queue until EOF
+    void readStream(int fd, SegmentQueue& queue, uint32_t stream_id);
+
+    // Reap the child if it has exited, or wait for it if block is set; true
+    // once it is reaped
+    bool reap(bool block);
+
+    // Fill in the header of a Capture record whose text is already in place
+    // after it and queue it; continued marks text that starts mid-line
+    void enqueue(SegmentQueue& queue, char* record, uint32_t stream_id, size_t text_length,
+                 bool continued);
+
+    int child_id_;
+    std::string command_;
+    SegmentQueue& out_queue_;
+    SegmentQueue& err_queue_;
+    size_t max_text_bytes_;
+    uint16_t channels_[2];   // By stream
+
+    pid_t pid_ = -1;
+    int out_fd_ = -1;
+    int err_fd_ = -1;
+    std::thread out_reader_;
+    std::thread err_reader_;
+    std::atomic<int> open_streams_{0};
+    std::atomic<bool> exited_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<int64_t> stop_deadline_ns_{0};
+    std::atomic<int64_t> drain_deadline_ns_{0};
+    std::mutex reap_mutex_;
+    int exit_status_ = 0;          // Guarded by reap_mutex_
+    bool reap_failed_ = false;     // Guarded by reap_mutex_
+
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> lines_{0};
+};
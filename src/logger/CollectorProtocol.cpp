@@ -0,0 +1,107 @@
+#include "CollectorProtocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void CollectorProtocol::encode(std::string& out, MessageType type, uint64_t sequence,
+                               std::string_view payload) {
+    MessageHeader header{kMagic, kVersion, type, sequence};
+    out.resize(sizeof(header) + payload.size());
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), payload.data(), payload.size());
+}
+
+void CollectorProtocol::encodeBatch(std::string& out, uint64_t sequence, std::string_view source,
+                                    std::string_view lines) {
+    MessageHeader header{kMagic, kVersion, MessageType::Batch, sequence};
+    uint16_t source_length = static_cast<uint16_t>(source.size());
+    out.resize(sizeof(header) + sizeof(source_length) + source.size() + lines.size());
+    char* p = out.data();
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    std::memcpy(p, &source_length, sizeof(source_length));
+    p += sizeof(source_length);
+    std::memcpy(p, source.data(), source.size());
+    p += source.size();
+    std::memcpy(p, lines.data(), lines.size());
+}
+
+bool CollectorProtocol::splitBatch(std::string_view payload, std::string_view& source,
+                                   std::string_view& lines) {
+    uint16_t source_length;
+    if (payload.size() < sizeof(source_length)) {
+        return false;
+    }
+    std::memcpy(&source_length, payload.data(), sizeof(source_length));
+    payload.remove_prefix(sizeof(source_length));
+    if (payload.size() < source_length) {
+        return false;
+    }
+    source = payload.substr(0, source_length);
+    lines = payload.substr(source_length);
+    return true;
+}
+
+bool CollectorProtocol::decode(const char* data, size_t size, Message& message) {
+    MessageHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) {
+        return false;
+    }
+    message.type = header.type;
+    message.sequence = header.sequence;
+    message.payload = std::string_view(data + sizeof(header), size - sizeof(header));
+    return true;
+}
+
+int CollectorProtocol::connect(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("collector socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Error creating collector socket: " + std::string(std::strerror(errno)));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        int saved = errno;
+        ::close(fd);
+        throw std::runtime_error("Error connecting to collector " + path + ": " + std::strerror(saved));
+    }
+    return fd;
+}
+
+bool CollectorProtocol::send(int fd, const std::string& message, int timeout_ms) {
+    int flags = MSG_NOSIGNAL | (timeout_ms >= 0 ? MSG_DONTWAIT : 0);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    for (;;) {
+        ssize_t sent = ::send(fd, message.data(), message.size(), flags);
+        if (sent >= 0) {
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (timeout_ms < 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            return false;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd waiter{fd, POLLOUT, 0};
+        if (left.count() <= 0 || ::poll(&waiter, 1, static_cast<int>(left.count())) == 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Messages exchanged with a local log collector over a SOCK_SEQPACKET unix
+// socket. Each datagram is one message: a 16-byte header, then a payload.
+//
+//   Hello  client -> collector  payload: application name; first message
+//   Batch  client -> collector  sequence: 1, 2, ... per connection
+//                               payload: u16 source length, source name,
+//                               then whole lines of log text
+//   Ack    collector -> client  sequence: every batch up to it is written
+//   Pace   collector -> client  sequence: microseconds to leave between
+//                               batches (0 = full speed)
+//
+// A client may keep several batches in flight; what is not acked when the
+// connection drops is sent again, so delivery is at least once.
+namespace CollectorProtocol {
+    constexpr uint32_t kMagic = 0x4C4F434C;            // "LCOL" on the wire
+    constexpr uint16_t kVersion = 1;
+    constexpr size_t kMaxMessageBytes = 64 * 1024;     // Header included
+
+    enum class MessageType : uint16_t {
+        Hello = 1,
+        Batch = 2,
+        Ack = 3,
+        Pace = 4
+    };
+
+    struct MessageHeader {
+        uint32_t magic;
+        uint16_t version;
+        MessageType type;
+        uint64_t sequence;
+    };
+    static_assert(sizeof(MessageHeader) == 16, "message header is part of the wire format");
+
+    // A received message; payload points into the receive buffer
+    struct Message {
+        MessageType type;
+        uint64_t sequence;
+        std::string_view payload;
+    };
+
+    // Room left for lines in a Batch from this source
+    inline size_t batchCapacity(std::string_view source) {
+        return kMaxMessageBytes - sizeof(MessageHeader) - sizeof(uint16_t) - source.size();
+    }
+
+    // Encode a message into out (replacing its contents)
+    void encode(std::string& out, MessageType type, uint64_t sequence, std::string_view payload = {});
+
+    // Encode a Batch of lines from source
+    void encodeBatch(std::string& out, uint64_t sequence, std::string_view source, std::string_view lines);
+
+    // Split a Batch payload; returns false if it is malformed
+    bool splitBatch(std::string_view payload, std::string_view& source, std::string_view& lines);
+
+    // Parse one datagram; returns false if it is not a valid message
+    bool decode(const char* data, size_t size, Message& message);
+
+    // Connect to a collector socket; throws on failure
+    int connect(const std::string& path);
+
+    // Send one encoded message; returns false when the connection is gone.
+    // With timeout_ms >= 0 a full socket buffer is waited on that long at
+    // most, then it fails with ETIMEDOUT.
+    bool send(int fd, const std::string& message, int timeout_ms = -1);
+}
@@ -0,0 +1,243 @@
+#include "CollectorSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "CollectorProtocol.hpp"
+#include "LineScan.hpp"
+
+namespace {
+    constexpr auto kReconnectInterval = std::chrono::seconds(1);
+
+    // A collector that acks nothing for this long, without having asked
+    // us to slow down, is given up on
+    constexpr auto kAckTimeout = std::chrono::seconds(5);
+    constexpr int kSendTimeoutMs = 5000;
+
+    // Slice of a blocked send between checks on a pausing collector
+    constexpr int kSendSliceMs = 100;
+}
+
+CollectorSink::CollectorSink(const std::string& socket_path, const std::string& app,
+                             std::unique_ptr<FileSink> fallback)
+    : socket_path_(socket_path), app_(app), fallback_(std::move(fallback)) {
+    if (!connect()) {
+        std::cerr << "Warning: collector " << socket_path_ << " unreachable; logging to "
+                  << fallback_->path() << " until it is back\n";
+    }
+}
+
+CollectorSink::~CollectorSink() {
+    if (fd_ >= 0) {
+        // Give the collector a moment to ack the tail; the rest stays local
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (!in_flight_.empty() && std::chrono::steady_clock::now() < deadline && readReplies(100)) {
+        }
+        if (in_flight_.empty()) {
+            ::close(fd_);
+        } else {
+            disconnect("shutting down");
+        }
+    }
+}
+
+bool CollectorSink::write(const char* data, size_t size) {
+    size_t capacity = CollectorProtocol::batchCapacity(fallback_->path());
+    size_t offset = 0;
+    while (fd_ >= 0 && offset < size) {
+        size_t length = std::min(size - offset, capacity);
+        if (offset + length < size) {
+            // Whole lines per message; a longer line is split
+            size_t end = LineScan::scan(data + offset, length).end;
+            length = end > 0 ? end : length;
+        }
+        if (!sendLines(std::string_view(data + offset, length))) {
+            disconnect(std::strerror(errno));
+            break;
+        }
+        offset += length;
+    }
+    if (offset < size) {
+        return writeFallback(data + offset, size - offset);
+    }
+    return true;
+}
+
+void CollectorSink::maintain() {
+    fallback_->maintain();
+    if (fd_ >= 0) {
+        if (!readReplies(0)) {
+            disconnect("connection closed by the collector");
+        }
+        return;
+    }
+    if (std::chrono::steady_clock::now() >= next_connect_ && connect()) {
+        std::cerr << "Collector " << socket_path_ << " is back; leaving " << fallback_->path() << "\n";
+    }
+}
+
+void CollectorSink::appendStats(std::ostream& out) const {
+    out << "collector.connected=" << (connected_.load() ? 1 : 0) << "\n"
+        << "collector.connects=" << connects_.load() << "\n"
+        << "collector.messages=" << messages_.load() << "\n"
+        << "collector.sent_bytes=" << sent_bytes_.load() << "\n"
+        << "collector.acked_bytes=" << acked_bytes_.load() << "\n"
+        << "collector.fallback_bytes=" << fallback_bytes_.load() << "\n"
+        << "collector.paced_us=" << paced_us_.load() << "\n";
+}
+
+bool CollectorSink::connect() {
+    next_connect_ = std::chrono::steady_clock::now() + kReconnectInterval;
+    try {
+        fd_ = CollectorProtocol::connect(socket_path_);
+    } catch (const std::exception&) {
+        return false;
+    }
+    CollectorProtocol::encode(message_, CollectorProtocol::MessageType::Hello, 0, app_);
+    if (!CollectorProtocol::send(fd_, message_, kSendTimeoutMs)) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    ucred peer{};
+    socklen_t peer_length = sizeof(peer);
+    peer_pid_ = ::getsockopt(fd_, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) == 0 ? peer.pid : -1;
+    sequence_ = 0;
+    pace_us_ = 0;
+    connected_ = true;
+    connects_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CollectorSink::disconnect(const char* reason) {
+    ::close(fd_);
+    fd_ = -1;
+    connected_ = false;
+    next_connect_ = std::chrono::steady_clock::now() + kReconnectInterval;
+    std::cerr << "Warning: collector connection lost (" << reason << "); logging to " << fallback_->path()
+              << ", starting with " << in_flight_bytes_ << " unacked bytes\n";
+    // At least once: the collector may have written some of these already
+    for (const auto& batch : in_flight_) {
+        writeFallback(batch.lines.data(), batch.lines.size());
+    }
+    in_flight_.clear();
+    in_flight_bytes_ = 0;
+}
+
+bool CollectorSink::readReplies(int timeout_ms) {
+    char buffer[CollectorProtocol::kMaxMessageBytes];
+    for (;;) {
+        ssize_t got = ::recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && timeout_ms > 0) {
+            pollfd waiter{fd_, POLLIN, 0};
+            if (::poll(&waiter, 1, timeout_ms) > 0) {
+                timeout_ms = 0;   // One wait per call; take what arrived and return
+                continue;
+            }
+            return true;
+        }
+        if (got < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        if (got == 0) {
+            return false;
+        }
+        CollectorProtocol::Message message;
+        if (!CollectorProtocol::decode(buffer, static_cast<size_t>(got), message)) {
+            continue;
+        }
+        if (message.type == CollectorProtocol::MessageType::Ack) {
+            while (!in_flight_.empty() && in_flight_.front().sequence <= message.sequence) {
+                in_flight_bytes_ -= in_flight_.front().lines.size();
+                acked_bytes_.fetch_add(in_flight_.front().lines.size(), std::memory_order_relaxed);
+                in_flight_.pop_front();
+            }
+        } else if (message.type == CollectorProtocol::MessageType::Pace) {
+            pace_us_ = message.sequence;
+        }
+    }
+}
+
+bool CollectorSink::keepWaiting(std::chrono::steady_clock::time_point& deadline) {
+    auto now = std::chrono::steady_clock::now();
+    if (pace_us_ > 0) {
+        // Paused by the collector: that is pacing, not a failure, so wait
+        // for as long as it runs
+        if (peer_pid_ > 0 && ::kill(peer_pid_, 0) != 0 && errno == ESRCH) {
+            errno = ECONNRESET;
+            return false;
+        }
+        deadline = now + kAckTimeout;
+        return true;
+    }
+    if (now >= deadline) {
+        errno = ETIMEDOUT;
+        return false;
+    }
+    return true;
+}
+
+bool CollectorSink::sendLines(std::string_view lines) {
+    // Too much unacked: wait for the collector to catch up
+    auto deadline = std::chrono::steady_clock::now() + kAckTimeout;
+    while (in_flight_bytes_ + lines.size() > kMaxInFlight) {
+        size_t before = in_flight_bytes_;
+        if (!readReplies(100)) {
+            errno = ECONNRESET;
+            return false;
+        }
+        if (in_flight_bytes_ < before) {
+            deadline = std::chrono::steady_clock::now() + kAckTimeout;
+        } else if (!keepWaiting(deadline)) {
+            return false;
+        }
+    }
+    if (!readReplies(0)) {
+        errno = ECONNRESET;
+        return false;
+    }
+    if (pace_us_ > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(pace_us_));
+        paced_us_.fetch_add(pace_us_, std::memory_order_relaxed);
+    }
+
+    // A collector that stops reading us would block a plain send for good.
+    // Send in slices, watching for acks, pace changes and a closed
+    // connection in between; only a stall nobody asked for falls back to
+    // the local file.
+    CollectorProtocol::encodeBatch(message_, ++sequence_, fallback_->path(), lines);
+    while (!CollectorProtocol::send(fd_, message_, kSendSliceMs)) {
+        if (errno != ETIMEDOUT) {
+            return false;
+        }
+        size_t before = in_flight_bytes_;
+        if (!readReplies(0)) {
+            errno = ECONNRESET;
+            return false;
+        }
+        if (in_flight_bytes_ < before) {
+            deadline = std::chrono::steady_clock::now() + kAckTimeout;
+        } else if (!keepWaiting(deadline)) {
+            return false;
+        }
+    }
+    in_flight_.push_back(InFlight{sequence_, std::string(lines)});
+    in_flight_bytes_ += lines.size();
+    sent_bytes_.fetch_add(lines.size(), std::memory_order_relaxed);
+    messages_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CollectorSink::writeFallback(const char* data, size_t size) {
+    if (!fallback_->write(data, size)) {
+        return false;
+    }
+    fallback_bytes_.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include "FileSink.hpp"
+#include "LogSink.hpp"
+
+// Sink that hands the log to a local collector (logcollect) instead of
+// writing a file of its own.
+//
+// Each writer batch is cut at line boundaries into collector messages and
+// sent over a SOCK_SEQPACKET connection. Sent lines are kept until the
+// collector acks them; more than kMaxInFlight unacked bytes make write()
+// wait for acks, and a Pace message from an overloaded collector spaces the
+// messages out. A collector that has paused us is waited on for as long as
+// it runs; one that neither acks nor takes a send for a few seconds without
+// having asked for that is given up on.
+// While the collector cannot be reached the batches go to the local log
+// file instead, together with whatever was still unacked when the
+// connection dropped, and maintain() tries to reconnect once a second.
+class CollectorSink : public LogSink {
+public:
+    static constexpr size_t kMaxInFlight = 4u << 20;
+
+    // Constructor takes the collector socket, the application name the
+    // collector files the log under, and the local fallback file
+    CollectorSink(const std::string& socket_path, const std::string& app, std::unique_ptr<FileSink> fallback);
+
+    // Destructor closes the connection
+    ~CollectorSink() override;
+
+    // Non-copyable
+    CollectorSink(const CollectorSink&) = delete;
+    CollectorSink& operator=(const CollectorSink&) = delete;
+
+    // Send the buffer to the collector, or write it to the fallback file
+    bool write(const char* data, size_t size) override;
+
+    const std::string& path() const override { return fallback_->path(); }
+
+    void maintain() override;
+    void appendStats(std::ostream& out) const override;
+
+private:
+    struct InFlight {
+        uint64_t sequence;
+        std::string lines;
+    };
+
+    // Connect and say hello; false (and a retry later) when unreachable
+    bool connect();
+
+    // Drop the connection; unacked lines go to the fallback file
+    void disconnect(const char* reason);
+
+    // Handle the collector's acks and pace requests, waiting up to
+    // timeout_ms for one; false when the connection is gone
+    bool readReplies(int timeout_ms);
+
+    // Send one message worth of lines
+    bool sendLines(std::string_view lines);
+
+    // While acks or a send are awaited: true to keep waiting, pushing
+    // deadline out while the collector paces us and is still running
+    bool keepWaiting(std::chrono::steady_clock::time_point& deadline);
+
+    bool writeFallback(const char* data, size_t size);
+
+    std::string socket_path_;
+    std::string app_;
+    std::unique_ptr<FileSink> fallback_;
+
+    int fd_ = -1;
+    pid_t peer_pid_ = -1;             // The collector process, from SO_PEERCRED
+    uint64_t sequence_ = 0;
+    uint64_t pace_us_ = 0;
+    std::deque<InFlight> in_flight_;
+    size_t in_flight_bytes_ = 0;
+    std::string message_;
+    std::chrono::steady_clock::time_point next_connect_;
+
+    // Stats, readable from any thread
+    std::atomic<bool> connected_{false};
+    std::atomic<uint64_t> sent_bytes_{0};
+    std::atomic<uint64_t> acked_bytes_{0};
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> fallback_bytes_{0};
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> paced_us_{0};
+};
@@ -0,0 +1,203 @@
+#include "ControlServer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Longest request line accepted from a client
+    constexpr size_t kMaxLine = 4096;
+
+    // Clients served at once; more wait in the listen backlog
+    constexpr size_t kMaxClients = 32;
+
+    // A client that neither sends nor reads for this long is dropped
+    constexpr auto kClientIdle = std::chrono::seconds(30);
+}
+
+ControlServer::ControlServer(const std::string& path) : path_(path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("control socket path is too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Error creating control socket");
+    }
+    ::unlink(path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 8) != 0) {
+        ::close(listen_fd_);
+        throw std::runtime_error("Error binding control socket: " + path);
+    }
+    if (::pipe2(wake_pipe_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        ::close(listen_fd_);
+        throw std::runtime_error("Error creating control wake pipe");
+    }
+}
+
+ControlServer::ControlServer(const std::string& path, int listen_fd) : path_(path), listen_fd_(listen_fd) {
+    if (::pipe2(wake_pipe_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        ::close(listen_fd_);
+        throw std::runtime_error("Error creating control wake pipe");
+    }
+}
+
+ControlServer::~ControlServer() {
+    stop();
+    ::close(wake_pipe_[0]);
+    ::close(wake_pipe_[1]);
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+    }
+}
+
+int ControlServer::release() {
+    stop();
+    int fd = listen_fd_;
+    listen_fd_ = -1;
+    return fd;
+}
+
+void ControlServer::addCommand(const std::string& name, Handler handler) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    handlers_[name] = std::move(handler);
+}
+
+void ControlServer::start() {
+    thread_ = std::thread(&ControlServer::run, this);
+}
+
+void ControlServer::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    char byte = 0;
+    [[maybe_unused]] ssize_t ignored = ::write(wake_pipe_[1], &byte, 1);
+    thread_.join();
+}
+
+void ControlServer::run() {
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+    for (;;) {
+        fds.clear();
+        fds.push_back({wake_pipe_[0], POLLIN, 0});
+        fds.push_back({listen_fd_, static_cast<short>(clients.size() < kMaxClients ? POLLIN : 0), 0});
+        for (const Client& client : clients) {
+            // A client with replies pending is not read until it takes them
+            fds.push_back({client.fd, static_cast<short>(client.out.empty() ? POLLIN : POLLOUT), 0});
+        }
+        if (::poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = clients.size(); i-- > 0;) {
+            Client& client = clients[i];
+            short events = fds[i + 2].revents;
+            bool keep = true;
+            if (events & (POLLIN | POLLHUP | POLLERR)) {
+                keep = readClient(client);
+            } else if (events & POLLOUT) {
+                keep = writeClient(client);
+            } else if (now - client.active >= kClientIdle) {
+                keep = false;
+            }
+            if (keep && events) {
+                client.active = now;
+            }
+            if (!keep) {
+                ::close(client.fd);
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd >= 0) {
+                clients.push_back(Client{fd, {}, {}, now});
+            }
+        }
+    }
+    for (const Client& client : clients) {
+        ::close(client.fd);
+    }
+}
+
+bool ControlServer::readClient(Client& client) {
+    char chunk[1024];
+    ssize_t got = ::recv(client.fd, chunk, sizeof(chunk), 0);
+    if (got < 0) {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (got == 0) {
+        // Replies still go out to a client that only shut down its side
+        return !client.out.empty() && writeClient(client);
+    }
+    client.in.append(chunk, static_cast<size_t>(got));
+
+    size_t newline;
+    while ((newline = client.in.find('\n')) != std::string::npos) {
+        std::string line = client.in.substr(0, newline);
+        client.in.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        client.out += dispatch(line);
+    }
+    if (client.in.size() > kMaxLine) {
+        client.out += "error: request too long\n";
+        writeClient(client);
+        return false;
+    }
+    return writeClient(client);
+}
+
+bool ControlServer::writeClient(Client& client) {
+    while (!client.out.empty()) {
+        ssize_t sent = ::send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.out.erase(0, static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+std::string ControlServer::dispatch(const std::string& line) {
+    auto space = line.find(' ');
+    std::string name = line.substr(0, space);
+    std::string args = space == std::string::npos ? "" : line.substr(space + 1);
+
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex_);
+        auto it = handlers_.find(name);
+        if (it == handlers_.end()) {
+            return "error: unknown command: " + name + "\n";
+        }
+        handler = it->second;
+    }
+
+    try {
+        return handler(args) + "ok\n";
+    } catch (const std::exception& e) {
+        return std::string("error: ") + e.what() + "\n";
+    }
+}
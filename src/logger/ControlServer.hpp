@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Line-oriented control socket (AF_UNIX stream) for a running logger.
+//
+// Each request is one line: "<command> [arguments]". The reply is zero or
+// more "key=value" lines followed by "ok" or "error: <message>". A client
+// may send several commands on one connection.
+//
+// One thread serves every client from a poll set, so a client that stays
+// connected without sending, or stops reading its replies, holds up no
+// one else; clients idle for kClientIdle are disconnected.
+class ControlServer {
+public:
+    // Handler gets the argument text and returns the reply body.
+    // Throwing std::exception turns into an "error:" reply.
+    using Handler = std::function<std::string(const std::string& args)>;
+
+    // Constructor binds and listens on path (replacing a stale socket)
+    explicit ControlServer(const std::string& path);
+
+    // Constructor adopting a socket already listening on path
+    ControlServer(const std::string& path, int listen_fd);
+
+    // Destructor stops the server and removes the socket file
+    ~ControlServer();
+
+    // Non-copyable
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Register a command; may be called before or after start()
+    void addCommand(const std::string& name, Handler handler);
+
+    // Start and stop the server thread
+    void start();
+    void stop();
+
+    // Stop and hand the listening socket to the caller; the socket file
+    // stays in place so clients keep connecting to it
+    int release();
+
+    // Accessors
+    const std::string& path() const { return path_; }
+    int listenFd() const { return listen_fd_; }
+
+private:
+    struct Client {
+        int fd;
+        std::string in;    // Received, not yet a whole line
+        std::string out;   // Replies not yet sent
+        std::chrono::steady_clock::time_point active;
+    };
+
+    // Server thread main loop
+    void run();
+
+    // Read what the client sent and queue the replies; false to disconnect
+    bool readClient(Client& client);
+
+    // Send queued replies as far as the socket takes them; false to disconnect
+    bool writeClient(Client& client);
+
+    // Execute one request line and build the reply
+    std::string dispatch(const std::string& line);
+
+    std::string path_;
+    int listen_fd_ = -1;
+    int wake_pipe_[2] = {-1, -1};
+
+    std::mutex handlers_mutex_;
+    std::map<std::string, Handler> handlers_;
+
+    std::thread thread_;
+};
@@ -0,0 +1,76 @@
+#include "Crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+    // Reflected Castagnoli polynomial
+    constexpr uint32_t kPolynomial = 0x82F63B78u;
+
+    constexpr std::array<uint32_t, 256> makeTable() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    constexpr auto kTable = makeTable();
+
+    uint32_t extendSoftware(uint32_t crc, const uint8_t* p, size_t n) {
+        while (n--) {
+            crc = kTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    uint32_t extendHardware(uint32_t crc, const uint8_t* p, size_t n) {
+        uint64_t crc64 = crc;
+        while (n >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+            p += 8;
+            n -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (n--) {
+            crc = _mm_crc32_u8(crc, *p++);
+        }
+        return crc;
+    }
+
+    bool detectHardware() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2");
+    }
+#else
+    bool detectHardware() { return false; }
+#endif
+
+    const bool has_hardware = detectHardware();
+}
+
+uint32_t Crc32c::extend(uint32_t crc, const void* data, size_t length) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (has_hardware) {
+        return ~extendHardware(crc, p, length);
+    }
+#endif
+    return ~extendSoftware(crc, p, length);
+}
+
+bool Crc32c::isHardwareAccelerated() {
+    return has_hardware;
+}
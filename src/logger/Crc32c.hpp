@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli) checksum used by the framed log format.
+// Uses the SSE4.2 crc32 instruction when the CPU supports it and falls back
+// to a table-driven implementation otherwise.
+namespace Crc32c {
+    // Extend a running checksum with more data (start with 0)
+    uint32_t extend(uint32_t crc, const void* data, size_t length);
+
+    // Checksum a single buffer
+    inline uint32_t compute(const void* data, size_t length) {
+        return extend(0, data, length);
+    }
+
+    // True when the SSE4.2 path is in use
+    bool isHardwareAccelerated();
+}
@@ -0,0 +1,102 @@
+#include "DecimalFormat.hpp"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint64_t kTen8 = 100000000ull;
+    constexpr uint64_t kTen16 = kTen8 * kTen8;
+
+    void convertScalar(uint64_t value, DecimalFormat::Digits& out) {
+        char* end = out.buffer + sizeof(out.buffer);
+        char* p = end;
+        do {
+            *--p = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        out.length = static_cast<uint8_t>(end - p);
+    }
+
+#if defined(__SSE2__)
+    // Constants for splitting abcdefgh into eight 16-bit digit lanes.
+    // abcd/efgh are scaled by 4, then multiply-high by 2^k/10^n and a
+    // per-lane shift leaves [a, ab, abc, abcd, e, ef, efg, efgh].
+    alignas(16) const uint32_t kDiv10000[4] = {0xD1B71759, 0xD1B71759, 0xD1B71759, 0xD1B71759};
+    alignas(16) const uint32_t k10000[4] = {10000, 10000, 10000, 10000};
+    alignas(16) const uint16_t kDivPowers[8] = {8389, 5243, 13108, 32768, 8389, 5243, 13108, 32768};
+    alignas(16) const uint16_t kShiftPowers[8] = {1 << 7, 1 << 11, 1 << 13, 1 << 15,
+                                                  1 << 7, 1 << 11, 1 << 13, 1 << 15};
+    alignas(16) const uint16_t k10[8] = {10, 10, 10, 10, 10, 10, 10, 10};
+
+    inline __m128i load(const void* p) {
+        return _mm_load_si128(static_cast<const __m128i*>(p));
+    }
+
+    // value < 10^8 -> eight 16-bit lanes holding one decimal digit each
+    inline __m128i convert8Digits(uint32_t value) {
+        const __m128i abcdefgh = _mm_cvtsi32_si128(static_cast<int>(value));
+        const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, load(kDiv10000)), 45);
+        const __m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, load(k10000)));
+
+        const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+        const __m128i v2a = _mm_unpacklo_epi16(v1, v1);
+        const __m128i v2 = _mm_unpacklo_epi32(v2a, v2a);
+
+        const __m128i v3 = _mm_mulhi_epu16(v2, load(kDivPowers));
+        const __m128i v4 = _mm_mulhi_epu16(v3, load(kShiftPowers));
+        const __m128i v5 = _mm_mullo_epi16(v4, load(k10));
+        const __m128i v6 = _mm_slli_epi64(v5, 16);
+        return _mm_sub_epi16(v4, v6);
+    }
+
+    // value < 10^16 -> 16 zero-padded ASCII digits stored at out;
+    // returns the number of significant digits
+    inline size_t convert16Digits(uint64_t value, char* out) {
+        const __m128i high = convert8Digits(static_cast<uint32_t>(value / kTen8));
+        const __m128i low = convert8Digits(static_cast<uint32_t>(value % kTen8));
+        const __m128i ascii = _mm_add_epi8(_mm_packus_epi16(high, low), _mm_set1_epi8('0'));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), ascii);
+
+        // Leading '0' bytes are the low set bits of the mask
+        unsigned zeros = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(ascii, _mm_set1_epi8('0'))));
+        unsigned leading = static_cast<unsigned>(__builtin_ctz(~zeros | 0x10000u));
+        return leading >= 16 ? 1 : 16 - leading;
+    }
+#endif
+}
+
+void DecimalFormat::convertBatch(const uint64_t* values, size_t count, Digits* out) {
+#if defined(__SSE2__)
+    constexpr size_t kTail = sizeof(Digits::buffer) - 16;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t value = values[i];
+        Digits& digits = out[i];
+        if (value < kTen16) {
+            digits.length = static_cast<uint8_t>(convert16Digits(value, digits.buffer + kTail));
+        } else {
+            // Top 1-4 digits scalar, remaining 16 with the kernel
+            convert16Digits(value % kTen16, digits.buffer + kTail);
+            uint64_t top = value / kTen16;
+            char* p = digits.buffer + kTail;
+            do {
+                *--p = static_cast<char>('0' + top % 10);
+                top /= 10;
+            } while (top);
+            digits.length = static_cast<uint8_t>(digits.buffer + sizeof(digits.buffer) - p);
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        convertScalar(values[i], out[i]);
+    }
+#endif
+}
+
+size_t DecimalFormat::format(uint64_t value, char* out) {
+    Digits digits;
+    convertScalar(value, digits);
+    std::memcpy(out, digits.data(), digits.length);
+    return digits.length;
+}
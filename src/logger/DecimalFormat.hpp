@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Integer-to-decimal conversion for the writer's batch formatter.
+// convertBatch() renders many values per call with SSE2 kernels that turn
+// eight digits at a time into ASCII; other targets use a scalar loop.
+namespace DecimalFormat {
+    constexpr size_t kMaxDigits = 20;  // UINT64_MAX has 20 digits
+
+    // Decimal digits of one value, right-aligned in a fixed buffer
+    struct Digits {
+        char buffer[24];
+        uint8_t length;
+
+        const char* data() const { return buffer + sizeof(buffer) - length; }
+    };
+
+    // Convert count values into out[0..count)
+    void convertBatch(const uint64_t* values, size_t count, Digits* out);
+
+    // Convert one value (scalar); writes the digits to out and returns their count
+    size_t format(uint64_t value, char* out);
+}
@@ -0,0 +1,216 @@
+#include "FileSink.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace {
+    // A pipe or socket whose reader is gone raises SIGPIPE in the writing
+    // thread. That is the writer thread, or in lazy mode any producer, so
+    // each thread blocks it in itself before its first redirected write and
+    // throws away what is pending after each failed write. Neither the
+    // process nor the children it runs see a changed disposition.
+    thread_local bool sigpipe_blocked = false;
+
+    sigset_t sigpipeSet() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGPIPE);
+        return set;
+    }
+
+    void blockSigpipe() {
+        if (!sigpipe_blocked) {
+            sigset_t set = sigpipeSet();
+            ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+            sigpipe_blocked = true;
+        }
+    }
+
+    void discardSigpipe() {
+        sigset_t set = sigpipeSet();
+        timespec zero{};
+        while (::sigtimedwait(&set, nullptr, &zero) > 0) {
+        }
+    }
+}
+
+FileSink::FileSink(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Error opening log file: " + path);
+    }
+}
+
+FileSink::FileSink(const std::string& path, int fd) : path_(path), fd_(fd) {}
+
+FileSink::~FileSink() {
+    if (pending_fd_ >= 0) {
+        ::close(pending_fd_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool FileSink::write(const char* data, size_t size) {
+    if (redirect_pending_.load(std::memory_order_acquire)) {
+        applyRedirect();
+    }
+    bool redirected = redirected_.load(std::memory_order_relaxed);
+    if (redirected) {
+        blockSigpipe();
+    }
+    while (size > 0) {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!redirected) {
+                return false;
+            }
+            // The reader went away: the rest goes to the log file
+            int error = errno;
+            discardSigpipe();
+            std::string target = this->target();
+            if (!swapTo(-1, std::string())) {
+                return false;
+            }
+            fallbacks_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "Warning: writing to " << target << " failed (" << std::strerror(error)
+                      << "); back to " << path_ << "\n";
+            redirected = false;
+            continue;
+        }
+        if (redirected) {
+            redirected_bytes_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    if (writeback_ && !redirected) {
+        // With O_APPEND the file position is the end of what we just wrote
+        off_t end = ::lseek(fd_, 0, SEEK_CUR);
+        if (end >= 0) {
+            writeback_->written(static_cast<uint64_t>(end));
+        }
+    }
+    return true;
+}
+
+void FileSink::enableRetention(const RetentionPolicy& policy) {
+    retention_ = std::make_unique<LogRetention>(path_, fd_, policy);
+}
+
+void FileSink::enableWriteback(size_t dirty_max_bytes) {
+    writeback_ = std::make_unique<WritebackControl>(fd_, dirty_max_bytes);
+}
+
+bool FileSink::redirect(int target_fd, const std::string& target, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(redirect_mutex_);
+    if (pending_fd_ >= 0) {
+        ::close(pending_fd_);   // Superseded before the writer got to it
+    }
+    pending_fd_ = target_fd;
+    pending_target_ = target_fd < 0 ? std::string() : target;
+    uint64_t request = ++requested_;
+    redirect_pending_.store(true, std::memory_order_release);
+    if (!redirect_done_.wait_for(lock, timeout, [&] { return applied_ >= request; })) {
+        return false;
+    }
+    if (applied_ == request && !redirect_error_.empty()) {
+        throw std::runtime_error(redirect_error_);
+    }
+    return true;
+}
+
+std::string FileSink::target() const {
+    std::lock_guard<std::mutex> lock(redirect_mutex_);
+    return target_;
+}
+
+void FileSink::applyRedirect() {
+    std::unique_lock<std::mutex> lock(redirect_mutex_);
+    int target_fd = pending_fd_;
+    std::string target = std::move(pending_target_);
+    uint64_t request = requested_;
+    pending_fd_ = -1;
+    redirect_pending_.store(false, std::memory_order_relaxed);
+    lock.unlock();
+
+    std::string error;
+    if (target_fd >= 0 || redirected()) {
+        if (!swapTo(target_fd, target)) {
+            error = "cannot switch to " + (target.empty() ? path_ : target) + ": " + std::strerror(errno);
+        } else if (target_fd >= 0) {
+            redirects_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    lock.lock();
+    applied_ = request;
+    redirect_error_ = error;
+    redirect_done_.notify_all();
+}
+
+bool FileSink::swapTo(int target_fd, const std::string& target) {
+    if (target_fd < 0) {
+        target_fd = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (target_fd < 0) {
+            return false;
+        }
+    }
+    int result = ::dup3(target_fd, fd_, O_CLOEXEC);
+    int error = errno;
+    ::close(target_fd);
+    if (result < 0) {
+        errno = error;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(redirect_mutex_);
+        target_ = target;
+    }
+    redirected_.store(!target.empty(), std::memory_order_release);
+    return true;
+}
+
+void FileSink::markBoundary() {
+    if (retention_ && !redirected()) {
+        retention_->markBoundary();
+    }
+}
+
+void FileSink::maintain() {
+    if (redirect_pending_.load(std::memory_order_acquire)) {
+        applyRedirect();
+    }
+    if (retention_ && !redirected()) {
+        retention_->apply();
+    }
+}
+
+void FileSink::appendStats(std::ostream& out) const {
+    if (redirects_.load(std::memory_order_relaxed) > 0) {
+        std::string target = this->target();
+        out << "redirect.target=" << (target.empty() ? path_ : target) << "\n"
+            << "redirect.redirects=" << redirects_.load(std::memory_order_relaxed) << "\n"
+            << "redirect.fallbacks=" << fallbacks_.load(std::memory_order_relaxed) << "\n"
+            << "redirect.bytes=" << redirected_bytes_.load(std::memory_order_relaxed) << "\n";
+    }
+    if (writeback_) {
+        out << "cache.dirty_bytes=" << writeback_->dirtyBytes() << "\n"
+            << "cache.dropped_bytes=" << writeback_->droppedBytes() << "\n"
+            << "cache.writeback_wait_ms=" << writeback_->waitNs() / 1000000 << "\n";
+    }
+    if (retention_) {
+        out << "retention.trimmed_bytes=" << retention_->trimmedBytes() << "\n"
+            << "retention.trims=" << retention_->trims() << "\n";
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "LogRetention.hpp"
+#include "LogSink.hpp"
+#include "WritebackControl.hpp"
+
+// Append-only log file written with plain write(2) calls.
+// The descriptor stays at a fixed number for its whole life, so an external
+// hotswap that reopens it in place keeps working.
+//
+// The same holds for redirect(): the thread writing the log (the writer
+// thread, or a producer in lazy mode) dup2()s a FIFO, socket, memfd or
+// other file onto that number between two batches, so the log can
+// be streamed into an analyzer and swapped back without a restart. If the
+// target's reader goes away the sink goes back to the log file on its own
+// and writes the rest of the batch there.
+class FileSink : public LogSink {
+public:
+    // Constructor opens (or creates) the file for appending; throws on failure
+    explicit FileSink(const std::string& path);
+
+    // Constructor adopting an already open descriptor of path
+    FileSink(const std::string& path, int fd);
+
+    // Destructor closes the file
+    ~FileSink() override;
+
+    // Non-copyable
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // Write the whole buffer, retrying short writes; returns false on error
+    bool write(const char* data, size_t size) override;
+
+    // Free the oldest part of the file in place according to policy
+    void enableRetention(const RetentionPolicy& policy);
+
+    // Start writeback early and keep at most dirty_max_bytes of the file
+    // dirty in the page cache
+    void enableWriteback(size_t dirty_max_bytes);
+
+    // Write to target_fd (taken over; described as target in the stats)
+    // instead of the log file, or to the log file again when target_fd is
+    // negative. Called from any thread; returns false if the writing thread
+    // has not switched within timeout (it still will).
+    bool redirect(int target_fd, const std::string& target, std::chrono::milliseconds timeout);
+
+    // What the descriptor points at: empty for the log file itself
+    std::string target() const;
+
+    void markBoundary() override;
+    void maintain() override;
+    void appendStats(std::ostream& out) const override;
+
+    // Accessors
+    int fd() const { return fd_; }
+    const std::string& path() const override { return path_; }
+    bool redirected() const { return redirected_.load(std::memory_order_acquire); }
+
+private:
+    // Writing thread: take over a pending redirect
+    void applyRedirect();
+
+    // Writing thread: put target_fd (or the reopened log file) at fd_
+    bool swapTo(int target_fd, const std::string& target);
+
+    std::string path_;
+    int fd_;
+
+    mutable std::mutex redirect_mutex_;
+    std::condition_variable redirect_done_;
+    std::atomic<bool> redirect_pending_{false};
+    int pending_fd_ = -1;
+    std::string pending_target_;
+    uint64_t requested_ = 0;          // Redirects asked for and applied
+    uint64_t applied_ = 0;
+    std::string redirect_error_;      // Of the last applied request
+    std::string target_;              // Guarded by redirect_mutex_
+    std::atomic<bool> redirected_{false};
+    std::atomic<uint64_t> redirected_bytes_{0};
+    std::atomic<uint64_t> redirects_{0};
+    std::atomic<uint64_t> fallbacks_{0};
+
+    std::unique_ptr<LogRetention> retention_;
+    std::unique_ptr<WritebackControl> writeback_;
+};
@@ -0,0 +1,137 @@
+#include "FrameRecovery.hpp"
+#include "LogImage.hpp"
+#include "RecordFrame.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <sys/stat.h>
+
+namespace {
+    // Don't split scans into chunks smaller than this
+    constexpr size_t kMinChunkSize = 1u << 20;
+
+    // How much of the file tail lastSequence() inspects
+    constexpr size_t kTailWindow = 4u << 20;
+
+    // Collect every valid frame that starts inside [begin, end).
+    // Frames may extend past end; the merge step handles overlap.
+    void scanChunk(const char* data, size_t size, size_t begin, size_t end,
+                   std::vector<FrameExtent>& out) {
+        uint32_t magic = RecordFrame::kMagic;
+        const char first = reinterpret_cast<const char*>(&magic)[0];
+
+        size_t pos = begin;
+        while (pos < end) {
+            const void* hit = std::memchr(data + pos, first, end - pos);
+            if (!hit) {
+                break;
+            }
+            pos = static_cast<const char*>(hit) - data;
+
+            RecordFrame::Header header;
+            size_t frame_size = RecordFrame::validate(data + pos, size - pos, &header);
+            if (frame_size == 0) {
+                ++pos;
+                continue;
+            }
+            out.push_back({pos, frame_size, header.sequence});
+            pos += frame_size;
+        }
+    }
+}
+
+FrameRecovery::FrameRecovery(unsigned thread_count)
+    : thread_count_(thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency())) {}
+
+RecoveryReport FrameRecovery::scan(const char* data, size_t size) const {
+    RecoveryReport report;
+    report.scanned_bytes = size;
+    if (size == 0) {
+        return report;
+    }
+
+    // Split the image into roughly equal chunks, one per scanner thread
+    size_t chunk_size = std::max(kMinChunkSize, (size + thread_count_ - 1) / thread_count_);
+    size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+    report.chunks = static_cast<unsigned>(chunk_count);
+
+    std::vector<std::vector<FrameExtent>> found(chunk_count);
+    std::vector<std::thread> scanners;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        size_t begin = i * chunk_size;
+        size_t end = std::min(size, begin + chunk_size);
+        if (chunk_count == 1) {
+            scanChunk(data, size, begin, end, found[i]);
+        } else {
+            scanners.emplace_back(scanChunk, data, size, begin, end, std::ref(found[i]));
+        }
+    }
+    for (auto& scanner : scanners) {
+        scanner.join();
+    }
+
+    // Merge chunk results in file order. A candidate that starts inside an
+    // already accepted frame is payload that happened to look like a frame.
+    uint64_t cursor = 0;
+    std::optional<FrameExtent> previous;
+    auto addLost = [&](uint64_t end, const FrameExtent* next) {
+        LostRegion region{cursor, end - cursor, 0, 0, false};
+        if (previous && next && next->sequence > previous->sequence + 1) {
+            region.first_sequence = previous->sequence + 1;
+            region.last_sequence = next->sequence - 1;
+            region.sequence_known = true;
+        }
+        report.lost.push_back(region);
+        report.lost_bytes += region.length;
+    };
+
+    for (const auto& chunk : found) {
+        for (const auto& frame : chunk) {
+            if (frame.offset < cursor) {
+                continue;
+            }
+            if (frame.offset > cursor) {
+                addLost(frame.offset, &frame);
+            }
+            report.frames.push_back(frame);
+            report.valid_bytes += frame.size;
+            cursor = frame.offset + frame.size;
+            previous = frame;
+        }
+    }
+    if (cursor < size) {
+        addLost(size, nullptr);
+    }
+
+    return report;
+}
+
+std::optional<uint64_t> FrameRecovery::lastSequence(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || st.st_size == 0) {
+        return std::nullopt;
+    }
+
+    // Scan only the tail of the (possibly striped) log
+    LogImage image(path);
+    size_t start = image.size() > kTailWindow ? image.size() - kTailWindow : 0;
+    RecoveryReport report = FrameRecovery(1).scan(image.data() + start, image.size() - start);
+
+    std::optional<uint64_t> last;
+    for (const auto& frame : report.frames) {
+        if (!last || frame.sequence > *last) {
+            last = frame.sequence;
+        }
+    }
+    return last;
+}
+
+uint64_t FrameRecovery::dropOverwrittenHead(RecoveryReport& report) {
+    if (report.frames.empty() || report.lost.empty() || report.lost.front().offset != 0) {
+        return 0;
+    }
+    uint64_t length = report.lost.front().length;
+    report.lost.erase(report.lost.begin());
+    report.lost_bytes -= length;
+    return length;
+}
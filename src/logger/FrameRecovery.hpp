@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A valid frame found while scanning
+struct FrameExtent {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t sequence;
+};
+
+// A byte range that holds no valid frames
+struct LostRegion {
+    uint64_t offset;
+    uint64_t length;
+    // Sequence numbers missing between the surrounding valid frames.
+    // Only meaningful when sequence_known is true.
+    uint64_t first_sequence;
+    uint64_t last_sequence;
+    bool sequence_known;
+};
+
+// Result of scanning a framed log
+struct RecoveryReport {
+    std::vector<FrameExtent> frames;
+    std::vector<LostRegion> lost;
+    uint64_t scanned_bytes = 0;
+    uint64_t valid_bytes = 0;
+    uint64_t lost_bytes = 0;
+    unsigned chunks = 0;
+};
+
+// Scans framed logs in parallel chunks and resynchronizes on frame boundaries
+class FrameRecovery {
+public:
+    // Constructor takes the number of scanner threads (0 = hardware concurrency)
+    explicit FrameRecovery(unsigned thread_count = 0);
+
+    // Scan an in-memory image of a framed log
+    RecoveryReport scan(const char* data, size_t size) const;
+
+    // Sequence number of the last valid frame near the end of a log, if any.
+    // Used to continue numbering when appending to an existing framed log.
+    static std::optional<uint64_t> lastSequence(const std::string& path);
+
+    // Remove a lost region at the very start of the report and return its
+    // size. A ring log begins wherever the writer last wrapped, usually in
+    // the middle of a record, so that region is expected rather than lost.
+    static uint64_t dropOverwrittenHead(RecoveryReport& report);
+
+private:
+    unsigned thread_count_;
+};
@@ -0,0 +1,117 @@
+#include "Handover.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint32_t kMagic = 0x51484C54;    // "TLHQ" on disk
+    constexpr uint32_t kVersion = 1;
+
+    bool writeAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+std::optional<Handover> Handover::take() {
+    const char* value = std::getenv(kEnvironmentName);
+    if (!value) {
+        return std::nullopt;
+    }
+
+    Handover handover;
+    std::istringstream fields(value);
+    std::string field;
+    while (fields >> field) {
+        auto eq = field.find('=');
+        std::string key = field.substr(0, eq);
+        std::string number = eq == std::string::npos ? "" : field.substr(eq + 1);
+        if (key == "log") {
+            handover.log_fd = std::stoi(number);
+        } else if (key == "control") {
+            handover.control_fd = std::stoi(number);
+        } else if (key == "queue") {
+            handover.queue_fd = std::stoi(number);
+        } else if (key == "sequence") {
+            handover.next_sequence = std::stoull(number);
+        }
+    }
+    ::unsetenv(kEnvironmentName);
+
+    // Descriptors are ours now; keep them from leaking into children
+    for (int fd : {handover.log_fd, handover.control_fd, handover.queue_fd}) {
+        if (fd >= 0) {
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    return handover;
+}
+
+void Handover::publish() const {
+    std::ostringstream value;
+    value << "log=" << log_fd << " control=" << control_fd << " queue=" << queue_fd
+          << " sequence=" << next_sequence;
+    ::setenv(kEnvironmentName, value.str().c_str(), 1);
+}
+
+int Handover::writeRecords(const std::string& records) {
+    int fd = ::memfd_create("logger-handover", MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        throw std::runtime_error("Error creating handover memfd");
+    }
+    uint32_t header[2] = {kMagic, kVersion};
+    if (!writeAll(fd, reinterpret_cast<const char*>(header), sizeof(header)) ||
+        !writeAll(fd, records.data(), records.size())) {
+        ::close(fd);
+        throw std::runtime_error("Error writing handover memfd");
+    }
+    ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    ::lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+std::string Handover::readRecords(int fd) {
+    std::string data;
+    char chunk[65536];
+    for (;;) {
+        ssize_t got = ::read(fd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        data.append(chunk, static_cast<size_t>(got));
+    }
+    ::close(fd);
+
+    uint32_t header[2] = {0, 0};
+    if (data.size() >= sizeof(header)) {
+        std::memcpy(header, data.data(), sizeof(header));
+    }
+    if (header[0] != kMagic || header[1] != kVersion) {
+        throw std::runtime_error("Unsupported handover queue format");
+    }
+    return data.substr(sizeof(header));
+}
+
+void Handover::inherit(int fd) {
+    if (fd >= 0) {
+        ::fcntl(fd, F_SETFD, 0);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// State a logger passes to its replacement across exec().
+//
+// The descriptors are inherited (their close-on-exec flag is cleared) and
+// their numbers travel in the THREADED_LOGGER_HANDOVER environment
+// variable, together with the next frame sequence. Records still sitting in
+// the producer queues are copied into a sealed memfd:
+//   magic(4) version(4) then per record: length(4) bytes(length)
+class Handover {
+public:
+    static constexpr const char* kEnvironmentName = "THREADED_LOGGER_HANDOVER";
+
+    int log_fd = -1;          // Open plain log file (-1 = reopen by path)
+    int control_fd = -1;      // Listening control socket (-1 = none)
+    int queue_fd = -1;        // memfd with queued records (-1 = none)
+    uint64_t next_sequence = 0;
+
+    // Read the handover left by the previous binary and remove it from the
+    // environment; returns nullopt when this is a fresh start
+    static std::optional<Handover> take();
+
+    // Store the handover in the environment for the next exec()
+    void publish() const;
+
+    // Copy length-prefixed records into a sealed memfd that survives exec()
+    static int writeRecords(const std::string& records);
+
+    // Read records written by writeRecords() and close the memfd
+    static std::string readRecords(int fd);
+
+    // Make a descriptor survive exec()
+    static void inherit(int fd);
+};
@@ -0,0 +1,171 @@
+#include "IoGovernor.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace {
+    // Bucket depth in time: how much unused budget may be saved up
+    constexpr double kBurstSeconds = 0.1;
+
+    // Never split writes smaller than this
+    constexpr size_t kMinWriteBytes = 4u << 10;
+
+    // Sleep in slices this long so runtime limit changes apply promptly
+    constexpr auto kSleepSlice = std::chrono::milliseconds(50);
+
+    // "MAJ:MIN" of the whole disk holding dev (io.max is per disk, not partition)
+    std::string diskDeviceId(dev_t dev) {
+        std::string id = std::to_string(major(dev)) + ":" + std::to_string(minor(dev));
+        std::string sys = "/sys/dev/block/" + id;
+
+        struct stat st;
+        if (::stat((sys + "/partition").c_str(), &st) == 0) {
+            std::ifstream parent(sys + "/../dev");
+            std::string parent_id;
+            if (parent >> parent_id) {
+                return parent_id;
+            }
+        }
+        return id;
+    }
+
+    // Parse "wbps=" / "wiops=" from the io.max line for device
+    void applyIoMax(const std::string& file, const std::string& device, CgroupIoLimit& limit) {
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string dev;
+            fields >> dev;
+            if (dev != device) {
+                continue;
+            }
+
+            std::string field;
+            while (fields >> field) {
+                auto eq = field.find('=');
+                if (eq == std::string::npos || field.substr(eq + 1) == "max") {
+                    continue;
+                }
+                uint64_t value = std::stoull(field.substr(eq + 1));
+                uint64_t* target = nullptr;
+                if (field.compare(0, eq, "wbps") == 0) {
+                    target = &limit.bytes_per_sec;
+                } else if (field.compare(0, eq, "wiops") == 0) {
+                    target = &limit.iops;
+                }
+                if (target && (*target == 0 || value < *target)) {
+                    *target = value;
+                }
+            }
+        }
+    }
+}
+
+IoGovernor::IoGovernor(uint64_t bytes_per_sec, uint64_t iops)
+    : bytes_per_sec_(bytes_per_sec), iops_(iops) {
+    auto now = std::chrono::steady_clock::now();
+    bytes_.refilled = now;
+    ops_.refilled = now;
+}
+
+void IoGovernor::setLimits(uint64_t bytes_per_sec, uint64_t iops) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_per_sec_.store(bytes_per_sec, std::memory_order_relaxed);
+    iops_.store(iops, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    // Start fresh so an old debt is not paid at the new rate
+    bytes_.tokens = 0;
+    ops_.tokens = 0;
+}
+
+bool IoGovernor::enabled() const {
+    return bytesPerSec() > 0 || iops() > 0;
+}
+
+size_t IoGovernor::maxWriteBytes() const {
+    uint64_t rate = bytesPerSec();
+    if (rate == 0) {
+        return SIZE_MAX;
+    }
+    return std::max(kMinWriteBytes, static_cast<size_t>(rate * kBurstSeconds));
+}
+
+std::chrono::nanoseconds IoGovernor::take(Bucket& bucket, uint64_t rate, double cost,
+                                          std::chrono::steady_clock::time_point now) {
+    if (rate == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+    bucket.tokens = std::min(bucket.tokens + elapsed * rate, rate * kBurstSeconds);
+    bucket.refilled = now;
+
+    bucket.tokens -= cost;
+    if (bucket.tokens >= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(-bucket.tokens / rate * 1e9));
+}
+
+void IoGovernor::acquire(size_t size) {
+    std::chrono::nanoseconds wait;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        wait = std::max(take(bytes_, bytesPerSec(), static_cast<double>(size), now),
+                        take(ops_, iops(), 1.0, now));
+        generation = generation_.load(std::memory_order_relaxed);
+    }
+
+    // Stop waiting early if the limits were changed meanwhile
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + wait;
+    for (auto now = start; now < deadline; now = std::chrono::steady_clock::now()) {
+        if (generation_.load(std::memory_order_relaxed) != generation) {
+            break;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(deadline - now, kSleepSlice));
+    }
+    auto waited = std::chrono::steady_clock::now() - start;
+    throttled_ns_.fetch_add(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count()), std::memory_order_relaxed);
+}
+
+CgroupIoLimit IoGovernor::readCgroupLimit(const std::string& path) {
+    CgroupIoLimit limit;
+
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return limit;
+    }
+    std::string device = diskDeviceId(st.st_dev);
+
+    // cgroup v2 has a single "0::/path" entry
+    std::ifstream cgroup("/proc/self/cgroup");
+    std::string line;
+    std::string group;
+    while (std::getline(cgroup, line)) {
+        if (line.rfind("0::", 0) == 0) {
+            group = line.substr(3);
+            break;
+        }
+    }
+    if (group.empty()) {
+        return limit;
+    }
+
+    // Every ancestor's limit applies too; keep the tightest
+    for (;;) {
+        applyIoMax("/sys/fs/cgroup" + group + "/io.max", device, limit);
+        if (group.empty() || group == "/") {
+            break;
+        }
+        auto slash = group.find_last_of('/');
+        group = slash == 0 || slash == std::string::npos ? "/" : group.substr(0, slash);
+    }
+    return limit;
+}
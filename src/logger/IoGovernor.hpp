@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Write limits for one block device from a cgroup v2 io.max file
+struct CgroupIoLimit {
+    uint64_t bytes_per_sec = 0;   // wbps, 0 = unlimited
+    uint64_t iops = 0;            // wiops, 0 = unlimited
+};
+
+// Token-bucket disk bandwidth governor for the log writer.
+//
+// One bucket meters bytes and an optional second one meters write calls.
+// Buckets may go into debt for a large write; the next caller pays it off
+// by sleeping. Only the writer thread ever waits here: producers keep
+// queueing and the queue overflow policy bounds how long they can block.
+class IoGovernor {
+public:
+    // Constructor takes the byte rate and IOPS limits (0 = unlimited)
+    IoGovernor(uint64_t bytes_per_sec, uint64_t iops);
+
+    // Change limits at runtime; safe to call from any thread
+    void setLimits(uint64_t bytes_per_sec, uint64_t iops);
+
+    // Wait until a write of size bytes may be issued
+    void acquire(size_t size);
+
+    // Largest write that keeps shaping smooth (about one burst worth)
+    size_t maxWriteBytes() const;
+
+    // Accessors
+    bool enabled() const;
+    uint64_t bytesPerSec() const { return bytes_per_sec_.load(std::memory_order_relaxed); }
+    uint64_t iops() const { return iops_.load(std::memory_order_relaxed); }
+    uint64_t throttledNs() const { return throttled_ns_.load(std::memory_order_relaxed); }
+
+    // Read the write limits that apply to path from this process's cgroup
+    // (the tightest io.max entry on the way to the root). Returns zeros if
+    // there is no cgroup v2 limit for the file's device.
+    static CgroupIoLimit readCgroupLimit(const std::string& path);
+
+private:
+    struct Bucket {
+        double tokens = 0;
+        std::chrono::steady_clock::time_point refilled;
+    };
+
+    // Refill bucket at rate, take cost, and return how long to wait
+    static std::chrono::nanoseconds take(Bucket& bucket, uint64_t rate, double cost,
+                                         std::chrono::steady_clock::time_point now);
+
+    std::atomic<uint64_t> bytes_per_sec_;
+    std::atomic<uint64_t> iops_;
+    std::atomic<uint64_t> throttled_ns_{0};
+    std::atomic<uint64_t> generation_{0};   // Bumped by setLimits()
+
+    std::mutex mutex_;
+    Bucket bytes_;
+    Bucket ops_;
+};
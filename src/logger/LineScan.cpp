@@ -0,0 +1,77 @@
+#include "LineScan.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    LineScan::Result scanScalar(const char* data, size_t size, size_t from, LineScan::Result result) {
+        for (size_t i = from; i < size; ++i) {
+            if (data[i] == '\n') {
+                ++result.lines;
+                result.end = i + 1;
+            }
+        }
+        return result;
+    }
+
+#if defined(__x86_64__)
+    LineScan::Result scanSse2(const char* data, size_t size) {
+        LineScan::Result result;
+        const __m128i newline = _mm_set1_epi8('\n');
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+            if (mask != 0) {
+                result.lines += static_cast<size_t>(__builtin_popcount(mask));
+                result.end = i + 32 - static_cast<size_t>(__builtin_clz(mask));
+            }
+        }
+        return scanScalar(data, size, i, result);
+    }
+
+    __attribute__((target("avx2,popcnt,lzcnt")))
+    LineScan::Result scanAvx2(const char* data, size_t size) {
+        LineScan::Result result;
+        const __m256i newline = _mm256_set1_epi8('\n');
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+            if (mask != 0) {
+                result.lines += static_cast<size_t>(_mm_popcnt_u32(mask));
+                result.end = i + 32 - static_cast<size_t>(_lzcnt_u32(mask));
+            }
+        }
+        return scanScalar(data, size, i, result);
+    }
+
+    bool detectAvx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+               __builtin_cpu_supports("abm");
+    }
+
+    const bool has_avx2 = detectAvx2();
+#endif
+}
+
+LineScan::Result LineScan::scan(const char* data, size_t size) {
+#if defined(__x86_64__)
+    if (has_avx2) {
+        return scanAvx2(data, size);
+    }
+    return scanSse2(data, size);
+#else
+    return scanScalar(data, size, 0, Result{});
+#endif
+}
+
+const char* LineScan::implementation() {
+#if defined(__x86_64__)
+    return has_avx2 ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Newline scanning for the log shipper and follower tools.
+// One pass finds both the number of lines and where the last complete line
+// ends, 32 bytes at a time with AVX2 when the CPU supports it, 16 at a time
+// with SSE2 otherwise, and bytewise on other targets.
+namespace LineScan {
+    struct Result {
+        size_t end = 0;     // One past the last '\n' (0 = no complete line)
+        size_t lines = 0;   // Number of '\n' bytes
+    };
+
+    // Scan size bytes of data
+    Result scan(const char* data, size_t size);
+
+    // Name of the kernel in use: "avx2", "sse2" or "scalar"
+    const char* implementation();
+}
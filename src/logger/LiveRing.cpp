@@ -0,0 +1,340 @@
+#include "LiveRing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace LiveRingLayout;
+
+namespace {
+    constexpr size_t kMinCapacity = 64 * 1024;
+
+    uint64_t aligned(uint64_t bytes) {
+        return (bytes + kAlign - 1) & ~static_cast<uint64_t>(kAlign - 1);
+    }
+
+    // The ring starts after the header, cache-line aligned
+    size_t ringOffset() {
+        return (sizeof(Header) + 63) & ~static_cast<size_t>(63);
+    }
+
+    std::string objectName(const std::string& name) {
+        if (name.empty() || name.size() > NAME_MAX - 1 || name.find('/') != std::string::npos) {
+            throw std::invalid_argument("bad live ring name: " + name);
+        }
+        return "/" + name;
+    }
+
+    // Shared futex: the ring is mapped MAP_SHARED, possibly by several processes
+    long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout) {
+        return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+    }
+}
+
+LiveRing::LiveRing(const std::string& name, size_t capacity)
+    : name_(name), capacity_(aligned(capacity)) {
+    if (capacity_ < kMinCapacity) {
+        throw std::invalid_argument("live ring must hold at least 64 KiB");
+    }
+    std::string object = objectName(name);
+    ::shm_unlink(object.c_str());   // A ring left by a crashed run
+    int fd = ::shm_open(object.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error creating live ring " + object + ": " + std::strerror(errno));
+    }
+    mapped_bytes_ = ringOffset() + capacity_;
+    void* memory = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(mapped_bytes_)) == 0) {
+        memory = ::mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int saved = errno;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        ::shm_unlink(object.c_str());
+        throw std::runtime_error("Error mapping live ring " + object + ": " + std::strerror(saved));
+    }
+
+    // A new object is zero-filled, which is the empty state of every field
+    header_ = static_cast<Header*>(memory);
+    ring_ = static_cast<char*>(memory) + ringOffset();
+    header_->version = kVersion;
+    header_->capacity = capacity_;
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = kMagic;
+}
+
+LiveRing::~LiveRing() {
+    // Unlinked first, so a subscriber that sees it closed cannot attach
+    // to it again
+    ::shm_unlink(objectName(name_).c_str());
+    header_->closed.store(1, std::memory_order_release);
+    header_->generation.fetch_add(1);
+    futex(&header_->generation, FUTEX_WAKE, INT_MAX, nullptr);
+    ::munmap(header_, mapped_bytes_);
+}
+
+void LiveRing::publish(const char* data, size_t size) {
+    // A record may take a quarter of the ring, so a batch never wipes out
+    // everything a subscriber has not read yet
+    size_t max_record = static_cast<size_t>(capacity_ / 4 - sizeof(RecordHeader));
+    ++sequence_;
+    do {
+        size_t piece = std::min(size, max_record);
+        writeRecord(data, static_cast<uint32_t>(piece), piece < size ? uint32_t{kContinued} : 0u);
+        data += piece;
+        size -= piece;
+    } while (size > 0);
+
+    // Wake sleeping subscribers; with none the writer makes no system call
+    header_->generation.fetch_add(1);
+    if (header_->waiters.load() > 0) {
+        futex(&header_->generation, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+void LiveRing::appendStats(std::ostream& out) const {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    out << "live.ring=" << name_ << "\n"
+        << "live.capacity_bytes=" << capacity_ << "\n"
+        << "live.head=" << head << "\n"
+        << "live.retained_bytes=" << head - tail << "\n";
+    for (size_t i = 0; i < kMaxSubscribers; ++i) {
+        const Slot& slot = header_->slots[i];
+        uint32_t pid = slot.pid.load(std::memory_order_acquire);
+        if (pid == 0) {
+            continue;
+        }
+        std::string prefix = "live.subscriber." + std::to_string(i) + ".";
+        uint64_t cursor = slot.cursor.load(std::memory_order_relaxed);
+        out << prefix << "name=" << std::string(slot.name, strnlen(slot.name, kNameBytes)) << "\n"
+            << prefix << "pid=" << pid << "\n"
+            << prefix << "lag_bytes=" << (head > cursor ? head - cursor : 0) << "\n"
+            << prefix << "delivered_bytes=" << slot.delivered_bytes.load(std::memory_order_relaxed) << "\n"
+            << prefix << "skipped_bytes=" << slot.skipped_bytes.load(std::memory_order_relaxed) << "\n";
+    }
+}
+
+void LiveRing::writeRecord(const char* data, uint32_t length, uint32_t flags) {
+    uint64_t need = aligned(sizeof(RecordHeader) + length);
+    uint64_t offset = head_ % capacity_;
+    if (capacity_ - offset < need) {
+        // Records never cross the end; send readers back to the start
+        reclaim(head_ + (capacity_ - offset));
+        RecordHeader wrap{0, kWrap, sequence_};
+        std::memcpy(ring_ + offset, &wrap, sizeof(wrap));
+        head_ += capacity_ - offset;
+        offset = 0;
+    }
+    reclaim(head_ + need);
+    RecordHeader record{length, flags, sequence_};
+    std::memcpy(ring_ + offset, &record, sizeof(record));
+    std::memcpy(ring_ + offset + sizeof(record), data, length);
+    header_->head.store(head_ + need, std::memory_order_release);
+    head_ += need;
+}
+
+void LiveRing::reclaim(uint64_t end) {
+    if (end - tail_ <= capacity_) {
+        return;
+    }
+    do {
+        RecordHeader old;
+        std::memcpy(&old, ring_ + tail_ % capacity_, sizeof(old));
+        tail_ += (old.flags & kWrap) ? capacity_ - tail_ % capacity_ : aligned(sizeof(old) + old.length);
+    } while (end - tail_ > capacity_);
+    // Readers must see the tail move before the bytes they might be copying
+    // change under them
+    header_->tail.store(tail_, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+LiveCursor::LiveCursor(const LiveRing& ring, const std::string& name, Filter filter, bool from_oldest)
+    : header_(ring.header()),
+      ring_(reinterpret_cast<const char*>(ring.header()) + ringOffset()),
+      capacity_(ring.header()->capacity),
+      filter_(std::move(filter)) {
+    attach(name, from_oldest);
+}
+
+LiveCursor::LiveCursor(const std::string& ring_name, const std::string& name, Filter filter, bool from_oldest)
+    : filter_(std::move(filter)) {
+    std::string object = objectName(ring_name);
+    int fd = ::shm_open(object.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Error opening live ring " + object + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    void* memory = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > ringOffset()) {
+        memory = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Error mapping live ring " + object);
+    }
+    mapped_bytes_ = static_cast<size_t>(st.st_size);
+    header_ = static_cast<Header*>(memory);
+    ring_ = static_cast<const char*>(memory) + ringOffset();
+    uint64_t magic = header_->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    capacity_ = header_->capacity;
+    if (magic != kMagic || header_->version != kVersion || ringOffset() + capacity_ != mapped_bytes_) {
+        ::munmap(memory, mapped_bytes_);
+        throw std::runtime_error(object + " is not a live ring of this version");
+    }
+    try {
+        attach(name, from_oldest);
+    } catch (...) {
+        ::munmap(memory, mapped_bytes_);
+        throw;
+    }
+}
+
+LiveCursor::~LiveCursor() {
+    slot_->pid.store(0, std::memory_order_release);
+    if (mapped_bytes_ > 0) {
+        ::munmap(header_, mapped_bytes_);
+    }
+}
+
+void LiveCursor::attach(const std::string& name, bool from_oldest) {
+    uint32_t self = static_cast<uint32_t>(::getpid());
+    for (size_t i = 0; i < kMaxSubscribers && !slot_; ++i) {
+        Slot& slot = header_->slots[i];
+        uint32_t pid = slot.pid.load();
+        // Free, or left behind by a process that died without detaching
+        bool free = pid == 0 || (pid != self && ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH);
+        if (free && slot.pid.compare_exchange_strong(pid, self)) {
+            slot_ = &slot;
+        }
+    }
+    if (!slot_) {
+        throw std::runtime_error("all live ring subscriber slots are taken");
+    }
+    if (closed()) {
+        slot_->pid.store(0, std::memory_order_release);
+        throw std::runtime_error("live ring is closed");
+    }
+    std::memset(slot_->name, 0, kNameBytes);
+    std::memcpy(slot_->name, name.data(), std::min(name.size(), kNameBytes - 1));
+    slot_->delivered_bytes.store(0, std::memory_order_relaxed);
+    slot_->skipped_bytes.store(0, std::memory_order_relaxed);
+    cursor_ = from_oldest ? header_->tail.load(std::memory_order_acquire)
+                          : header_->head.load(std::memory_order_acquire);
+    slot_->cursor.store(cursor_, std::memory_order_relaxed);
+}
+
+bool LiveCursor::next(std::string& out) {
+    out.clear();
+    for (;;) {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (cursor_ == head) {
+            return false;
+        }
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        if (cursor_ < tail) {
+            // Lapped by the writer: the batches in between are gone
+            slot_->skipped_bytes.fetch_add(tail - cursor_, std::memory_order_relaxed);
+            cursor_ = tail;
+            partial_.clear();
+            continue;
+        }
+
+        RecordHeader record;
+        if (!readRecord(record)) {
+            continue;   // Overwritten while being copied; skip on the next round
+        }
+        uint64_t offset = cursor_ % capacity_;
+        cursor_ += (record.flags & kWrap) ? capacity_ - offset : aligned(sizeof(record) + record.length);
+        slot_->cursor.store(cursor_, std::memory_order_relaxed);
+        if (record.flags & kWrap) {
+            continue;
+        }
+
+        if (filter_) {
+            filterLines(out, !(record.flags & kContinued));
+        } else {
+            out.swap(batch_);
+        }
+        if (!out.empty()) {
+            slot_->delivered_bytes.fetch_add(out.size(), std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+bool LiveCursor::wait(std::chrono::milliseconds timeout) {
+    uint32_t generation = header_->generation.load();
+    if (header_->head.load(std::memory_order_acquire) != cursor_ || closed()) {
+        return true;
+    }
+    timespec ts{static_cast<time_t>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000) * 1000000};
+    header_->waiters.fetch_add(1);
+    futex(&header_->generation, FUTEX_WAIT, generation, &ts);
+    header_->waiters.fetch_sub(1);
+    return header_->head.load(std::memory_order_acquire) != cursor_;
+}
+
+bool LiveCursor::readRecord(RecordHeader& record) {
+    uint64_t offset = cursor_ % capacity_;
+    std::memcpy(&record, ring_ + offset, sizeof(record));
+    // The writer moves the tail before overwriting: if it is still behind
+    // the cursor, what was copied is intact
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->tail.load(std::memory_order_relaxed) > cursor_) {
+        return false;
+    }
+    if (record.flags & kWrap) {
+        batch_.clear();
+        return true;
+    }
+    batch_.assign(ring_ + offset + sizeof(record), record.length);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header_->tail.load(std::memory_order_relaxed) <= cursor_;
+}
+
+void LiveCursor::filterLines(std::string& out, bool last_piece) {
+    std::string_view data(batch_);
+    auto deliver = [&](std::string_view line) {
+        std::string_view text = line;
+        if (!text.empty() && text.back() == '\n') {
+            text.remove_suffix(1);
+        }
+        if (filter_(text)) {
+            out.append(line.data(), line.size());
+        }
+    };
+
+    if (!partial_.empty()) {
+        size_t newline = data.find('\n');
+        size_t take = newline == std::string_view::npos ? data.size() : newline + 1;
+        partial_.append(data.data(), take);
+        data.remove_prefix(take);
+        if (newline == std::string_view::npos && !last_piece) {
+            return;
+        }
+        deliver(partial_);
+        partial_.clear();
+    }
+    for (size_t newline; (newline = data.find('\n')) != std::string_view::npos;) {
+        deliver(data.substr(0, newline + 1));
+        data.remove_prefix(newline + 1);
+    }
+    if (!data.empty()) {
+        if (last_piece) {
+            deliver(data);
+        } else {
+            partial_.assign(data.data(), data.size());
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// Shared-memory ring of the batches the writer has committed, for live
+// subscribers that would otherwise re-read the log file.
+//
+// The writer copies each batch it wrote into the ring (POSIX shared memory
+// "/<name>", so other processes can attach) and never waits for anyone.
+// Every subscriber keeps its own cursor; one that falls a whole ring behind
+// has its oldest batches overwritten and skips ahead to the oldest intact
+// batch, counting what it missed. Subscribers sleep on a futex in the ring
+// that the writer only wakes while someone is waiting.
+//
+// Layout: a header with head (end of the newest batch) and tail (start of
+// the oldest one still intact) as positions that only grow, the futex word
+// and the subscriber slots, then the ring. Each batch is a 16-byte record
+// header and its bytes, padded to 16; a batch bigger than a quarter of the
+// ring is split into several records. A record that would cross the end of
+// the ring is preceded by a wrap marker.
+namespace LiveRingLayout {
+    constexpr uint64_t kMagic = 0x474E49524556494CULL;   // "LIVERING"
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kMaxSubscribers = 16;
+    constexpr size_t kNameBytes = 32;
+    constexpr size_t kAlign = 16;
+
+    enum RecordFlags : uint32_t {
+        kWrap = 1,        // No data; continue at the start of the ring
+        kContinued = 2    // The batch goes on in the next record
+    };
+
+    struct RecordHeader {
+        uint32_t length;      // Data bytes after this header
+        uint32_t flags;
+        uint64_t sequence;    // Batch number
+    };
+
+    // One registered subscriber, updated by the subscriber itself
+    struct Slot {
+        std::atomic<uint32_t> pid;     // 0 = free
+        uint32_t reserved;
+        std::atomic<uint64_t> cursor;
+        std::atomic<uint64_t> delivered_bytes;
+        std::atomic<uint64_t> skipped_bytes;
+        char name[kNameBytes];
+    };
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t capacity;                           // Ring bytes after the header
+        alignas(64) std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        std::atomic<uint32_t> closed;                // Writer gone; attach again
+        alignas(64) std::atomic<uint32_t> generation;   // Futex word
+        std::atomic<uint32_t> waiters;
+        alignas(64) Slot slots[kMaxSubscribers];
+    };
+}
+
+// Writer side: owns the shared memory object
+class LiveRing {
+public:
+    // Constructor creates (or replaces) the ring "/<name>" with capacity
+    // bytes; throws on failure
+    LiveRing(const std::string& name, size_t capacity);
+
+    // Destructor marks the ring closed, wakes subscribers and unlinks it
+    ~LiveRing();
+
+    // Non-copyable
+    LiveRing(const LiveRing&) = delete;
+    LiveRing& operator=(const LiveRing&) = delete;
+
+    // Writer thread: add a committed batch, overwriting the oldest ones
+    void publish(const char* data, size_t size);
+
+    // "key=value" lines for the control socket's stats
+    void appendStats(std::ostream& out) const;
+
+    // Accessors
+    const std::string& name() const { return name_; }
+    LiveRingLayout::Header* header() const { return header_; }
+
+private:
+    // Append one record at head_, making room first
+    void writeRecord(const char* data, uint32_t length, uint32_t flags);
+
+    // Advance the tail until position end fits in the ring
+    void reclaim(uint64_t end);
+
+    std::string name_;
+    LiveRingLayout::Header* header_ = nullptr;
+    char* ring_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    uint64_t capacity_;
+    uint64_t head_ = 0;        // Writer's copies of header_->head and tail
+    uint64_t tail_ = 0;
+    uint64_t sequence_ = 0;
+};
+
+// Subscriber side: a cursor on a ring, in this process or another one
+class LiveCursor {
+public:
+    // Line filter; lines it rejects are not delivered (empty = all)
+    using Filter = std::function<bool(std::string_view line)>;
+
+    // Attach to this process's ring
+    LiveCursor(const LiveRing& ring, const std::string& name, Filter filter = {}, bool from_oldest = false);
+
+    // Attach to the ring "/<ring_name>" of another process; throws if
+    // there is none or all subscriber slots are taken
+    LiveCursor(const std::string& ring_name, const std::string& name, Filter filter = {},
+               bool from_oldest = false);
+
+    // Destructor frees the slot (and unmaps a ring of another process)
+    ~LiveCursor();
+
+    // Non-copyable
+    LiveCursor(const LiveCursor&) = delete;
+    LiveCursor& operator=(const LiveCursor&) = delete;
+
+    // Replace out with the next delivered lines; false when caught up.
+    // Without a filter out is the batch as written (framed logs included);
+    // with one it holds the whole lines that passed.
+    bool next(std::string& out);
+
+    // Sleep until the writer publishes or timeout; false on timeout
+    bool wait(std::chrono::milliseconds timeout);
+
+    // True once the writer has closed the ring
+    bool closed() const { return header_->closed.load(std::memory_order_acquire) != 0; }
+
+    // Accessors
+    uint64_t skippedBytes() const { return slot_->skipped_bytes.load(std::memory_order_relaxed); }
+    uint64_t deliveredBytes() const { return slot_->delivered_bytes.load(std::memory_order_relaxed); }
+
+private:
+    // Take a slot and place the cursor
+    void attach(const std::string& name, bool from_oldest);
+
+    // Copy the record at cursor_ into batch_; false if it was overwritten
+    bool readRecord(LiveRingLayout::RecordHeader& record);
+
+    // Append the lines of batch_ that pass the filter to out
+    void filterLines(std::string& out, bool last_piece);
+
+    LiveRingLayout::Header* header_;
+    const char* ring_;
+    uint64_t capacity_;
+    size_t mapped_bytes_ = 0;      // Nonzero when this cursor mapped the ring
+    LiveRingLayout::Slot* slot_ = nullptr;
+    Filter filter_;
+    uint64_t cursor_ = 0;
+    std::string batch_;
+    std::string partial_;          // Start of a line split across records
+};
@@ -0,0 +1,342 @@
+#include "LogFollower.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LogIndex.hpp"
+
+namespace {
+    std::string directoryOf(const std::string& path) {
+        auto slash = path.rfind('/');
+        if (slash == std::string::npos) {
+            return ".";
+        }
+        return slash == 0 ? "/" : path.substr(0, slash);
+    }
+
+    // Rescan interval when changes cannot be watched
+    constexpr std::chrono::milliseconds kPollInterval{100};
+
+    // How long retention may take between publishing a collapse in the
+    // index and finishing it before the index is taken as it stands
+    constexpr std::chrono::milliseconds kCollapseWait{1000};
+
+    constexpr uint32_t kFileEvents = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+    constexpr uint32_t kDirectoryEvents = IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+}
+
+LogFollower::LogFollower(const std::string& path, size_t buffer_bytes)
+    : path_(path), buffer_(buffer_bytes) {
+    auto slash = path_.rfind('/');
+    name_ = slash == std::string::npos ? path_ : path_.substr(slash + 1);
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0) {
+        directory_watch_ = ::inotify_add_watch(inotify_fd_, directoryOf(path_).c_str(), kDirectoryEvents);
+    }
+}
+
+LogFollower::~LogFollower() {
+    closeFile();
+    if (inotify_fd_ >= 0) {
+        ::close(inotify_fd_);
+    }
+}
+
+void LogFollower::seek(const FollowPosition& position) {
+    // Rewinding within the open file needs no lookup
+    if (fd_ >= 0 && position.inode != 0 && position.device == position_.device &&
+        position.inode == position_.inode) {
+        position_.offset = std::max(position.offset, collapsed_);   // Unless it went with the head
+        begin_ = end_ = 0;
+        at_eof_ = false;
+        return;
+    }
+    closeFile();
+    if (position.inode == 0) {
+        openPath();
+        return;
+    }
+
+    // The file may still be at path, or renamed next to it by a rotation
+    std::vector<std::string> candidates{path_};
+    std::string directory = directoryOf(path_);
+    if (DIR* dir = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            if (entry->d_ino == position.inode) {
+                candidates.push_back(directory + "/" + entry->d_name);
+            }
+        }
+        ::closedir(dir);
+    }
+    for (const auto& candidate : candidates) {
+        int fd = ::open(candidate.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_dev) == position.device &&
+            static_cast<uint64_t>(st.st_ino) == position.inode) {
+            adopt(fd, position.device, position.inode, position.offset);
+            if (static_cast<uint64_t>(st.st_size) + collapsed_ < position_.offset) {
+                ++truncations_;
+                position_.offset = collapsed_;
+            }
+            return;
+        }
+        ::close(fd);
+    }
+
+    std::cerr << "Warning: " << path_ << " no longer has the saved file (inode " << position.inode
+              << "); following it from the start\n";
+    openPath();
+}
+
+LogFollower::Chunk LogFollower::peek() {
+    if (fd_ < 0 && !openPath()) {
+        return {};
+    }
+    if (end_ - begin_ < buffer_.size() / 2) {
+        fill();
+    }
+    if (!at_eof_) {
+        return {{buffer_.data() + begin_, end_ - begin_}, false};
+    }
+
+    // Caught up with the file: was its head collapsed, was it cut short,
+    // or was it replaced at the path?
+    struct stat st;
+    if (::fstat(fd_, &st) == 0 && static_cast<uint64_t>(st.st_size) + collapsed_ < position_.offset) {
+        if (!rebase()) {
+            ++truncations_;
+            position_.offset = collapsed_;
+            begin_ = end_ = 0;
+        }
+        fill();
+        return {{buffer_.data() + begin_, end_ - begin_}, false};
+    }
+    rotation_pending_ = rotated();
+    if (!rotation_pending_) {
+        return {{buffer_.data() + begin_, end_ - begin_}, false};
+    }
+
+    // The writer keeps using the old file until it reopens or is hotswapped;
+    // move on only once the old file has stopped growing
+    fill();
+    if (!at_eof_ || std::chrono::steady_clock::now() - last_growth_ < kRotateGrace) {
+        return {{buffer_.data() + begin_, end_ - begin_}, false};
+    }
+    if (begin_ != end_) {
+        return {{buffer_.data() + begin_, end_ - begin_}, true};
+    }
+    ++rotations_;
+    rotation_pending_ = false;
+    closeFile();
+    if (!openPath()) {
+        return {};
+    }
+    fill();
+    return {{buffer_.data() + begin_, end_ - begin_}, false};
+}
+
+void LogFollower::consume(size_t bytes) {
+    begin_ += bytes;
+    position_.offset += bytes;
+    if (begin_ == end_) {
+        begin_ = end_ = 0;
+    }
+}
+
+void LogFollower::wait(std::chrono::milliseconds timeout) {
+    timeout = pollTimeout(timeout);
+    if (inotify_fd_ < 0) {
+        std::this_thread::sleep_for(timeout);
+        return;
+    }
+    pollfd ready{inotify_fd_, POLLIN, 0};
+    if (::poll(&ready, 1, static_cast<int>(timeout.count())) > 0) {
+        handleEvents();
+    }
+}
+
+bool LogFollower::handleEvents() {
+    alignas(inotify_event) char buffer[16384];
+    bool relevant = false;
+    for (;;) {
+        ssize_t got = ::read(inotify_fd_, buffer, sizeof(buffer));
+        if (got <= 0) {
+            return relevant;
+        }
+        for (char* p = buffer; p < buffer + got;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            if (event->mask & IN_Q_OVERFLOW) {
+                relevant = true;   // Events were lost; look at everything again
+            } else if (event->wd == file_watch_) {
+                relevant = true;
+            } else if (event->wd == directory_watch_ && event->len > 0 && name_ == event->name) {
+                relevant = true;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+std::chrono::milliseconds LogFollower::pollTimeout(std::chrono::milliseconds limit) const {
+    if (inotify_fd_ < 0 || directory_watch_ < 0 || (fd_ >= 0 && file_watch_ < 0)) {
+        return std::min(limit, kPollInterval);
+    }
+    if (rotation_pending_) {
+        auto idle = std::chrono::steady_clock::now() - last_growth_;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(kRotateGrace - idle);
+        return std::clamp(left + std::chrono::milliseconds(1), std::chrono::milliseconds(1), limit);
+    }
+    return limit;
+}
+
+bool LogFollower::openPath() {
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    adopt(fd, static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino), 0);
+    return true;
+}
+
+void LogFollower::adopt(int fd, uint64_t device, uint64_t inode, uint64_t offset) {
+    fd_ = fd;
+    position_ = FollowPosition{device, inode, offset};
+    begin_ = end_ = 0;
+    at_eof_ = false;
+    last_growth_ = std::chrono::steady_clock::now();
+    rotation_pending_ = false;
+    collapsed_ = 0;
+    index_inode_ = 0;
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    watchFile();
+    rebase();
+}
+
+void LogFollower::watchFile() {
+    if (inotify_fd_ < 0) {
+        return;
+    }
+    // Through the descriptor, so the watch is on the inode that was opened
+    // even if the path has moved on
+    std::string proc_path = "/proc/self/fd/" + std::to_string(fd_);
+    file_watch_ = ::inotify_add_watch(inotify_fd_, proc_path.c_str(), kFileEvents);
+}
+
+void LogFollower::closeFile() {
+    if (file_watch_ >= 0) {
+        ::inotify_rm_watch(inotify_fd_, file_watch_);
+        file_watch_ = -1;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    begin_ = end_ = 0;
+    at_eof_ = false;
+}
+
+bool LogFollower::fill() {
+    ssize_t got;
+    size_t room;
+    for (;;) {
+        rebase();
+        uint64_t index_inode = index_inode_;
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        room = buffer_.size() - end_;
+        if (room == 0) {
+            return true;
+        }
+        do {
+            got = ::pread(fd_, buffer_.data() + end_, room,
+                          static_cast<off_t>(position_.offset - collapsed_ + end_));
+        } while (got < 0 && errno == EINTR);
+
+        // Every collapse replaces the index first; if that happened during
+        // the read, what came back may be from either side of it
+        if (got > 0 && indexInode() != index_inode && rebase()) {
+            continue;
+        }
+        break;
+    }
+    if (got <= 0) {
+        at_eof_ = true;
+        return false;
+    }
+    end_ += static_cast<size_t>(got);
+    last_growth_ = std::chrono::steady_clock::now();
+    at_eof_ = static_cast<size_t>(got) < room;
+    return true;
+}
+
+bool LogFollower::rotated() const {
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0) {
+        return false;   // Renamed away with nothing new in its place yet
+    }
+    return static_cast<uint64_t>(st.st_dev) != position_.device ||
+           static_cast<uint64_t>(st.st_ino) != position_.inode;
+}
+
+uint64_t LogFollower::indexInode() const {
+    struct stat st;
+    if (::stat(LogIndex::pathFor(path_).c_str(), &st) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(st.st_ino);
+}
+
+bool LogFollower::rebase() {
+    uint64_t inode = indexInode();
+    if (inode == index_inode_) {
+        return false;
+    }
+    index_inode_ = inode;
+    if (inode == 0 || rotated()) {
+        return false;
+    }
+
+    // Retention publishes a collapse before making it; give it a moment to
+    // finish, after which read() settles it by the log size
+    auto index = LogIndex::read(path_);
+    auto deadline = std::chrono::steady_clock::now() + kCollapseWait;
+    while (index && index->collapsing && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        index_inode_ = indexInode();
+        index = LogIndex::read(path_);
+    }
+    uint64_t collapsed = index ? index->collapsed : 0;
+    if (collapsed == collapsed_) {
+        return false;
+    }
+    if (collapsed < collapsed_) {
+        // A new index: the log was truncated or replaced in place
+        ++truncations_;
+        position_.offset = collapsed;
+    } else if (position_.offset < collapsed) {
+        // Unread data went with the head; go on at the first whole record
+        position_.offset = collapsed + index->start;
+    }
+    collapsed_ = collapsed;
+    begin_ = end_ = 0;
+    at_eof_ = false;
+    return true;
+}
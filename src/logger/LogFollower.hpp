@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where a follower stands: a file by device and inode, and a byte offset
+struct FollowPosition {
+    uint64_t device = 0;
+    uint64_t inode = 0;     // 0 = nowhere yet
+    uint64_t offset = 0;    // File offset plus the bytes collapsed off the head
+};
+
+// Follows a log file by path the way "tail -F" does, but by inode.
+//
+// The open file is read with pread() into a large buffer; the caller looks
+// at what is new with peek() and takes what it used with consume(). When the
+// path starts naming another file (rotation, or a hotswap that renamed the
+// old one away) the old file is read until it has stopped growing for
+// kRotateGrace, then the follower moves to the new file from its start. A
+// file that shrinks below the position was truncated in place and is read
+// again from 0.
+//
+// Retention in collapse mode also shrinks the file, by removing its head.
+// Positions therefore count from the first byte the file ever held, and the
+// follower reads how much was collapsed from the sidecar LogIndex (only for
+// the file at path; an index belongs to the name). A collapse is not a
+// truncation: the position stays on the same byte, or moves to the first
+// whole record left if that byte went with the head.
+//
+// Instead of polling, callers sleep on watchFd(): an inotify descriptor
+// watching the open file (writes, truncation, renames) and its directory
+// (files created, renamed or deleted under the followed name). wait() does
+// that for a single follower.
+class LogFollower {
+public:
+    static constexpr std::chrono::milliseconds kRotateGrace{2000};
+
+    // Unread data of the current file
+    struct Chunk {
+        std::string_view data;
+        bool final = false;    // The file was rotated away; no more will come
+    };
+
+    // Constructor takes the path and the read buffer size
+    explicit LogFollower(const std::string& path, size_t buffer_bytes = 1u << 20);
+
+    // Destructor closes the file and the watch
+    ~LogFollower();
+
+    // Non-copyable
+    LogFollower(const LogFollower&) = delete;
+    LogFollower& operator=(const LogFollower&) = delete;
+
+    // Continue from a saved position: the file at path if it still has that
+    // inode, else a rotated file with that inode in the same directory, else
+    // path from its start
+    void seek(const FollowPosition& position);
+
+    // Data after the position (at most the buffer size); empty when the
+    // follower has caught up or the path does not exist yet
+    Chunk peek();
+
+    // Move the position past bytes of the last peek()
+    void consume(size_t bytes);
+
+    // Sleep until the file or its name may have changed, or timeout
+    void wait(std::chrono::milliseconds timeout);
+
+    // Descriptor that becomes readable on changes (-1 without inotify)
+    int watchFd() const { return inotify_fd_; }
+
+    // Read the events of a readable watchFd(); true if any concerned this
+    // follower's file or name
+    bool handleEvents();
+
+    // How long the caller may sleep on watchFd(), at most limit: shorter
+    // while a rotated file runs out its grace period, or without inotify
+    std::chrono::milliseconds pollTimeout(std::chrono::milliseconds limit) const;
+
+    // Current position (after everything consumed)
+    FollowPosition position() const { return position_; }
+
+    // Accessors
+    const std::string& path() const { return path_; }
+    uint64_t rotations() const { return rotations_; }
+    uint64_t truncations() const { return truncations_; }
+
+private:
+    // Open the file path names now, from offset 0; false if it is missing
+    bool openPath();
+
+    // Adopt an open descriptor of a file at offset
+    void adopt(int fd, uint64_t device, uint64_t inode, uint64_t offset);
+
+    // Close the current file and forget the buffer
+    void closeFile();
+
+    // Read more of the file after the buffered bytes; false at end of file
+    bool fill();
+
+    // True when path names a different file than the open one
+    bool rotated() const;
+
+    // Inode of the index at path (0 if there is none)
+    uint64_t indexInode() const;
+
+    // Pick up a collapse of the open file's head from a changed index;
+    // true if the file moved under the position (the buffer is dropped)
+    bool rebase();
+
+    // Watch the open file; the directory is watched for the whole lifetime
+    void watchFile();
+
+
+    std::string path_;
+    int fd_ = -1;
+    FollowPosition position_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;     // buffer_[begin_, end_) holds the file from position_.offset
+    size_t end_ = 0;
+    bool at_eof_ = false;
+    std::chrono::steady_clock::time_point last_growth_;   // Last time the file had new data
+
+    bool rotation_pending_ = false;   // Path renamed; old file in its grace period
+
+    uint64_t collapsed_ = 0;          // Bytes collapsed off the open file's head
+    uint64_t index_inode_ = 0;        // Index collapsed_ was taken from
+
+    int inotify_fd_ = -1;
+    int directory_watch_ = -1;
+    int file_watch_ = -1;
+    std::string name_;                // Last component of path_
+
+    uint64_t rotations_ = 0;
+    uint64_t truncations_ = 0;
+};
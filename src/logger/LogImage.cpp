@@ -0,0 +1,152 @@
+#include "LogImage.hpp"
+#include "LogIndex.hpp"
+#include "RingFile.hpp"
+#include "StripeManifest.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LogImage::LogImage(const std::string& path) {
+    if (StripeManifest::read(path)) {
+        mapStripes(path);
+    } else {
+        mapFile(path);
+    }
+}
+
+LogImage::~LogImage() {
+    if (map_) {
+        ::munmap(map_, mapped_);
+    }
+}
+
+void LogImage::mapFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Error opening log file: " + path);
+    }
+    if (RingFile::readHeader(fd)) {
+        try {
+            mapRing(fd, path);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Error reading log file size: " + path);
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Error mapping log file: " + path);
+        }
+        map_ = data_ = static_cast<char*>(map);
+        mapped_ = size_;
+    }
+    ::close(fd);
+
+    // Skip the trimmed head (holes or a partial record)
+    if (auto index = LogIndex::read(path)) {
+        if (index->start <= size_) {
+            start_ = index->start;
+            data_ += start_;
+            size_ -= start_;
+        }
+    }
+}
+
+void LogImage::mapStripes(const std::string& manifest_path) {
+    StripeManifest manifest = *StripeManifest::read(manifest_path);
+    striped_ = true;
+
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    if (manifest.block_bytes % page != 0) {
+        throw std::runtime_error("Stripe block size is not page aligned: " + manifest_path);
+    }
+
+    size_ = static_cast<size_t>(manifest.logicalSize(manifest.stripeSizes()));
+    if (size_ == 0) {
+        return;
+    }
+
+    // Reserve the whole logical range, then map blocks over it
+    mapped_ = (size_ + page - 1) / page * page;
+    void* base = ::mmap(nullptr, mapped_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Error reserving address space for " + manifest_path);
+    }
+    map_ = data_ = static_cast<char*>(base);
+
+    std::vector<int> fds;
+    for (const auto& stripe : manifest.stripes) {
+        fds.push_back(::open(stripe.c_str(), O_RDONLY | O_CLOEXEC));
+    }
+
+    bool ok = true;
+    for (uint64_t offset = 0; offset < size_ && ok; offset += manifest.block_bytes) {
+        size_t stripe = manifest.stripeOf(offset);
+        size_t length = std::min<size_t>(manifest.block_bytes, mapped_ - offset);
+        void* block = ::mmap(data_ + offset, length, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                             fds[stripe], static_cast<off_t>(manifest.fileOffsetOf(offset)));
+        ok = fds[stripe] >= 0 && block != MAP_FAILED;
+    }
+
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!ok) {
+        ::munmap(map_, mapped_);
+        map_ = data_ = nullptr;
+        throw std::runtime_error("Error mapping stripe files of " + manifest_path);
+    }
+}
+
+void LogImage::mapRing(int fd, const std::string& path) {
+    RingFile::Header header = *RingFile::readHeader(fd);
+    ring_ = true;
+
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    struct stat st;
+    if (header.capacity % page != 0 || ::fstat(fd, &st) != 0 ||
+            static_cast<uint64_t>(st.st_size) < RingFile::kHeaderBytes + header.capacity) {
+        throw std::runtime_error("Ring log file is damaged: " + path);
+    }
+
+    size_ = static_cast<size_t>(header.tail - header.head);
+    if (size_ == 0) {
+        return;
+    }
+
+    // Two copies of the ring side by side
+    mapped_ = 2 * header.capacity;
+    void* base = ::mmap(nullptr, mapped_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Error reserving address space for " + path);
+    }
+    map_ = static_cast<char*>(base);
+    for (size_t copy = 0; copy < 2; ++copy) {
+        void* view = ::mmap(map_ + copy * header.capacity, header.capacity, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                            fd, static_cast<off_t>(RingFile::kHeaderBytes));
+        if (view == MAP_FAILED) {
+            ::munmap(map_, mapped_);
+            map_ = nullptr;
+            throw std::runtime_error("Error mapping ring log file: " + path);
+        }
+    }
+    data_ = map_ + header.head % header.capacity;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only, contiguous view of a whole logical log.
+//
+// A plain file is simply mapped. For a stripe manifest the blocks of every
+// stripe file are mapped side by side (MAP_FIXED) into one reserved range,
+// so tools see the reassembled stream without copying it. A ring file's data
+// area is mapped twice back to back, so [head, tail) reads in order even
+// where it wraps. A plain file whose head was trimmed by retention starts at
+// the first live record named in its LogIndex.
+class LogImage {
+public:
+    // Constructor maps path; throws on failure
+    explicit LogImage(const std::string& path);
+
+    // Destructor unmaps the view
+    ~LogImage();
+
+    // Non-copyable
+    LogImage(const LogImage&) = delete;
+    LogImage& operator=(const LogImage&) = delete;
+
+    // Accessors
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool striped() const { return striped_; }
+    bool ring() const { return ring_; }
+    uint64_t start() const { return start_; }   // File offset of data() for plain files
+
+private:
+    // Map a plain file
+    void mapFile(const std::string& path);
+
+    // Map every block of a striped log in logical order
+    void mapStripes(const std::string& manifest_path);
+
+    // Map the live part of a ring file in chronological order
+    void mapRing(int fd, const std::string& path);
+
+    char* map_ = nullptr;     // Start of the mapping
+    char* data_ = nullptr;    // Start of the log within it
+    size_t size_ = 0;
+    uint64_t start_ = 0;
+    size_t mapped_ = 0;
+    bool striped_ = false;
+    bool ring_ = false;
+};
@@ -0,0 +1,115 @@
+#include "LogIndex.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t start;
+        uint64_t collapsed;
+        uint64_t collapse_bytes;
+        uint64_t collapse_from_size;
+    };
+    static_assert(sizeof(FileHeader) == 40, "index header must be packed");
+
+    // Version 1 header: magic, version and start only
+    constexpr size_t kHeaderV1Size = 16;
+    static_assert(sizeof(LogIndex::Entry) == 16, "index entry must be packed");
+
+    bool writeAll(int fd, const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::write(fd, p, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            p += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+std::string LogIndex::pathFor(const std::string& log_path) {
+    return log_path + ".idx";
+}
+
+std::optional<LogIndex> LogIndex::read(const std::string& log_path) {
+    int fd = ::open(pathFor(log_path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    FileHeader header{};
+    if (::read(fd, &header, kHeaderV1Size) != static_cast<ssize_t>(kHeaderV1Size) || header.magic != kMagic ||
+            (header.version != 1 && header.version != kVersion)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    if (header.version == kVersion) {
+        size_t rest = sizeof(header) - kHeaderV1Size;
+        if (::read(fd, reinterpret_cast<char*>(&header) + kHeaderV1Size, rest) != static_cast<ssize_t>(rest)) {
+            ::close(fd);
+            return std::nullopt;
+        }
+    }
+
+    LogIndex index;
+    index.start = header.start;
+    index.collapsed = header.collapsed;
+    Entry entry;
+    while (::read(fd, &entry, sizeof(entry)) == static_cast<ssize_t>(sizeof(entry))) {
+        if (entry.offset >= index.start && (index.entries.empty() || entry.offset > index.entries.back().offset)) {
+            index.entries.push_back(entry);
+        }
+    }
+    ::close(fd);
+
+    if (header.collapse_bytes > 0) {
+        // Offsets were shifted ahead of a collapse; the log size says whether it happened
+        struct stat st;
+        if (::stat(log_path.c_str(), &st) != 0) {
+            return std::nullopt;
+        }
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        index.collapsing = true;
+        if (size == header.collapse_from_size) {
+            index.start += header.collapse_bytes;
+            index.collapsed -= header.collapse_bytes;
+            for (auto& kept : index.entries) {
+                kept.offset += header.collapse_bytes;
+            }
+        } else if (size != header.collapse_from_size - header.collapse_bytes) {
+            return std::nullopt;
+        }
+    }
+    return index;
+}
+
+void LogIndex::write(const std::string& log_path) const {
+    std::string path = pathFor(log_path);
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error writing log index: " + temp);
+    }
+    FileHeader header{kMagic, kVersion, start, collapsed, collapse_bytes, collapse_from_size};
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, entries.data(), entries.size() * sizeof(Entry)) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Error installing log index: " + path);
+    }
+}
+
+bool LogIndex::append(int fd, const Entry& entry) {
+    return writeAll(fd, &entry, sizeof(entry));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Sidecar index of a plain log file, kept next to it as "<log>.idx".
+//
+// The writer appends an entry (file offset, wall-clock time) at batch
+// boundaries every so often, so retention can find record boundaries by
+// size and by age. start is the first live byte after the head of the log
+// was trimmed; readers skip everything before it.
+//
+// Collapsing the head moves every offset down, and the index cannot be
+// replaced in the same step. Retention therefore writes the shifted index
+// first, with collapse_bytes and collapse_from_size set, then collapses, then
+// clears them. read() compares the log size against collapse_from_size to
+// tell whether the collapse happened, and shifts the offsets back if not.
+// collapsed counts every byte ever collapsed off the head, so a follower
+// can keep offsets that count from the first byte the log ever held
+// (file offset + collapsed) and rebase them when the file shrinks.
+//
+// On disk: a 40-byte header (magic, version, start, collapsed,
+// collapse_bytes, collapse_from_size) followed by 16-byte entries, all
+// little-endian. Version 1 files have a 16-byte header with only magic,
+// version and start. A torn trailing entry is ignored.
+struct LogIndex {
+    static constexpr uint32_t kMagic = 0x5844494C;     // "LIDX" on disk
+    static constexpr uint32_t kVersion = 3;
+
+    struct Entry {
+        uint64_t offset;
+        uint64_t timestamp_ns;
+    };
+
+    uint64_t start = 0;
+    std::vector<Entry> entries;   // Ascending offsets, all >= start
+    uint64_t collapsed = 0;           // Bytes collapsed off the head so far
+    uint64_t collapse_bytes = 0;      // Pending collapse of the head (0 = none)
+    uint64_t collapse_from_size = 0;  // Log size before that collapse
+    bool collapsing = false;          // From read(): a collapse was pending (already settled)
+
+    // Sidecar path of a log
+    static std::string pathFor(const std::string& log_path);
+
+    // Read the index of a log, settling a pending collapse against the log's
+    // size; returns nullopt if it has none or it does not match the log
+    static std::optional<LogIndex> read(const std::string& log_path);
+
+    // Replace the index atomically (temp file + rename)
+    void write(const std::string& log_path) const;
+
+    // Append one entry to an index file opened with O_APPEND
+    static bool append(int fd, const Entry& entry);
+};
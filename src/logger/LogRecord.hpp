@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Record encodings carried through the producer queues.
+// Producers enqueue compact binary records and the writer renders them to
+// text in batches, so formatting cost stays off the producer threads.
+enum class RecordKind : uint8_t {
+    Text = 0,     // Preformatted text follows the header
+    Counter = 1,  // Rendered as "Thread N: [YYYY-MM-DD HH:MM:SS] Has counter C"
+    Capture = 2,  // Output of a supervised child; every line is rendered as
+                  // "Child N stdout: [YYYY-MM-DD HH:MM:SS] <line>"
+    Trace = 3     // Error line with the stack that logged it; rendered as
+                  // "<line> [stack +0x4f2a1 +0x4e810 0x7f3c1a094ac3]"
+};
+
+// Common prefix of every queued record
+struct RecordHeader {
+    RecordKind kind;
+    uint8_t continued;      // Capture: see below
+    uint16_t channel;       // Interned channel id the writer routes by (0 = main log)
+    uint32_t thread_id;
+    int64_t timestamp_ns;   // system_clock time since the epoch
+};
+static_assert(sizeof(RecordHeader) == 16, "record header must stay compact");
+
+// Capture records: the text follows the header, thread_id holds
+// child * 2 + stream (0 = stdout, 1 = stderr) and continued is set when
+// the text continues a line begun in the previous record
+constexpr uint32_t captureStreamId(int child, int stream) {
+    return static_cast<uint32_t>(child) * 2 + static_cast<uint32_t>(stream);
+}
+
+// Periodic counter message emitted by LoggerThread
+struct CounterRecord {
+    RecordHeader header;
+    uint64_t counter;
+};
+
+// Error line with the raw return addresses of the code that logged it.
+// frame_count uint64_t frames (see StackCapture) follow, then the text.
+struct TraceRecord {
+    RecordHeader header;
+    uint32_t frame_count;
+    uint32_t reserved;
+};
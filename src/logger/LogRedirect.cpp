@@ -0,0 +1,88 @@
+#include "LogRedirect.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    [[noreturn]] void fail(const std::string& what, const std::string& target) {
+        throw std::runtime_error("Error opening " + what + " " + target + ": " + std::strerror(errno));
+    }
+}
+
+LogRedirect::Kind LogRedirect::parseKind(const std::string& name) {
+    if (name == "file") {
+        return Kind::File;
+    }
+    if (name == "fifo") {
+        return Kind::Fifo;
+    }
+    if (name == "socket") {
+        return Kind::Socket;
+    }
+    if (name == "memfd") {
+        return Kind::Memfd;
+    }
+    throw std::invalid_argument("unknown redirect target: " + name + " (file, fifo, socket or memfd)");
+}
+
+int LogRedirect::open(Kind kind, const std::string& target) {
+    if (target.empty()) {
+        throw std::invalid_argument("redirect target needs a path or name");
+    }
+    switch (kind) {
+    case Kind::File: {
+        int fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            fail("file", target);
+        }
+        return fd;
+    }
+    case Kind::Fifo: {
+        // Non-blocking so a FIFO nobody reads fails (ENXIO) instead of
+        // hanging; the writes themselves block like writes to a file
+        int fd = ::open(target.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            fail("FIFO", target);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) {
+            ::close(fd);
+            throw std::invalid_argument(target + " is not a FIFO");
+        }
+        ::fcntl(fd, F_SETFL, 0);
+        return fd;
+    }
+    case Kind::Socket: {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (target.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("socket path too long: " + target);
+        }
+        std::memcpy(address.sun_path, target.c_str(), target.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            int saved = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            errno = saved;
+            fail("socket", target);
+        }
+        return fd;
+    }
+    case Kind::Memfd: {
+        int fd = ::memfd_create(target.c_str(), MFD_CLOEXEC);
+        if (fd < 0) {
+            fail("memfd", target);
+        }
+        return fd;
+    }
+    }
+    throw std::invalid_argument("unknown redirect target");
+}
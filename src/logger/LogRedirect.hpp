@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+// Targets a running logger's plain log file can be redirected to, for
+// streaming the log into an analyzer without touching disk.
+namespace LogRedirect {
+    enum class Kind {
+        File,     // Append to another file
+        Fifo,     // Named pipe; a reader must already have it open
+        Socket,   // AF_UNIX stream socket to connect to
+        Memfd     // Anonymous memory file, read through /proc/<pid>/fd/<fd>
+    };
+
+    // Parse "file", "fifo", "socket" or "memfd"; throws on anything else
+    Kind parseKind(const std::string& name);
+
+    // Open target (a path, or the name of a memfd) for blocking writes;
+    // throws std::runtime_error on failure
+    int open(Kind kind, const std::string& target);
+}
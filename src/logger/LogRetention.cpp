@@ -0,0 +1,170 @@
+#include "LogRetention.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Index the log at least this often
+    constexpr uint64_t kIndexIntervalBytes = 64u << 10;
+    constexpr uint64_t kIndexIntervalNs = 1000000000ull;
+
+    // Retention checks are rate limited to one per interval
+    constexpr uint64_t kCheckIntervalNs = 1000000000ull;
+
+    uint64_t wallClockNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    uint64_t fileSize(int fd) {
+        struct stat st;
+        return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    }
+}
+
+LogRetention::LogRetention(const std::string& log_path, int log_fd, const RetentionPolicy& policy)
+    : log_path_(log_path), log_fd_(log_fd), policy_(policy) {
+    struct stat st;
+    if (::fstat(log_fd, &st) != 0) {
+        throw std::runtime_error("Error reading log file size: " + log_path);
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    block_bytes_ = st.st_blksize > 0 ? static_cast<uint64_t>(st.st_blksize) : 4096;
+
+    // Drop whatever no longer matches the file (it was truncated or replaced)
+    if (auto existing = LogIndex::read(log_path)) {
+        if (existing->start <= size) {
+            index_ = *existing;
+            index_.collapsing = false;
+            while (!index_.entries.empty() && index_.entries.back().offset >= size) {
+                index_.entries.pop_back();
+            }
+        }
+    }
+    if (index_.entries.empty() && size > index_.start) {
+        // Age of older data is unknown; treat it as written now
+        index_.entries.push_back({index_.start, wallClockNs()});
+    }
+    freed_until_ = index_.start / block_bytes_ * block_bytes_;
+    saveIndex();
+}
+
+LogRetention::~LogRetention() {
+    if (index_fd_ >= 0) {
+        ::close(index_fd_);
+    }
+}
+
+void LogRetention::markBoundary() {
+    uint64_t now = wallClockNs();
+    off_t end = ::lseek(log_fd_, 0, SEEK_END);
+    if (end < 0) {
+        return;
+    }
+    uint64_t offset = static_cast<uint64_t>(end);
+
+    if (!index_.entries.empty()) {
+        const LogIndex::Entry& last = index_.entries.back();
+        if (offset <= last.offset ||
+                (offset - last.offset < kIndexIntervalBytes && now - last.timestamp_ns < kIndexIntervalNs)) {
+            return;
+        }
+    }
+    LogIndex::Entry entry{offset, now};
+    index_.entries.push_back(entry);
+    LogIndex::append(index_fd_, entry);
+}
+
+void LogRetention::apply() {
+    uint64_t now = wallClockNs();
+    if (now < next_check_ns_) {
+        return;
+    }
+    next_check_ns_ = now + kCheckIntervalNs;
+
+    // Latest record boundary that everything before may go by each rule.
+    // The newest entry is kept so the log is never emptied completely.
+    uint64_t size = fileSize(log_fd_);
+    uint64_t cut = index_.start;
+    for (size_t i = 0; i + 1 < index_.entries.size(); ++i) {
+        // Bytes in [entry, next) were written before next's timestamp
+        const LogIndex::Entry& next = index_.entries[i + 1];
+        bool too_big = policy_.max_bytes > 0 && size - next.offset >= policy_.max_bytes;
+        bool too_old = policy_.max_age_sec > 0 && next.timestamp_ns + policy_.max_age_sec * 1000000000ull <= now;
+        if (!too_big && !too_old) {
+            break;
+        }
+        cut = index_.entries[i + 1].offset;
+    }
+
+    // Only whole blocks can be freed
+    if (cut / block_bytes_ * block_bytes_ > freed_until_) {
+        try {
+            trim(cut, size);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "; retention disabled\n";
+            policy_ = RetentionPolicy{};
+        }
+    }
+}
+
+void LogRetention::trim(uint64_t cut, uint64_t size) {
+    uint64_t aligned = cut / block_bytes_ * block_bytes_;
+    auto kept = std::find_if(index_.entries.begin(), index_.entries.end(),
+        [&](const LogIndex::Entry& entry) { return entry.offset >= cut; });
+    index_.entries.erase(index_.entries.begin(), kept);
+
+    if (policy_.collapse && aligned < size) {
+        // Everything moves down by the collapsed length. Publish the shifted
+        // index first, marked pending, so it reads back right whether or not
+        // the collapse below completes.
+        LogIndex unshifted = index_;
+        index_.start = cut - aligned;
+        for (auto& entry : index_.entries) {
+            entry.offset -= aligned;
+        }
+        index_.collapsed += aligned;
+        index_.collapse_bytes = aligned;
+        index_.collapse_from_size = size;
+        saveIndex();
+
+        if (::fallocate(log_fd_, FALLOC_FL_COLLAPSE_RANGE, 0, static_cast<off_t>(aligned)) == 0) {
+            index_.collapse_bytes = 0;
+            index_.collapse_from_size = 0;
+            freed_until_ = 0;
+            saveIndex();
+            trimmed_bytes_.fetch_add(aligned, std::memory_order_relaxed);
+            trims_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        index_ = unshifted;
+        std::cerr << "Collapse range not supported on " << log_path_ << "; punching holes instead\n";
+        policy_.collapse = false;
+    }
+
+    // Publish the new start before the old data disappears
+    index_.start = cut;
+    saveIndex();
+    if (::fallocate(log_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(freed_until_),
+                    static_cast<off_t>(aligned - freed_until_)) != 0) {
+        std::cerr << "Error punching hole in " << log_path_ << "; retention disabled\n";
+        policy_ = RetentionPolicy{};
+        return;
+    }
+    trimmed_bytes_.fetch_add(aligned - freed_until_, std::memory_order_relaxed);
+    trims_.fetch_add(1, std::memory_order_relaxed);
+    freed_until_ = aligned;
+}
+
+void LogRetention::saveIndex() {
+    index_.write(log_path_);
+    if (index_fd_ >= 0) {
+        ::close(index_fd_);
+    }
+    index_fd_ = ::open(LogIndex::pathFor(log_path_).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "LogIndex.hpp"
+
+// How much of a log to keep
+struct RetentionPolicy {
+    uint64_t max_bytes = 0;       // Keep at least the newest max_bytes (0 = no limit)
+    uint64_t max_age_sec = 0;     // Drop records older than this (0 = no limit)
+    bool collapse = false;        // Collapse the freed range instead of punching a hole
+};
+
+// Frees the oldest part of a live log file in place.
+//
+// Instead of rotating, the head of the file is deallocated with
+// FALLOC_FL_PUNCH_HOLE (the size and every offset stay the same, the head
+// reads as zeros) or removed with FALLOC_FL_COLLAPSE_RANGE (the file
+// shrinks and later data moves down). Either way the path and inode never
+// change, so tailers and hotswap keep working; LogFollower rebases its
+// position by the index's collapsed count instead of taking the shrink for
+// a truncation. Trims are cut at record
+// boundaries taken from the LogIndex and rounded down to filesystem blocks;
+// the index's start marks the first whole record that is left.
+//
+// Only the writer thread calls into this class.
+class LogRetention {
+public:
+    // Constructor loads (or starts) the index of the log open on log_fd
+    LogRetention(const std::string& log_path, int log_fd, const RetentionPolicy& policy);
+
+    // Destructor closes the index
+    ~LogRetention();
+
+    // Non-copyable
+    LogRetention(const LogRetention&) = delete;
+    LogRetention& operator=(const LogRetention&) = delete;
+
+    // Called before each batch, while the end of the log is a record
+    // boundary: indexes it when due
+    void markBoundary();
+
+    // Trim the head if the policy asks for it; checks at most once a second
+    void apply();
+
+    // Accessors for stats; safe from any thread
+    uint64_t trimmedBytes() const { return trimmed_bytes_.load(std::memory_order_relaxed); }
+    uint64_t trims() const { return trims_.load(std::memory_order_relaxed); }
+
+private:
+    // Cut the log at a record boundary
+    void trim(uint64_t cut, uint64_t size);
+
+    // Rewrite the index file and reopen it for appending
+    void saveIndex();
+
+    std::string log_path_;
+    int log_fd_;
+    int index_fd_ = -1;
+    RetentionPolicy policy_;
+    LogIndex index_;
+    uint64_t block_bytes_;
+    uint64_t freed_until_;        // File offset up to which blocks are punched
+    uint64_t next_check_ns_ = 0;
+
+    std::atomic<uint64_t> trimmed_bytes_{0};
+    std::atomic<uint64_t> trims_{0};
+};
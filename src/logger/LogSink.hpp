@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+// Destination the writer thread hands its batches to
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    // Write the whole buffer; returns false on error
+    virtual bool write(const char* data, size_t size) = 0;
+
+    // Path of the logical log (a file or a stripe manifest)
+    virtual const std::string& path() const = 0;
+
+    // Called by the writer before each batch; the next byte written starts
+    // a record
+    virtual void markBoundary() {}
+
+    // Periodic housekeeping, called by the writer thread between batches
+    virtual void maintain() {}
+
+    // Extra "key=value" lines for the control socket's stats
+    virtual void appendStats(std::ostream&) const {}
+};
@@ -0,0 +1,387 @@
+#include "LogWriter.hpp"
+#include "FrameRecovery.hpp"
+#include "RecordFrame.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    // Write out the batch once it reaches this size
+    constexpr size_t kMaxBatchBytes = 1u << 20;
+
+    // Render deferred records in groups of this many
+    constexpr size_t kMaxBatchRecords = 4096;
+
+    // A pass over the queues stops after this much, so the sink is
+    // maintained between passes even under sustained load
+    constexpr size_t kMaxPassBytes = 4 * kMaxBatchBytes;
+
+    // Idle polling backs off between these bounds
+    constexpr auto kMinIdleWait = std::chrono::milliseconds(1);
+    constexpr auto kMaxIdleWait = std::chrono::milliseconds(50);
+}
+
+LogWriter::LogWriter(LogSink& sink, SegmentPool& pool, const LoggerConfig& config,
+                     IoGovernor* governor, LiveRing* live)
+    : sink_(sink),
+      pool_(pool),
+      governor_(governor),
+      live_(live),
+      framing_(config.framing),
+      queue_max_bytes_(config.queue_max_bytes),
+      idle_release_(config.idle_release_ms),
+      quantum_bytes_(config.drain_quantum_bytes),
+      lazy_records_(config.lazy_records) {
+    // Continue the sequence of an existing framed log so recovery can
+    // tell restarts apart from lost frames
+    if (framing_ != FramingMode::None) {
+        if (auto last = FrameRecovery::lastSequence(sink_.path())) {
+            next_sequence_ = *last + 1;
+        }
+    }
+    if (!config.channels.empty()) {
+        router_ = std::make_unique<ChannelRouter>(config.channels);
+    }
+    if (lazy_records_ == 0) {
+        batch_.reserve(kMaxBatchBytes + 4096);
+    }
+}
+
+LogWriter::~LogWriter() {
+    stop();
+}
+
+SegmentQueue& LogWriter::createQueue(uint32_t weight) {
+    bool bypass = false;
+    if (lazy_records_ > 0) {
+        std::lock_guard<std::mutex> lock(direct_mutex_);
+        bypass = !queueing_;
+    }
+    auto producer = std::make_unique<Producer>();
+    producer->queue = std::make_unique<SegmentQueue>(pool_, queue_max_bytes_,
+                                                     bypass ? static_cast<QueueBypass*>(this) : nullptr);
+    producer->weight = std::max<uint32_t>(1, weight);
+    producer->created = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(queues_mutex_);
+    producers_.push_back(std::move(producer));
+    return *producers_.back()->queue;
+}
+
+void LogWriter::start() {
+    std::lock_guard<std::mutex> lock(direct_mutex_);
+    if (lazy_records_ > 0 && !queueing_) {
+        return;   // take() starts the thread once the budget runs out
+    }
+    startThread();
+}
+
+void LogWriter::startThread() {
+    queueing_ = true;
+    {
+        std::lock_guard<std::mutex> lock(queues_mutex_);
+        for (auto& producer : producers_) {
+            producer->queue->clearBypass();
+        }
+    }
+    batch_.reserve(kMaxBatchBytes + 4096);
+    stopping_ = false;
+    thread_ = std::thread(&LogWriter::run, this);
+    thread_running_ = true;
+}
+
+bool LogWriter::take(const void* data, uint32_t length) {
+    std::lock_guard<std::mutex> lock(direct_mutex_);
+    if (queueing_) {
+        return false;
+    }
+    if (direct_count_ >= lazy_records_) {
+        // Volume says this process is not short-lived after all
+        startThread();
+        return false;
+    }
+    // No writer thread yet, so the writer state is this producer's to use
+    ++direct_count_;
+    sink_.maintain();
+    appendRecord(static_cast<const char*>(data), length);
+    flush();
+    if (router_) {
+        router_->flush(true);
+    }
+    direct_records_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void LogWriter::stop(bool drain) {
+    {
+        // Late records are queued, as they are once the writer has stopped
+        std::lock_guard<std::mutex> lock(direct_mutex_);
+        queueing_ = true;
+    }
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+        final_drain_ = drain;
+    }
+    wake_.notify_all();
+    thread_.join();
+    thread_running_ = false;
+}
+
+WriterStats LogWriter::stats() const {
+    WriterStats stats;
+    stats.records = records_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.batches = batches_.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+    {
+        auto now = std::chrono::steady_clock::now();
+        double sum = 0;
+        double sum_squares = 0;
+        std::lock_guard<std::mutex> lock(queues_mutex_);
+        for (const auto& producer : producers_) {
+            const SegmentQueue& queue = *producer->queue;
+            stats.dropped += queue.dropped();
+            if (queue.pushed() + queue.dropped() == 0) {
+                continue;
+            }
+            double seconds = std::max(1e-3, std::chrono::duration<double>(now - producer->created).count());
+            double rate = static_cast<double>(queue.consumed()) / seconds;
+            double share = rate / producer->weight;
+            stats.min_rate = stats.producers == 0 ? rate : std::min(stats.min_rate, rate);
+            stats.max_rate = std::max(stats.max_rate, rate);
+            sum += share;
+            sum_squares += share * share;
+            ++stats.producers;
+        }
+        if (sum_squares > 0) {
+            stats.fairness = sum * sum / (static_cast<double>(stats.producers) * sum_squares);
+        }
+    }
+    stats.queue_bytes = pool_.bytesInUse();
+    stats.peak_queue_bytes = pool_.peakBytesInUse();
+    stats.resident_bytes = pool_.bytesResident();
+    stats.throttled_ns = governor_ ? governor_->throttledNs() : 0;
+    stats.direct_records = direct_records_.load(std::memory_order_relaxed);
+    stats.writer_running = thread_running_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint16_t LogWriter::channelId(const std::string& name) const {
+    if (!router_) {
+        if (!name.empty()) {
+            throw std::invalid_argument("unknown channel: " + name);
+        }
+        return 0;
+    }
+    return router_->id(name);
+}
+
+void LogWriter::run() {
+    auto idle_wait = kMinIdleWait;
+    auto idle_since = std::chrono::steady_clock::now();
+    bool trimmed = false;
+
+    for (;;) {
+        sink_.maintain();
+        if (drainAll() > 0) {
+            idle_wait = kMinIdleWait;
+            idle_since = std::chrono::steady_clock::now();
+            trimmed = false;
+            continue;
+        }
+
+        // Give queue memory back to the OS once we have been idle long enough
+        if (!trimmed && std::chrono::steady_clock::now() - idle_since >= idle_release_) {
+            pool_.trimIdle();
+            trimmed = true;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        if (stopping_) {
+            break;
+        }
+        wake_.wait_for(lock, idle_wait);
+        idle_wait = std::min(idle_wait * 2, kMaxIdleWait);
+    }
+
+    // Producers have been joined by now; pick up their last records
+    if (final_drain_) {
+        drainAll();
+    }
+    if (router_) {
+        router_->flush(true);   // Held channels too, even when handing over
+    }
+}
+
+std::string LogWriter::takeQueued() {
+    std::string records;
+    std::lock_guard<std::mutex> lock(queues_mutex_);
+    for (auto& producer : producers_) {
+        producer->queue->drain([&](const char* data, uint32_t length) {
+            records.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            records.append(data, length);
+        });
+    }
+    return records;
+}
+
+void LogWriter::replay(const std::string& records, uint64_t next_sequence) {
+    next_sequence_ = next_sequence;
+    size_t pos = 0;
+    uint32_t length;
+    while (pos + sizeof(length) <= records.size()) {
+        std::memcpy(&length, records.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        if (length > records.size() - pos) {
+            break;
+        }
+        appendRecord(records.data() + pos, length);
+        pos += length;
+    }
+    flush();
+    if (router_) {
+        router_->flush(true);
+    }
+}
+
+size_t LogWriter::drainAll() {
+    // Queues are only ever added, so a snapshot stays valid; draining
+    // without the lock keeps createQueue() and stats() from waiting on
+    // a throttled write
+    {
+        std::lock_guard<std::mutex> lock(queues_mutex_);
+        if (active_.size() != producers_.size()) {
+            active_.clear();
+            for (auto& producer : producers_) {
+                active_.push_back(producer.get());
+            }
+        }
+    }
+
+    size_t count = 0;
+    if (quantum_bytes_ == 0) {
+        // Each queue in turn until it is empty
+        for (Producer* producer : active_) {
+            count += producer->queue->drain([this](const char* data, uint32_t length) {
+                appendRecord(data, length);
+            });
+        }
+    } else {
+        size_t pass_bytes = 0;
+        size_t round;
+        do {
+            round = 0;
+            for (Producer* producer : active_) {
+                producer->deficit += static_cast<int64_t>(quantum_bytes_ * producer->weight);
+                if (producer->deficit <= 0) {
+                    continue;   // Still paying off a record bigger than its quantum
+                }
+                size_t bytes = 0;
+                round += producer->queue->drain([&](const char* data, uint32_t length) {
+                    appendRecord(data, length);
+                    bytes += length;
+                }, static_cast<size_t>(producer->deficit));
+                // An emptied queue keeps no credit, so idle producers cannot save up a burst
+                producer->deficit = bytes < static_cast<size_t>(producer->deficit)
+                    ? 0 : producer->deficit - static_cast<int64_t>(bytes);
+                pass_bytes += bytes;
+            }
+            count += round;
+        } while (round > 0 && pass_bytes < kMaxPassBytes);
+    }
+    flush();
+    if (router_) {
+        router_->flush(false);
+    }
+    return count;
+}
+
+void LogWriter::appendRecord(const char* data, uint32_t length) {
+    if (router_ && length >= sizeof(RecordHeader)) {
+        uint16_t channel;
+        std::memcpy(&channel, data + offsetof(RecordHeader, channel), sizeof(channel));
+        if (router_->routes(channel)) {
+            router_->add(channel, data, length);
+            return;
+        }
+    }
+    formatter_.add(data, length);
+    if (formatter_.pending() >= kMaxBatchRecords || formatter_.pendingTextBytes() >= kMaxBatchBytes) {
+        renderPending();
+        if (batch_.size() >= kMaxBatchBytes) {
+            flush();
+        }
+    }
+}
+
+void LogWriter::renderPending() {
+    batch_records_ += static_cast<uint32_t>(formatter_.pending());
+    if (framing_ != FramingMode::Record) {
+        formatter_.render(batch_);
+        return;
+    }
+
+    // Per-record frames need the line boundaries
+    rendered_.clear();
+    line_ends_.clear();
+    formatter_.render(rendered_, &line_ends_);
+    size_t start = 0;
+    for (size_t end : line_ends_) {
+        RecordFrame::append(batch_, next_sequence_++, {rendered_.data() + start, end - start});
+        start = end;
+    }
+}
+
+void LogWriter::flush() {
+    renderPending();
+    if (batch_.empty()) {
+        return;
+    }
+
+    const std::string* out = &batch_;
+    if (framing_ == FramingMode::Block) {
+        frame_.clear();
+        RecordFrame::append(frame_, next_sequence_++, batch_);
+        out = &frame_;
+    }
+
+    sink_.markBoundary();
+    if (writeShaped(out->data(), out->size())) {
+        records_.fetch_add(batch_records_, std::memory_order_relaxed);
+        bytes_.fetch_add(out->size(), std::memory_order_relaxed);
+        if (live_) {
+            live_->publish(out->data(), out->size());
+        }
+    } else {
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Error writing to log file " << sink_.path() << "\n";
+    }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    batch_.clear();
+    batch_records_ = 0;
+}
+
+bool LogWriter::writeShaped(const char* data, size_t size) {
+    if (!governor_ || !governor_->enabled()) {
+        return sink_.write(data, size);
+    }
+
+    // Split big batches so the device sees a steady rate instead of bursts.
+    // While we wait here producers keep filling their queues; the overflow
+    // policy decides what happens when those are full.
+    while (size > 0) {
+        size_t piece = std::min(size, governor_->maxWriteBytes());
+        governor_->acquire(piece);
+        if (!sink_.write(data, piece)) {
+            return false;
+        }
+        data += piece;
+        size -= piece;
+    }
+    return true;
+}
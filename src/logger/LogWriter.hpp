@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BatchFormatter.hpp"
+#include "ChannelRouter.hpp"
+#include "IoGovernor.hpp"
+#include "LiveRing.hpp"
+#include "LogSink.hpp"
+#include "LoggerConfig.hpp"
+#include "SegmentPool.hpp"
+#include "SegmentQueue.hpp"
+
+// Counters reported by the writer
+struct WriterStats {
+    uint64_t records = 0;          // Records written to the sink
+    uint64_t bytes = 0;            // Bytes written to the sink
+    uint64_t batches = 0;          // write() batches issued
+    uint64_t dropped = 0;          // Records producers could not enqueue
+    uint64_t write_errors = 0;     // Failed batch writes
+    size_t queue_bytes = 0;        // Queue memory currently in use
+    size_t peak_queue_bytes = 0;   // High-water mark of queue memory
+    size_t resident_bytes = 0;     // Queue memory not yet returned to the OS
+    uint64_t throttled_ns = 0;     // Time the writer spent waiting on the governor
+    uint64_t direct_records = 0;   // Records written by their producers in lazy mode
+    bool writer_running = false;   // Writer thread started (lazy mode starts it late)
+
+    // Fairness across the producers that have logged anything: Jain's
+    // index of their records per second divided by their weights (1 =
+    // every producer got its weighted share), and the lowest and highest
+    // raw records per second
+    size_t producers = 0;
+    double fairness = 1.0;
+    double min_rate = 0;
+    double max_rate = 0;
+};
+
+// Background thread that drains every producer queue into the log file.
+// Producers never touch the file; each owns one SegmentQueue. Records
+// tagged with a configured channel go to that channel's file instead.
+//
+// Queues are drained by deficit round robin: every round each producer
+// may take its weight times the quantum in record bytes, and credit it
+// did not use while it had records carries over to the next round. A
+// producer that never stops pushing can no longer keep the writer on its
+// queue while the others fill up and drop.
+//
+// In lazy mode (lazy_records > 0) start() starts no thread. The writer is
+// the bypass of every queue instead, and the producers write their first
+// lazy_records records themselves, one write per record under a lock.
+// The record after those starts the thread and goes into its queue, which
+// only then takes a segment; from there on everything is queued. A
+// process that logs a few lines and exits never pays for the thread or
+// the queue memory.
+class LogWriter : private QueueBypass {
+public:
+    // Constructor takes the output sink, the shared segment pool, settings,
+    // an optional bandwidth governor and an optional ring that receives
+    // every batch once it is written
+    LogWriter(LogSink& sink, SegmentPool& pool, const LoggerConfig& config,
+              IoGovernor* governor = nullptr, LiveRing* live = nullptr);
+
+    // Destructor stops the writer thread after a final drain
+    ~LogWriter() override;
+
+    // Non-copyable
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    // Create a queue for one producer with its drain weight; valid until
+    // the writer is destroyed
+    SegmentQueue& createQueue(uint32_t weight = 1);
+
+    // Start and stop the writer thread; stop() drains everything left
+    // unless drain is false. In lazy mode start() leaves starting the
+    // thread to the first record past the lazy budget.
+    void start();
+    void stop(bool drain = true);
+
+    // After stop(false): take the records still queued, each prefixed with
+    // its uint32 length
+    std::string takeQueued();
+
+    // Before start(): write records taken from a previous process and
+    // continue its frame sequence
+    void replay(const std::string& records, uint64_t next_sequence);
+
+    // Sequence number of the next frame
+    uint64_t nextSequence() const { return next_sequence_; }
+
+    // Snapshot of the writer counters
+    WriterStats stats() const;
+
+    // Interned id producers tag records of the named channel with ("" = the
+    // main log); throws if the channel is not configured
+    uint16_t channelId(const std::string& name) const;
+
+    // Routing table of the configured channels (null without any)
+    const ChannelRouter* router() const { return router_.get(); }
+
+private:
+    // Producer, lazy mode: write one record straight to the sink while the
+    // budget lasts; the first record past it starts the writer thread
+    bool take(const void* data, uint32_t length) override;
+
+    // Start the writer thread and queue every record from now on; needs direct_mutex_
+    void startThread();
+
+    // Writer thread main loop
+    void run();
+
+    // Move every queued record into the batch buffer and write it out
+    size_t drainAll();
+
+    // Add one queued record to the pending batch
+    void appendRecord(const char* data, uint32_t length);
+
+    // Render pending records into the batch buffer, framing them if configured
+    void renderPending();
+
+    // Write the batch buffer to the sink
+    void flush();
+
+    // Write one buffer, shaped by the governor if there is one
+    bool writeShaped(const char* data, size_t size);
+
+    LogSink& sink_;
+    SegmentPool& pool_;
+    IoGovernor* governor_;
+    LiveRing* live_;
+    std::unique_ptr<ChannelRouter> router_;
+    FramingMode framing_;
+    size_t queue_max_bytes_;
+    std::chrono::milliseconds idle_release_;
+
+    // One producer queue and its scheduling state
+    struct Producer {
+        std::unique_ptr<SegmentQueue> queue;
+        uint32_t weight;
+        std::chrono::steady_clock::time_point created;
+        int64_t deficit = 0;    // Writer thread: unused credit in bytes
+    };
+
+    size_t quantum_bytes_;
+    mutable std::mutex queues_mutex_;
+    std::vector<std::unique_ptr<Producer>> producers_;
+
+    // Lazy mode: records written directly so far, and whether they are
+    // queued now (the thread started or the writer stopped)
+    size_t lazy_records_;
+    std::mutex direct_mutex_;
+    size_t direct_count_ = 0;
+    bool queueing_ = false;
+    std::atomic<uint64_t> direct_records_{0};
+    std::atomic<bool> thread_running_{false};
+
+    std::thread thread_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool final_drain_ = true;
+
+    // Writer thread state
+    std::vector<Producer*> active_;
+    BatchFormatter formatter_;
+    std::vector<size_t> line_ends_;
+    std::string rendered_;
+    std::string batch_;
+    std::string frame_;
+    uint64_t next_sequence_ = 0;
+    uint32_t batch_records_ = 0;
+
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> write_errors_{0};
+};
@@ -1,19 +1,35 @@
 #include "LoggerApp.hpp"
 #include <iostream>
-#include <fstream>
 #include <mutex>  // Added missing mutex header
 #include <chrono>
 #include <thread> // For sleep functions
 #include <csignal>
 #include <random>
 #include <atomic>  // Added missing atomic header
+#include <sstream>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include "ChildCapture.hpp"
+#include "CollectorSink.hpp"
+#include "Handover.hpp"
+#include "LogRedirect.hpp"
+#include "RingFileSink.hpp"
+#include "StripedSink.hpp"
+#include "TieredSink.hpp"
+#include "VmspliceSink.hpp"
 
 // Global variables with better encapsulation in anonymous namespace
 namespace {
-    std::ofstream log_file;
-    std::mutex file_mutex;
     std::atomic<bool> running{true};
     int sleep_ms = 1000; // Default value
+    OverflowPolicy overflow = OverflowPolicy::Drop;
+    int block_timeout_ms = 100;
     
     // Signal handler for CTRL+C
     void handle_sigint(int) {
@@ -24,49 +40,265 @@ namespace {
 
 // Make global variables accessible to other files that need them
 namespace GlobalState {
-    extern std::ofstream& getLogFile() { return log_file; }
-    extern std::mutex& getFileMutex() { return file_mutex; }
     extern bool isRunning() { return running; }
     extern int getSleepMs() { return sleep_ms; }
+    extern OverflowPolicy getOverflowPolicy() { return overflow; }
+    extern int getBlockTimeoutMs() { return block_timeout_ms; }
 }
 
-LoggerApp::LoggerApp(const std::string& logfile_path, int thread_count, int sleep_ms_value) {
+namespace {
+    LoggerConfig makeConfig(const std::string& logfile_path, int thread_count, int sleep_ms_value) {
+        LoggerConfig config;
+        config.logfile_path = logfile_path;
+        config.thread_count = thread_count;
+        config.sleep_ms = sleep_ms_value;
+        return config;
+    }
+}
+
+LoggerApp::LoggerApp(const std::string& logfile_path, int thread_count, int sleep_ms_value)
+    : LoggerApp(makeConfig(logfile_path, thread_count, sleep_ms_value)) {}
+
+LoggerApp::LoggerApp(const LoggerConfig& config) {
+    const std::string& logfile_path = config.logfile_path;
+    const int thread_count = config.thread_count;
+
     // Validate and store sleep_ms globally
-    if (sleep_ms_value < 0) {
+    if (config.sleep_ms < 0) {
         throw std::invalid_argument("sleep_ms must be a non-negative integer");
     }
-    sleep_ms = sleep_ms_value;
+    sleep_ms = config.sleep_ms;
+
+    overflow = config.overflow;
+    block_timeout_ms = config.block_timeout_ms;
+
+    // Started by the "upgrade" command of a previous binary?
+    std::optional<Handover> handover = Handover::take();
+    command_line_ = config.command_line;
+    char exe[PATH_MAX];
+    ssize_t exe_length = ::readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (exe_length > 0) {
+        exe_path_.assign(exe, static_cast<size_t>(exe_length));
+    }
     
-    // Open log file with proper error handling
-    log_file.open(logfile_path, std::ios::app);
-    if (!log_file) {
-        throw std::runtime_error("Error opening log file: " + logfile_path);
+    // Open log file (or stripe set) and set up the writer that owns it
+    int layouts = !config.stripe_dirs.empty() + !config.mirror_paths.empty() + (config.ring_bytes > 0);
+    if (layouts > 1) {
+        throw std::invalid_argument("--stripe, --mirror and --ring-kb cannot be combined");
+    }
+    bool plain_only = config.retain_bytes > 0 || config.retain_sec > 0 || config.dirty_max_bytes > 0 ||
+                      !config.spill_dir.empty();
+    if (plain_only && layouts > 0) {
+        throw std::invalid_argument("retention, --dirty-max-kb and --spill only apply to a plain log file");
+    }
+    if (config.file_io == FileIo::Vmsplice && (plain_only || layouts > 0)) {
+        throw std::invalid_argument("--file-io=vmsplice only applies to a plain log file without retention, "
+                                    "--dirty-max-kb or --spill");
+    }
+    if (!config.collector_path.empty() &&
+        (layouts > 0 || config.file_io != FileIo::Write || config.framing != FramingMode::None ||
+         !config.spill_dir.empty())) {
+        throw std::invalid_argument("--collector takes a plain text log without --framing, --spill or --file-io");
+    }
+    if (config.ring_bytes > 0 && config.framing == FramingMode::None) {
+        throw std::invalid_argument("a ring log needs --framing=record or --framing=block");
+    }
+    config_ = config;
+    openOutput(handover ? std::exchange(handover->log_fd, -1) : -1);
+
+    // One queue per producer thread, and one per stream of each child
+    size_t queue_count = static_cast<size_t>(std::max(thread_count, 0)) + 2 * config.exec_commands.size();
+    pool_ = std::make_unique<SegmentPool>(config.segment_bytes, config.poolBytes(queue_count));
+
+    // Bandwidth governor: explicit limits, else a share of the cgroup's io.max
+    uint64_t io_rate = config.io_bytes_per_sec;
+    uint64_t io_iops = config.io_iops;
+    if (config.io_from_cgroup) {
+        CgroupIoLimit limit = IoGovernor::readCgroupLimit(logfile_path);
+        if (io_rate == 0) {
+            io_rate = limit.bytes_per_sec * config.io_cgroup_percent / 100;
+        }
+        if (io_iops == 0) {
+            io_iops = limit.iops * config.io_cgroup_percent / 100;
+        }
+    }
+    governor_ = std::make_unique<IoGovernor>(io_rate, io_iops);
+    openWriter();
+    producers_ = std::make_unique<ThreadGroup>(config.thread_stack_bytes, config.spawn_threads);
+
+    if (!config.control_path.empty()) {
+        if (handover && handover->control_fd >= 0) {
+            control_ = std::make_unique<ControlServer>(config.control_path, handover->control_fd);
+            handover->control_fd = -1;
+        } else {
+            control_ = std::make_unique<ControlServer>(config.control_path);
+        }
+        registerCommands();
+    }
+
+    // Write what the previous binary had queued before anything new
+    if (handover) {
+        if (handover->control_fd >= 0) {
+            ::close(handover->control_fd);   // Not needed with this configuration
+        }
+        std::string records = handover->queue_fd >= 0 ? Handover::readRecords(handover->queue_fd) : "";
+        writer_->replay(records, handover->next_sequence);
+        std::cout << "Resumed after upgrade (" << records.size() << " queued bytes replayed).\n";
     }
     
     // Set up signal handler
     std::signal(SIGINT, handle_sigint);
     
     // Initialize threads
-    if (thread_count <= 0) {
+    if (thread_count < 0 || (thread_count == 0 && config.exec_commands.empty())) {
         throw std::invalid_argument("thread_count must be a positive integer");
     }
     
     // Store thread-related info
     thread_count_ = thread_count;
+    exec_commands_ = config.exec_commands;
+    thread_weights_ = config.thread_weights;
+}
+
+void LoggerApp::openOutput(int log_fd) {
+    if (config_.ring_bytes > 0) {
+        sink_ = std::make_unique<RingFileSink>(config_.logfile_path, config_.ring_bytes);
+    } else if (!config_.stripe_dirs.empty()) {
+        sink_ = std::make_unique<StripedSink>(config_.logfile_path, config_.stripe_dirs, config_.stripe_block_bytes);
+    } else if (!config_.mirror_paths.empty()) {
+        std::vector<std::string> paths{config_.logfile_path};
+        paths.insert(paths.end(), config_.mirror_paths.begin(), config_.mirror_paths.end());
+        auto mirror = std::make_unique<MirrorSink>(paths, config_.mirror_quorum, config_.mirror_max_lag_bytes);
+        mirror_ = mirror.get();
+        sink_ = std::move(mirror);
+    } else if (config_.file_io == FileIo::Vmsplice) {
+        sink_ = std::make_unique<VmspliceSink>(config_.logfile_path);
+    } else {
+        std::unique_ptr<FileSink> file;
+        if (log_fd >= 0) {
+            file = std::make_unique<FileSink>(config_.logfile_path, log_fd);
+            log_fd = -1;
+        } else {
+            file = std::make_unique<FileSink>(config_.logfile_path);
+        }
+        file_ = file.get();
+        if (config_.retain_bytes > 0 || config_.retain_sec > 0) {
+            RetentionPolicy policy;
+            policy.max_bytes = config_.retain_bytes;
+            policy.max_age_sec = config_.retain_sec;
+            policy.collapse = config_.retain_collapse;
+            file->enableRetention(policy);
+        }
+        if (config_.dirty_max_bytes > 0) {
+            file->enableWriteback(config_.dirty_max_bytes);
+        }
+        if (!config_.spill_dir.empty()) {
+            sink_ = std::make_unique<TieredSink>(std::move(file), config_.spill_dir, config_.spill_latency_ms);
+        } else if (!config_.collector_path.empty()) {
+            std::string app = config_.collector_app;
+            if (app.empty()) {
+                auto slash = config_.logfile_path.find_last_of('/');
+                app = slash == std::string::npos ? config_.logfile_path : config_.logfile_path.substr(slash + 1);
+            }
+            sink_ = std::make_unique<CollectorSink>(config_.collector_path, app, std::move(file));
+        } else {
+            sink_ = std::move(file);
+        }
+    }
+    if (log_fd >= 0) {
+        ::close(log_fd);   // Only a plain log file continues on the inherited descriptor
+    }
+}
+
+void LoggerApp::openWriter() {
+    if (!config_.live_name.empty()) {
+        live_ = std::make_unique<LiveRing>(config_.live_name, config_.live_bytes);
+    }
+    writer_ = std::make_unique<LogWriter>(*sink_, *pool_, config_, governor_.get(), live_.get());
+    threads_channel_ = writer_->channelId(config_.threads_channel);
+    stdout_channel_ = writer_->channelId(config_.stdout_channel);
+    stderr_channel_ = writer_->channelId(config_.stderr_channel);
 }
 
 LoggerApp::~LoggerApp() {
-    // Join any remaining threads and close file in destructor
+    // Join any remaining threads; members close the file afterwards
     joinAllThreads();
-    if (log_file.is_open()) {
-        log_file.close();
-    }
 }
 
 void LoggerApp::run() {
-    std::cout << "Creating " << thread_count_ << " threads...\n";
+    writer_->start();
+    if (control_) {
+        control_->start();
+    }
+
+    startProducers();
+
+    // Supervised children log through queues of their own, one per stream
+    size_t max_record = pool_->payloadCapacity() - sizeof(uint32_t);
+    for (size_t i = 0; i < exec_commands_.size(); ++i) {
+        SegmentQueue& out_queue = writer_->createQueue();
+        SegmentQueue& err_queue = writer_->createQueue();
+        auto child = std::make_unique<ChildCapture>(static_cast<int>(i), exec_commands_[i],
+                                                    out_queue, err_queue, max_record,
+                                                    stdout_channel_, stderr_channel_);
+        child->start();
+        std::cout << "Child " << i << " started (pid " << child->pid() << "): " << exec_commands_[i] << "\n";
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        children_.push_back(std::move(child));
+    }
+
+    if (thread_count_ > 0) {
+        std::cout << "\nAll threads are running. Each thread writes to the log file every " 
+                  << sleep_ms << " ms.\n";
+    }
+    std::cout << "Press Ctrl+C to gracefully terminate the process.\n";
+
+    for (;;) {
+        // Wait for CTRL+C, or for the children when they are all there is;
+        // those are often short commands, so notice their end sooner
+        auto poll = std::chrono::milliseconds(thread_count_ == 0 ? 5 : 100);
+        while (running) {
+            std::this_thread::sleep_for(poll);
+            if (thread_count_ == 0 && std::all_of(children_.begin(), children_.end(),
+                                                  [](const auto& child) { return child->finished(); })) {
+                running = false;
+            }
+        }
+
+        std::string upgrade_path;
+        {
+            std::lock_guard<std::mutex> lock(upgrade_mutex_);
+            upgrade_path = upgrade_path_;
+            upgrade_closed_ = upgrade_path.empty();   // Shutting down: refuse late requests
+        }
+        if (upgrade_path.empty()) {
+            break;
+        }
+
+        // Only returns if exec() failed; the output is open again by then
+        std::string error;
+        try {
+            error = upgrade(upgrade_path);
+        } catch (const std::exception& e) {
+            finishUpgrade(std::string("upgrade failed: ") + e.what(), true);
+            throw;
+        }
+        finishUpgrade(error, false);
+        running = true;
+        startProducers();
+    }
     
-    // Create and start threads using modern C++ random
+    joinAllThreads();
+
+    WriterStats stats = writer_->stats();
+    std::cout << "Wrote " << stats.records << " records (" << stats.bytes << " bytes), dropped "
+              << stats.dropped << ", peak queue memory " << stats.peak_queue_bytes / 1024 << " KiB.\n";
+    std::cout << "Application has terminated gracefully.\n";
+}
+
+void LoggerApp::startProducers() {
+    // Queues come from the pool, so they are made here before any thread
+    // runs; the threads then only have to be created
     std::mt19937 gen{std::random_device{}()};
     std::uniform_int_distribution<> jitter_dist(0, 1000);
     
@@ -74,41 +306,262 @@ void LoggerApp::run() {
         // Generate jitter with both random and deterministic components
         int jitter_ms = jitter_dist(gen) + (i * 37) % 200;
         
-        // Create unique thread object with its parameters
-        auto logger = std::make_unique<LoggerThread>(i, jitter_ms);
-        
-        // Launch thread with the functor
-        threads_.emplace_back(std::thread(std::ref(*logger)));
-        
-        // Store the logger object so it lives as long as the thread
-        loggers_.push_back(std::move(logger));
-        
-        std::cout << "Thread " << i << " started!\n";
+        uint32_t weight = static_cast<size_t>(i) < thread_weights_.size() ? thread_weights_[i] : 1;
+        loggers_.push_back(std::make_unique<LoggerThread>(i, jitter_ms, writer_->createQueue(weight), threads_channel_));
     }
 
-    std::cout << "\nAll threads are running. Each thread writes to the log file every " 
-              << sleep_ms << " ms.\n";
-    std::cout << "Press Ctrl+C to gracefully terminate the process.\n";
+    if (thread_count_ > 0) {
+        std::cout << "Creating " << thread_count_ << " threads...\n";
+        auto started = std::chrono::steady_clock::now();
+        try {
+            producers_->start(loggers_.size(), [this](size_t i) { (*loggers_[i])(); });
+        } catch (...) {
+            // The ones that did start stop with the rest of the app
+            running = false;
+            throw;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+        std::cout << "Started " << producers_->size() << " threads in " << elapsed.count() / 1000.0 << " ms ("
+                  << producers_->stackBytes() / 1024 << " KiB stacks).\n";
+    }
+}
 
-    // Wait for CTRL+C
-    while (running) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+void LoggerApp::finishUpgrade(const std::string& error, bool closed) {
+    {
+        std::lock_guard<std::mutex> lock(upgrade_mutex_);
+        upgrade_path_.clear();
+        upgrade_error_ = error;
+        upgrade_closed_ = closed;
     }
-    
-    joinAllThreads();
-    std::cout << "Application has terminated gracefully.\n";
+    upgrade_done_.notify_all();
 }
 
 void LoggerApp::joinAllThreads() {
-    if (!threads_.empty()) {
+    joinProducers();
+
+    // Producers are gone; flush whatever they queued
+    if (control_) {
+        control_->stop();
+    }
+    if (writer_) {
+        writer_->stop();
+    }
+}
+
+void LoggerApp::joinProducers() {
+    if (producers_ && producers_->size() > 0) {
+        size_t count = producers_->size();
         std::cout << "Waiting for all threads to finish...\n";
-        for (size_t i = 0; i < threads_.size(); ++i) {
-            if (threads_[i].joinable()) {
-                threads_[i].join();
-                std::cout << "Thread " << i << " has terminated.\n";
+        producers_->join();
+        std::cout << "All " << count << " threads have terminated.\n";
+    }
+    loggers_.clear();
+
+    // Children are producers too: stop them and keep what they still print
+    for (size_t i = 0; i < children_.size(); ++i) {
+        children_[i]->stop();
+        std::cout << "Child " << i << " has terminated.\n";
+    }
+    std::lock_guard<std::mutex> lock(children_mutex_);
+    children_.clear();
+}
+
+std::string LoggerApp::upgrade(const std::string& binary) {
+    std::cout << "Upgrading to " << binary << "...\n";
+    joinProducers();
+
+    // Stop without draining; what is still queued travels in a memfd so
+    // the new binary writes it next, in order and exactly once. The control
+    // server keeps running: its thread waits in the "upgrade" command for
+    // the outcome, and the new binary gets a copy of the listening socket.
+    Handover handover;
+    handover.control_fd = ::fcntl(control_->listenFd(), F_DUPFD_CLOEXEC, 3);
+    writer_->stop(false);
+    std::string records = writer_->takeQueued();
+    handover.next_sequence = writer_->nextSequence();
+    handover.queue_fd = Handover::writeRecords(records);
+    if (file_ && !file_->redirected()) {   // A redirected one is reopened by path
+        handover.log_fd = ::fcntl(file_->fd(), F_DUPFD_CLOEXEC, 3);
+    }
+
+    // Tear down the output path so asynchronous sinks finish their writes
+    writer_.reset();
+    live_.reset();   // Subscribers see it closed and attach to the new ring
+    sink_.reset();
+    file_ = nullptr;
+    mirror_ = nullptr;
+
+    for (int fd : {handover.log_fd, handover.control_fd, handover.queue_fd}) {
+        Handover::inherit(fd);
+    }
+    handover.publish();
+    std::cout << "Handing over " << records.size() << " queued bytes.\n";
+    std::cout.flush();
+
+    std::vector<std::string> args = command_line_.empty() ? std::vector<std::string>{binary} : command_line_;
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    ::execv(binary.c_str(), argv.data());
+
+    // Still here: carry on with this binary and write the taken records
+    // first, as the new one would have
+    std::string error = "exec of " + binary + " failed: " + std::strerror(errno);
+    ::unsetenv(Handover::kEnvironmentName);
+    for (int fd : {handover.log_fd, handover.control_fd, handover.queue_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    std::cerr << "Error: " << error << "; continuing with this binary\n";
+    openOutput(-1);
+    openWriter();
+    writer_->replay(records, handover.next_sequence);
+    writer_->start();
+    std::cout << "Resumed after failed upgrade (" << records.size() << " queued bytes replayed).\n";
+    return error;
+}
+
+void LoggerApp::registerCommands() {
+    control_->addCommand("stats", [this](const std::string&) {
+        return formatStats();
+    });
+
+    // set io.bytes_per_sec=N io.iops=N
+    control_->addCommand("set", [this](const std::string& args) {
+        uint64_t rate = governor_->bytesPerSec();
+        uint64_t iops = governor_->iops();
+        std::istringstream settings(args);
+        std::string setting;
+        while (settings >> setting) {
+            auto eq = setting.find('=');
+            std::string key = setting.substr(0, eq);
+            if (eq == std::string::npos) {
+                throw std::invalid_argument("expected key=value: " + setting);
+            }
+            uint64_t value = std::stoull(setting.substr(eq + 1));
+            if (key == "io.bytes_per_sec") {
+                rate = value;
+            } else if (key == "io.iops") {
+                iops = value;
+            } else {
+                throw std::invalid_argument("unknown setting: " + key);
+            }
+        }
+        governor_->setLimits(rate, iops);
+        return std::string();
+    });
+
+    // upgrade [path]: exec a new binary (default: this one's path) that
+    // takes over the log, the control socket and the queued records
+    control_->addCommand("upgrade", [this](const std::string& args) {
+        {
+            std::lock_guard<std::mutex> lock(children_mutex_);
+            if (!children_.empty()) {
+                throw std::runtime_error("upgrade is not supported while supervising children");
             }
         }
-        threads_.clear();
-        loggers_.clear();
+        std::string binary = args.empty() ? exe_path_ : args;
+        if (binary.empty() || ::access(binary.c_str(), X_OK) != 0) {
+            throw std::invalid_argument("not an executable: " + binary);
+        }
+        // Reply once the upgrade is over: on success the new binary has
+        // taken over and this connection closes without one
+        std::unique_lock<std::mutex> lock(upgrade_mutex_);
+        if (upgrade_closed_ || !upgrade_path_.empty()) {
+            throw std::runtime_error("the logger is shutting down or already upgrading");
+        }
+        upgrade_path_ = binary;
+        running = false;
+        upgrade_done_.wait(lock, [this] { return upgrade_path_.empty(); });
+        if (!upgrade_error_.empty()) {
+            throw std::runtime_error(upgrade_error_);
+        }
+        return "binary=" + binary + "\n";
+    });
+
+    // redirect fifo|socket|memfd|file TARGET, or redirect back: point the
+    // log file's descriptor somewhere else without touching the queue
+    if (file_) {
+        control_->addCommand("redirect", [this](const std::string& args) {
+            std::istringstream words(args);
+            std::string kind_name;
+            std::string target;
+            words >> kind_name >> target;
+            int fd = -1;
+            std::ostringstream reply;
+            if (kind_name == "back") {
+                reply << "target=" << file_->path() << "\n";
+            } else {
+                LogRedirect::Kind kind = LogRedirect::parseKind(kind_name);
+                fd = LogRedirect::open(kind, target);
+                reply << "target=" << kind_name << ":" << target << "\n";
+                if (kind == LogRedirect::Kind::Memfd) {
+                    reply << "read=/proc/" << ::getpid() << "/fd/" << file_->fd() << "\n";
+                }
+            }
+            if (!file_->redirect(fd, kind_name + ":" + target, std::chrono::seconds(2))) {
+                reply << "pending=1\n";   // The writer is stuck in a write; it switches after it
+            }
+            return reply.str();
+        });
+    }
+
+    // sync [timeout_ms]: wait until a quorum of mirrors has synced everything
+    // written so far
+    if (mirror_) {
+        control_->addCommand("sync", [this](const std::string& args) {
+            int timeout_ms = args.empty() ? 5000 : std::stoi(args);
+            if (!mirror_->waitDurable(std::chrono::milliseconds(timeout_ms))) {
+                throw std::runtime_error("timed out waiting for mirror quorum");
+            }
+            return "durable=" + std::to_string(mirror_->stats().durable) + "\n";
+        });
+    }
+}
+
+std::string LoggerApp::formatStats() const {
+    WriterStats stats = writer_->stats();
+    std::ostringstream out;
+    out << "records=" << stats.records << "\n"
+        << "bytes=" << stats.bytes << "\n"
+        << "batches=" << stats.batches << "\n"
+        << "dropped=" << stats.dropped << "\n"
+        << "write_errors=" << stats.write_errors << "\n"
+        << "queue_bytes=" << stats.queue_bytes << "\n"
+        << "peak_queue_bytes=" << stats.peak_queue_bytes << "\n"
+        << "resident_bytes=" << stats.resident_bytes << "\n"
+        << "direct_records=" << stats.direct_records << "\n"
+        << "writer_running=" << (stats.writer_running ? 1 : 0) << "\n"
+        << "io.bytes_per_sec=" << governor_->bytesPerSec() << "\n"
+        << "io.iops=" << governor_->iops() << "\n"
+        << "io.throttled_ms=" << stats.throttled_ns / 1000000 << "\n"
+        << "fairness.producers=" << stats.producers << "\n"
+        << "fairness.jain=" << stats.fairness << "\n"
+        << "fairness.min_rate=" << stats.min_rate << "\n"
+        << "fairness.max_rate=" << stats.max_rate << "\n";
+    if (!exec_commands_.empty()) {
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        size_t running_children = 0;
+        uint64_t captured_bytes = 0;
+        uint64_t captured_lines = 0;
+        for (const auto& child : children_) {
+            running_children += child->finished() ? 0 : 1;
+            captured_bytes += child->bytes();
+            captured_lines += child->lines();
+        }
+        out << "capture.children_running=" << running_children << "\n"
+            << "capture.bytes=" << captured_bytes << "\n"
+            << "capture.lines=" << captured_lines << "\n";
+    }
+    sink_->appendStats(out);
+    if (writer_->router()) {
+        writer_->router()->appendStats(out);
+    }
+    if (live_) {
+        live_->appendStats(out);
     }
+    return out.str();
 }
\ No newline at end of file
@@ -4,13 +4,29 @@
 #include <vector>
 #include <thread>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "ThreadLogger.hpp"  // Updated to match your filename
+#include "ChildCapture.hpp"
+#include "LoggerConfig.hpp"
+#include "ControlServer.hpp"
+#include "FileSink.hpp"
+#include "IoGovernor.hpp"
+#include "LiveRing.hpp"
+#include "LogSink.hpp"
+#include "LogWriter.hpp"
+#include "MirrorSink.hpp"
+#include "SegmentPool.hpp"
+#include "ThreadGroup.hpp"
 
 // Logger application class
 class LoggerApp {
 public:
     // Constructor takes log file path, number of threads, and sleep duration
     LoggerApp(const std::string& logfile_path, int thread_count, int sleep_ms_value);
+
+    // Constructor taking the full set of options
+    explicit LoggerApp(const LoggerConfig& config);
     
     // Destructor ensures all resources are properly released
     ~LoggerApp();
@@ -21,13 +37,75 @@ public:
     
     // Main method to run the application
     void run();
+
+    // Ring of written batches for in-process subscribers (null without --live)
+    const LiveRing* liveRing() const { return live_.get(); }
     
 private:
     // Helper method to join all threads
     void joinAllThreads();
 
+    // Stop and join the producer threads and supervised children
+    void joinProducers();
+
+    // Open the sink for config_; a plain log file continues on log_fd if
+    // one is given (closed otherwise)
+    void openOutput(int log_fd);
+
+    // Create the live ring and the writer for sink_
+    void openWriter();
+
+    // Create a queue and a thread for every producer
+    void startProducers();
+
+    // exec() binary, handing over the log, the control socket and the
+    // queued records. Returns only if exec() failed: the output is then
+    // open again with the queued records written, and the error is returned.
+    std::string upgrade(const std::string& binary);
+
+    // Hand the outcome of an upgrade to the waiting "upgrade" command;
+    // closed refuses further upgrades
+    void finishUpgrade(const std::string& error, bool closed);
+
+    // Register the control socket commands
+    void registerCommands();
+
+    // Render writer stats as "key=value" lines
+    std::string formatStats() const;
+
     // Member variables
+    LoggerConfig config_;
     int thread_count_;
-    std::vector<std::thread> threads_;
     std::vector<std::unique_ptr<LoggerThread>> loggers_;
-};
\ No newline at end of file
+    std::unique_ptr<ThreadGroup> producers_;   // Runs loggers_[i] as thread i
+    std::vector<uint32_t> thread_weights_;
+
+    // Supervised children (--exec), logged like producers
+    std::vector<std::string> exec_commands_;
+    mutable std::mutex children_mutex_;   // Guards children_ against stats
+    std::vector<std::unique_ptr<ChildCapture>> children_;
+
+    // Interned channels the producers tag their records with (0 = main log)
+    uint16_t threads_channel_ = 0;
+    uint16_t stdout_channel_ = 0;
+    uint16_t stderr_channel_ = 0;
+
+    // Output path: producers -> queues (pool) -> writer -> sink
+    std::unique_ptr<LogSink> sink_;
+    MirrorSink* mirror_ = nullptr;   // sink_ when mirroring
+    FileSink* file_ = nullptr;       // Plain log file, possibly wrapped by sink_
+    std::unique_ptr<SegmentPool> pool_;
+    std::unique_ptr<IoGovernor> governor_;
+    std::unique_ptr<LiveRing> live_;     // Written batches for live subscribers
+    std::unique_ptr<LogWriter> writer_;
+    std::unique_ptr<ControlServer> control_;
+
+    // Binary upgrade: where this binary lives and how it was started
+    std::string exe_path_;
+    std::vector<std::string> command_line_;
+    std::mutex upgrade_mutex_;
+    std::condition_variable upgrade_done_;
+    std::string upgrade_path_;       // Set by the "upgrade" command, cleared once it failed
+    std::string upgrade_error_;      // Why the last upgrade failed
+    bool upgrade_closed_ = false;    // Shutting down; no more upgrades
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RecordFrame.hpp"
+
+// What a producer does when its queue is full
+enum class OverflowPolicy {
+    Drop,   // Drop the record and count it
+    Block   // Wait up to block_timeout_ms for space, then drop
+};
+
+// How a plain log file is written
+enum class FileIo {
+    Write,      // write(2) on an O_APPEND descriptor
+    Vmsplice    // vmsplice() the batch into a pipe, splice() it into the file
+};
+
+// A channel the writer routes to a file of its own
+struct ChannelConfig {
+    std::string name;
+    std::string path;
+    int flush_ms = 0;            // Hold records up to this long for fewer, larger writes
+    uint64_t rotate_bytes = 0;   // Rotate the file once it would grow past this (0 = never)
+    int keep = 5;                // Rotated files kept as path.1 .. path.keep
+    bool sync = false;           // fdatasync() after every write
+};
+
+// Settings for a LoggerApp run, filled in from the command line
+struct LoggerConfig {
+    std::string logfile_path;
+    int thread_count = 1;
+    int sleep_ms = 1000;
+
+    // Producer threads get stacks of thread_stack_bytes (0 = the system
+    // default, usually 8 MiB) and are created by spawn_threads threads at
+    // once (0 = a few for large counts, one otherwise)
+    size_t thread_stack_bytes = 256u << 10;
+    size_t spawn_threads = 0;
+
+    // On-disk record layout
+    FramingMode framing = FramingMode::None;
+
+    // Stripe the log across these directories (empty = single file)
+    std::vector<std::string> stripe_dirs;
+    size_t stripe_block_bytes = 1u << 20;
+
+    // Extra copies of the log (empty = no mirroring). The log is durable
+    // once mirror_quorum files, counting logfile_path, have synced it
+    // (0 = all); a copy lagging by mirror_max_lag_bytes is resynced.
+    std::vector<std::string> mirror_paths;
+    size_t mirror_quorum = 0;
+    size_t mirror_max_lag_bytes = 16u << 20;
+
+    // System calls that write a plain log file
+    FileIo file_io = FileIo::Write;
+
+    // Send the log to a local collector (logcollect) listening on this
+    // socket, filed under collector_app (empty = the log file's name);
+    // logfile_path is written only while the collector is unreachable
+    std::string collector_path;
+    std::string collector_app;
+
+    // Write the log as a preallocated ring of this many bytes that
+    // overwrites its oldest records (0 = grow without bound)
+    size_t ring_bytes = 0;
+
+    // Retention for a plain log file: free its oldest part in place once it
+    // holds more than retain_bytes or older than retain_sec (0 = keep)
+    uint64_t retain_bytes = 0;
+    uint64_t retain_sec = 0;
+    bool retain_collapse = false;
+
+    // Cap on dirty page-cache bytes of a plain log file; writeback starts
+    // early and written-back pages are dropped (0 = leave it to the kernel)
+    size_t dirty_max_bytes = 0;
+
+    // Fail over to a spill file in spill_dir when the plain log file hits
+    // an error or a write takes longer than spill_latency_ms (0 = errors
+    // only); spilled data is copied back once the primary recovers
+    std::string spill_dir;
+    int spill_latency_ms = 1000;
+
+    // Elastic queues: segments come from a shared pool and are handed back
+    // to the OS after idle_release_ms without traffic
+    size_t segment_bytes = 64u << 10;
+    size_t queue_max_bytes = 4u << 20;      // Per producer queue
+    size_t memory_max_bytes = 0;            // All queues together (0 = see poolBytes())
+    int idle_release_ms = 5000;
+
+    // Pool cap for queue_count producer queues: memory_max_bytes if set,
+    // else 64 MiB or two segments per queue, whichever is more, so every
+    // producer can keep writing however many there are
+    size_t poolBytes(size_t queue_count) const {
+        if (memory_max_bytes > 0) {
+            return memory_max_bytes;
+        }
+        size_t per_queue = 2 * segment_bytes;
+        return queue_count > (size_t{64} << 20) / per_queue ? queue_count * per_queue : size_t{64} << 20;
+    }
+
+    // The writer drains producers by deficit round robin, each taking its
+    // weight times drain_quantum_bytes per round (0 = each queue in turn
+    // until empty); producer thread i has thread_weights[i], default 1
+    size_t drain_quantum_bytes = 16u << 10;
+    std::vector<uint32_t> thread_weights;
+
+    // Lazy engine: producers write their first lazy_records records to the
+    // log themselves, and the writer thread and queue memory only appear
+    // with the record after those (0 = start everything up front)
+    size_t lazy_records = 0;
+
+    OverflowPolicy overflow = OverflowPolicy::Drop;
+    int block_timeout_ms = 100;
+
+    // Disk bandwidth governor (0 = unlimited). With io_from_cgroup the
+    // defaults come from io.max of this process's cgroup, scaled by
+    // io_cgroup_percent; explicit limits still win.
+    uint64_t io_bytes_per_sec = 0;
+    uint64_t io_iops = 0;
+    bool io_from_cgroup = false;
+    int io_cgroup_percent = 100;
+
+    // Shell commands run as children; their stdout and stderr are logged
+    // line by line (thread_count may then be 0)
+    std::vector<std::string> exec_commands;
+
+    // Channels routed to their own files, interned in this order as ids
+    // 1..N (0 is the main log), and the channel each kind of producer tags
+    // its records with (empty = the main log)
+    std::vector<ChannelConfig> channels;
+    std::string threads_channel;
+    std::string stdout_channel;
+    std::string stderr_channel;
+
+    // Publish every written batch to the shared-memory ring "/<live_name>"
+    // of live_bytes for live subscribers (empty = no ring)
+    std::string live_name;
+    size_t live_bytes = 16u << 20;
+
+    // Control socket for stats and runtime settings (empty = disabled)
+    std::string control_path;
+
+    // Arguments of this process, passed again to an upgraded binary
+    std::vector<std::string> command_line;
+};
@@ -0,0 +1,360 @@
+#include "MirrorSink.hpp"
+#include <algorithm>
+#include <functional>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+    // Chunks gathered into one pwritev()
+    constexpr size_t kMaxIov = 64;
+
+    // Pause before retrying a failed catch-up
+    constexpr std::chrono::seconds kRetryDelay{1};
+
+    // Write the iovecs at offset, retrying short writes; returns bytes written
+    bool pwriteAll(int fd, std::vector<iovec>& iov, uint64_t offset, uint64_t& total) {
+        total = 0;
+        size_t first = 0;
+        while (first < iov.size()) {
+            ssize_t written = ::pwritev(fd, iov.data() + first, static_cast<int>(iov.size() - first),
+                                        static_cast<off_t>(offset + total));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            total += static_cast<uint64_t>(written);
+            size_t left = static_cast<size_t>(written);
+            while (first < iov.size() && left >= iov[first].iov_len) {
+                left -= iov[first].iov_len;
+                ++first;
+            }
+            if (left > 0) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+        return true;
+    }
+
+    // Copy [from, to) between files at the same offsets. Uses copy_file_range
+    // so the kernel (or the filesystem) moves the data, with a read/write
+    // fallback across filesystems that refuse it.
+    bool copyRange(int source, int target, uint64_t from, uint64_t to) {
+        loff_t in = static_cast<loff_t>(from);
+        loff_t out = static_cast<loff_t>(from);
+        while (static_cast<uint64_t>(in) < to) {
+            ssize_t copied = ::copy_file_range(source, &in, target, &out, to - static_cast<uint64_t>(in), 0);
+            if (copied > 0) {
+                continue;
+            }
+            if (copied == 0) {
+                return false;   // Source is shorter than it claimed
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+                return false;
+            }
+
+            std::vector<char> buffer(1u << 20);
+            while (static_cast<uint64_t>(in) < to) {
+                size_t want = std::min<uint64_t>(buffer.size(), to - static_cast<uint64_t>(in));
+                ssize_t got = ::pread(source, buffer.data(), want, in);
+                if (got <= 0) {
+                    if (got < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                for (ssize_t done = 0; done < got;) {
+                    ssize_t written = ::pwrite(target, buffer.data() + done, static_cast<size_t>(got - done),
+                                               in + done);
+                    if (written < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        return false;
+                    }
+                    done += written;
+                }
+                in += got;
+            }
+            return true;
+        }
+        return true;
+    }
+}
+
+MirrorSink::MirrorSink(const std::vector<std::string>& paths, size_t quorum, size_t max_lag_bytes)
+    : quorum_(quorum == 0 ? paths.size() : quorum), max_lag_bytes_(max_lag_bytes) {
+    if (paths.size() < 2) {
+        throw std::invalid_argument("mirroring needs at least two files");
+    }
+    if (quorum_ > paths.size()) {
+        throw std::invalid_argument("mirror quorum exceeds the number of replicas");
+    }
+
+    for (const auto& path : paths) {
+        auto replica = std::make_unique<Replica>();
+        replica->path = path;
+        replica->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (replica->fd < 0) {
+            throw std::runtime_error("Error opening mirror file: " + path);
+        }
+        struct stat st{};
+        if (::fstat(replica->fd, &st) != 0) {
+            throw std::runtime_error("Error reading mirror file: " + path);
+        }
+        replica->written = static_cast<uint64_t>(st.st_size);
+        replicas_.push_back(std::move(replica));
+    }
+
+    // A replica that missed the end of the last run is filled in from the
+    // longest one before anything new is appended
+    auto longest = std::max_element(replicas_.begin(), replicas_.end(),
+        [](const auto& a, const auto& b) { return a->written < b->written; });
+    size_ = (*longest)->written;
+    for (auto& replica : replicas_) {
+        if (replica->written < size_) {
+            if (!copyRange((*longest)->fd, replica->fd, replica->written, size_) || ::fdatasync(replica->fd) != 0) {
+                throw std::runtime_error("Error resyncing mirror file: " + replica->path);
+            }
+            std::cerr << "Resynced mirror " << replica->path << " from " << (*longest)->path << " ("
+                      << size_ - replica->written << " bytes)\n";
+        }
+        replica->written = size_;
+        replica->synced = size_;
+    }
+    backlog_start_ = size_;
+
+    for (auto& replica : replicas_) {
+        replica->thread = std::thread(&MirrorSink::runReplica, this, std::ref(*replica));
+    }
+}
+
+MirrorSink::~MirrorSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (auto& replica : replicas_) {
+        if (replica->thread.joinable()) {
+            replica->thread.join();
+        }
+    }
+}
+
+bool MirrorSink::write(const char* data, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (std::none_of(replicas_.begin(), replicas_.end(), [](const auto& r) { return r->active; }) &&
+            size_ - backlog_start_ + size > max_lag_bytes_) {
+        return false;   // Every replica is down and the backlog is full
+    }
+
+    backlog_.push_back({size_, std::make_shared<const std::string>(data, size)});
+    size_ += size;
+    ready_.notify_all();
+
+    // Keep the backlog bounded: detach replicas that trail the leader by too
+    // much, and wait only if the leader itself is that far behind
+    for (;;) {
+        uint64_t leader = 0;
+        bool any_active = false;
+        for (const auto& replica : replicas_) {
+            if (replica->active) {
+                leader = std::max(leader, replica->written);
+                any_active = true;
+            }
+        }
+        if (!any_active || size_ - leader <= max_lag_bytes_) {
+            break;
+        }
+        progress_.wait(lock);
+    }
+
+    bool detached = false;
+    for (auto& replica : replicas_) {
+        if (replica->active && size_ - replica->written > max_lag_bytes_) {
+            replica->active = false;
+            ++replica->catchups;
+            detached = true;
+            std::cerr << "Mirror " << replica->path << " lags by " << size_ - replica->written
+                      << " bytes; detached to catch up\n";
+        }
+    }
+    if (detached) {
+        trimLocked();
+        ready_.notify_all();
+    }
+    return true;
+}
+
+void MirrorSink::runReplica(Replica& replica) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        ready_.wait(lock, [&] { return stopping_ || !replica.active || replica.written < size_; });
+
+        if (!replica.active) {
+            if (!catchUp(replica, lock)) {
+                if (stopping_) {
+                    return;
+                }
+                ready_.wait_for(lock, kRetryDelay, [&] { return stopping_; });
+            }
+            continue;
+        }
+        if (replica.written >= size_) {
+            return;   // Stopping with everything written and synced
+        }
+
+        // Gather the backlog this replica has not written yet; the shared
+        // pointers keep chunks alive even if this replica gets detached
+        uint64_t start = replica.written;
+        std::vector<std::shared_ptr<const std::string>> pieces;
+        std::vector<iovec> iov;
+        for (const Chunk& chunk : backlog_) {
+            uint64_t end = chunk.offset + chunk.data->size();
+            if (end <= start) {
+                continue;
+            }
+            size_t skip = start > chunk.offset ? static_cast<size_t>(start - chunk.offset) : 0;
+            iov.push_back({const_cast<char*>(chunk.data->data()) + skip, chunk.data->size() - skip});
+            pieces.push_back(chunk.data);
+            if (iov.size() == kMaxIov) {
+                break;
+            }
+        }
+        lock.unlock();
+
+        uint64_t written = 0;
+        bool ok = pwriteAll(replica.fd, iov, start, written);
+        ok = ::fdatasync(replica.fd) == 0 && ok;
+
+        lock.lock();
+        replica.written = std::max(replica.written, start + written);
+        if (ok) {
+            replica.synced = std::max(replica.synced, start + written);
+        } else {
+            ++replica.errors;
+            if (replica.active) {
+                replica.active = false;
+                ++replica.catchups;
+                std::cerr << "Error writing mirror " << replica.path << "; detached to catch up\n";
+            }
+        }
+        trimLocked();
+        progress_.notify_all();
+
+        // Give a failing volume a moment before trying it again
+        if (!ok) {
+            ready_.wait_for(lock, kRetryDelay, [&] { return stopping_; });
+        }
+    }
+}
+
+bool MirrorSink::catchUp(Replica& replica, std::unique_lock<std::mutex>& lock) {
+    // The most advanced other replica, active or not: when every replica
+    // failed at once there is no active one, but their files still hold
+    // everything up to their written offsets
+    Replica* source = nullptr;
+    for (auto& other : replicas_) {
+        if (other.get() != &replica && (!source || other->written > source->written)) {
+            source = other.get();
+        }
+    }
+
+    // Copy from the source's file without touching the backlog
+    uint64_t from = replica.written;
+    uint64_t to = source->written;
+    if (from < to && from < backlog_start_) {
+        int source_fd = source->fd;
+        lock.unlock();
+        bool ok = copyRange(source_fd, replica.fd, from, to) && ::fdatasync(replica.fd) == 0;
+        lock.lock();
+        if (!ok) {
+            ++replica.errors;
+            return false;
+        }
+        replica.written = std::max(replica.written, to);
+        replica.synced = std::max(replica.synced, to);
+        progress_.notify_all();
+    }
+
+    // Rejoin once the backlog covers the rest; with nobody active the
+    // backlog was kept whole, so the furthest replica rejoins from it
+    if (replica.written >= backlog_start_) {
+        replica.active = true;
+        std::cerr << "Mirror " << replica.path << " caught up\n";
+    }
+    return replica.active || replica.written > from;
+}
+
+uint64_t MirrorSink::durableLocked() const {
+    std::vector<uint64_t> synced;
+    for (const auto& replica : replicas_) {
+        synced.push_back(replica->synced);
+    }
+    std::sort(synced.begin(), synced.end(), std::greater<uint64_t>());
+    return synced[quorum_ - 1];
+}
+
+void MirrorSink::trimLocked() {
+    uint64_t keep_from = UINT64_MAX;
+    for (const auto& replica : replicas_) {
+        if (replica->active) {
+            keep_from = std::min(keep_from, replica->written);
+        }
+    }
+    if (keep_from == UINT64_MAX) {
+        return;   // Nobody active; keep the data for whoever comes back
+    }
+    while (!backlog_.empty() && backlog_.front().offset + backlog_.front().data->size() <= keep_from) {
+        backlog_.pop_front();
+    }
+    backlog_start_ = backlog_.empty() ? size_ : backlog_.front().offset;
+}
+
+bool MirrorSink::waitDurable(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = size_;
+    return progress_.wait_for(lock, timeout, [&] { return durableLocked() >= target; });
+}
+
+MirrorStats MirrorSink::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MirrorStats stats;
+    stats.size = size_;
+    stats.durable = durableLocked();
+    stats.backlog_bytes = size_ - backlog_start_;
+    for (const auto& replica : replicas_) {
+        stats.replicas.push_back({replica->path, replica->written, replica->synced, replica->active,
+                                  replica->catchups, replica->errors});
+    }
+    return stats;
+}
+
+void MirrorSink::appendStats(std::ostream& out) const {
+    MirrorStats current = stats();
+    out << "mirror.size=" << current.size << "\n"
+        << "mirror.durable=" << current.durable << "\n"
+        << "mirror.backlog_bytes=" << current.backlog_bytes << "\n";
+    for (size_t i = 0; i < current.replicas.size(); ++i) {
+        const ReplicaStats& replica = current.replicas[i];
+        std::string prefix = "mirror.replica" + std::to_string(i) + ".";
+        out << prefix << "written=" << replica.written << "\n"
+            << prefix << "synced=" << replica.synced << "\n"
+            << prefix << "active=" << (replica.active ? 1 : 0) << "\n"
+            << prefix << "catchups=" << replica.catchups << "\n"
+            << prefix << "errors=" << replica.errors << "\n";
+    }
+}
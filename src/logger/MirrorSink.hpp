@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "LogSink.hpp"
+
+// Per-replica counters for the control socket
+struct ReplicaStats {
+    std::string path;
+    uint64_t written = 0;     // Bytes in the file
+    uint64_t synced = 0;      // Bytes known to be on disk
+    bool active = true;       // False while catching up
+    uint64_t catchups = 0;    // Times it fell behind and was resynced
+    uint64_t errors = 0;
+};
+
+struct MirrorStats {
+    uint64_t size = 0;            // Logical bytes accepted
+    uint64_t durable = 0;         // Bytes synced on a quorum of replicas
+    uint64_t backlog_bytes = 0;   // Held in memory for the slowest active replica
+    std::vector<ReplicaStats> replicas;
+};
+
+// Sink that keeps identical copies of the log in several files.
+//
+// write() appends the batch to a shared in-memory backlog; every replica has
+// its own thread that writes the backlog to its file and fdatasyncs after
+// each pass, so a slow volume never delays the others. The log is durable up
+// to the offset a quorum of replicas has synced.
+//
+// A replica that falls more than max_lag_bytes behind the fastest one is
+// detached so the backlog stays bounded. Its thread then copies the missing
+// range from a healthy replica's file (copy_file_range) and rejoins once it
+// is back inside the backlog. Only when every replica lags does write() wait.
+// If every replica fails at once, write() keeps up to max_lag_bytes in the
+// backlog; the furthest replica rejoins from it and the rest copy from that.
+class MirrorSink : public LogSink {
+public:
+    // Constructor opens all replicas (the first one is the primary path) and
+    // brings shorter ones up to the longest before any new data is accepted
+    MirrorSink(const std::vector<std::string>& paths, size_t quorum, size_t max_lag_bytes);
+
+    // Destructor writes and syncs what is queued, then stops the threads
+    ~MirrorSink() override;
+
+    // Non-copyable
+    MirrorSink(const MirrorSink&) = delete;
+    MirrorSink& operator=(const MirrorSink&) = delete;
+
+    // Queue data for all replicas; returns false while none is usable and
+    // the backlog is full
+    bool write(const char* data, size_t size) override;
+
+    const std::string& path() const override { return replicas_.front()->path; }
+
+    void appendStats(std::ostream& out) const override;
+
+    // Wait until a quorum has synced everything written so far
+    bool waitDurable(std::chrono::milliseconds timeout);
+
+    MirrorStats stats() const;
+
+private:
+    struct Chunk {
+        uint64_t offset;
+        std::shared_ptr<const std::string> data;
+    };
+
+    struct Replica {
+        std::string path;
+        int fd = -1;
+        std::thread thread;
+        uint64_t written = 0;
+        uint64_t synced = 0;
+        bool active = true;
+        uint64_t catchups = 0;
+        uint64_t errors = 0;
+
+        ~Replica() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+
+    // Replica thread main loop
+    void runReplica(Replica& replica);
+
+    // Copy what a detached replica misses from the most advanced other one
+    // and rejoin once the backlog covers the rest; false if nothing moved
+    bool catchUp(Replica& replica, std::unique_lock<std::mutex>& lock);
+
+    // Helpers; the caller holds mutex_
+    uint64_t durableLocked() const;
+    void trimLocked();
+
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    size_t quorum_;
+    size_t max_lag_bytes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;      // New data, or stopping
+    std::condition_variable progress_;   // A replica wrote or synced
+    std::deque<Chunk> backlog_;          // Covers [backlog_start_, size_)
+    uint64_t backlog_start_ = 0;
+    uint64_t size_ = 0;
+    bool stopping_ = false;
+};
@@ -0,0 +1,61 @@
+#include "RecordFrame.hpp"
+#include "Crc32c.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr size_t kHeaderCrcOffset = offsetof(RecordFrame::Header, header_crc);
+}
+
+void RecordFrame::append(std::string& out, uint64_t sequence, std::string_view payload) {
+    Header header{};
+    header.magic = kMagic;
+    header.length = static_cast<uint32_t>(payload.size());
+    header.sequence = sequence;
+    header.payload_crc = Crc32c::compute(payload.data(), payload.size());
+    header.header_crc = Crc32c::compute(&header, kHeaderCrcOffset);
+
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(payload);
+}
+
+size_t RecordFrame::validate(const char* data, size_t available, Header* header) {
+    if (available < kHeaderSize) {
+        return 0;
+    }
+
+    Header candidate;
+    std::memcpy(&candidate, data, sizeof(candidate));
+    if (candidate.magic != kMagic || candidate.length > kMaxPayload) {
+        return 0;
+    }
+    if (Crc32c::compute(&candidate, kHeaderCrcOffset) != candidate.header_crc) {
+        return 0;
+    }
+
+    size_t total = kHeaderSize + candidate.length;
+    if (total > available) {
+        return 0;  // Torn write: header made it to disk, payload did not
+    }
+    if (Crc32c::compute(data + kHeaderSize, candidate.length) != candidate.payload_crc) {
+        return 0;
+    }
+
+    if (header) {
+        *header = candidate;
+    }
+    return total;
+}
+
+FramingMode RecordFrame::parseMode(const std::string& name) {
+    if (name == "none") {
+        return FramingMode::None;
+    }
+    if (name == "record") {
+        return FramingMode::Record;
+    }
+    if (name == "block") {
+        return FramingMode::Block;
+    }
+    throw std::invalid_argument("unknown framing mode: " + name);
+}
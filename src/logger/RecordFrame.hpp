@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// How records are laid out in the log file
+enum class FramingMode {
+    None,    // Plain text lines (default, backwards compatible)
+    Record,  // One checksummed frame per record
+    Block    // One checksummed frame per writer batch
+};
+
+// Framed record format for crash-safe logs.
+//
+// Each frame is a fixed 24-byte little-endian header followed by the payload:
+//   magic(4) length(4) sequence(8) payload_crc(4) header_crc(4)
+// header_crc covers the first 20 header bytes, so a reader can validate a
+// candidate frame boundary before trusting its length field.
+namespace RecordFrame {
+    constexpr uint32_t kMagic = 0x52464C54;          // "TLFR" on disk
+    constexpr size_t kHeaderSize = 24;
+    constexpr uint32_t kMaxPayload = 16u << 20;      // Larger lengths are corrupt
+
+    struct Header {
+        uint32_t magic;
+        uint32_t length;
+        uint64_t sequence;
+        uint32_t payload_crc;
+        uint32_t header_crc;
+    };
+    static_assert(sizeof(Header) == kHeaderSize, "frame header must be packed");
+
+    // Append a complete frame (header + payload) to out
+    void append(std::string& out, uint64_t sequence, std::string_view payload);
+
+    // Validate a frame starting at data.
+    // Returns the total frame size, or 0 if no valid frame starts here.
+    size_t validate(const char* data, size_t available, Header* header = nullptr);
+
+    // Parse a framing mode name ("none", "record", "block"); throws on unknown names
+    FramingMode parseMode(const std::string& name);
+}
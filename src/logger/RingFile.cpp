@@ -0,0 +1,51 @@
+#include "RingFile.hpp"
+#include "Crc32c.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t kCrcOffset = offsetof(RingFile::Header, crc);
+
+    bool valid(const RingFile::Header& header) {
+        return header.magic == RingFile::kMagic && header.version == RingFile::kVersion &&
+               header.capacity > 0 && header.head <= header.tail &&
+               header.tail - header.head <= header.capacity &&
+               Crc32c::compute(&header, kCrcOffset) == header.crc;
+    }
+}
+
+std::optional<RingFile::Header> RingFile::readHeader(int fd) {
+    std::optional<Header> newest;
+    for (size_t slot = 0; slot < 2; ++slot) {
+        Header header;
+        if (::pread(fd, &header, sizeof(header), static_cast<off_t>(slot * kSlotBytes)) !=
+                static_cast<ssize_t>(sizeof(header)) || !valid(header)) {
+            continue;
+        }
+        if (!newest || header.generation > newest->generation) {
+            newest = header;
+        }
+    }
+    return newest;
+}
+
+bool RingFile::writeHeader(int fd, Header& header) {
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.reserved = 0;
+    ++header.generation;
+    header.crc = Crc32c::compute(&header, kCrcOffset);
+
+    off_t slot = static_cast<off_t>((header.generation % 2) * kSlotBytes);
+    for (;;) {
+        ssize_t written = ::pwrite(fd, &header, sizeof(header), slot);
+        if (written == static_cast<ssize_t>(sizeof(header))) {
+            return true;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Layout of a fixed-size circular log file.
+//
+// The first kHeaderBytes hold two header slots; updates alternate between
+// them, so a torn header write always leaves the previous one intact. The
+// rest of the file is the ring: logical offset x lives at
+// kHeaderBytes + x % capacity. head and tail are logical offsets that only
+// grow; the readable log is [head, tail), and records are framed so a
+// reader can skip the partly overwritten record at head.
+namespace RingFile {
+    constexpr uint32_t kMagic = 0x474E4952;          // "RING" on disk
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kHeaderBytes = 4096;
+    constexpr size_t kSlotBytes = kHeaderBytes / 2;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;      // Ring bytes after the header page
+        uint64_t head;          // Oldest byte still in the ring
+        uint64_t tail;          // Next byte to write
+        uint64_t generation;    // Bumped on every update; picks the newest slot
+        uint32_t reserved;
+        uint32_t crc;           // CRC32C of the preceding bytes
+    };
+
+    // Newest valid header of the file, or nullopt if it is not a ring
+    std::optional<Header> readHeader(int fd);
+
+    // Bump the generation and store the header in the next slot
+    bool writeHeader(int fd, Header& header);
+
+    // File position of a logical offset
+    inline uint64_t filePosition(const Header& header, uint64_t offset) {
+        return kHeaderBytes + offset % header.capacity;
+    }
+}
@@ -0,0 +1,110 @@
+#include "RingFileSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+RingFileSink::RingFileSink(const std::string& path, size_t capacity) : path_(path) {
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    capacity = (std::max(capacity, page) + page - 1) / page * page;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Error opening ring log file: " + path);
+    }
+
+    if (auto existing = RingFile::readHeader(fd_)) {
+        if (existing->capacity != capacity) {
+            ::close(fd_);
+            throw std::runtime_error("Ring size differs from existing ring log: " + path);
+        }
+        header_ = *existing;
+        head_ = header_.head;
+        tail_ = header_.tail;
+        return;
+    }
+
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0 || st.st_size != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Not a ring log file (refusing to overwrite): " + path);
+    }
+
+    // Reserve all blocks up front so the ring can never hit ENOSPC later
+    off_t length = static_cast<off_t>(RingFile::kHeaderBytes + capacity);
+    if (::fallocate(fd_, 0, 0, length) != 0 && (errno != EOPNOTSUPP || ::ftruncate(fd_, length) != 0)) {
+        ::close(fd_);
+        throw std::runtime_error("Error preallocating ring log file: " + path);
+    }
+    header_.capacity = capacity;
+    if (!RingFile::writeHeader(fd_, header_) || !RingFile::writeHeader(fd_, header_)) {
+        ::close(fd_);
+        throw std::runtime_error("Error writing ring log header: " + path);
+    }
+}
+
+RingFileSink::~RingFileSink() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool RingFileSink::write(const char* data, size_t size) {
+    // A batch larger than the ring only keeps its newest part
+    uint64_t offset = header_.tail;
+    if (size > header_.capacity) {
+        offset += size - header_.capacity;
+        data += size - header_.capacity;
+        size = header_.capacity;
+    }
+    uint64_t tail = offset + size;
+    uint64_t head = std::max(header_.head, tail - std::min(tail, header_.capacity));
+
+    // Bytes about to be overwritten leave the readable range on disk first,
+    // so a crash mid-write never shows new data where the oldest should be
+    if (head > header_.head) {
+        header_.head = head;
+        header_.tail = std::max(header_.tail, head);
+        head_ = header_.head;
+        if (!RingFile::writeHeader(fd_, header_)) {
+            return false;
+        }
+    }
+
+    size_t first = std::min<uint64_t>(size, header_.capacity - offset % header_.capacity);
+    if (!writeAt(offset, data, first) || !writeAt(offset + first, data + first, size - first)) {
+        return false;
+    }
+
+    header_.tail = tail;
+    tail_ = header_.tail;
+    return RingFile::writeHeader(fd_, header_);
+}
+
+bool RingFileSink::writeAt(uint64_t offset, const char* data, size_t size) {
+    off_t position = static_cast<off_t>(RingFile::filePosition(header_, offset));
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd_, data, size, position);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        position += written;
+    }
+    return true;
+}
+
+void RingFileSink::appendStats(std::ostream& out) const {
+    uint64_t head = head_;
+    uint64_t tail = tail_;
+    out << "ring.capacity=" << header_.capacity << "\n"
+        << "ring.used=" << tail - head << "\n"
+        << "ring.overwritten=" << head << "\n";
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "LogSink.hpp"
+#include "RingFile.hpp"
+
+// Sink that writes a preallocated RingFile, overwriting the oldest data.
+//
+// Disk usage is fixed at creation and nothing is ever rotated: each write
+// lands at the tail, wrapping around the end of the ring. A write that
+// overwrites old data first stores a header whose head is past that data,
+// and the header is updated again after the data, so a crash loses at
+// most the last batch and never leaves head pointing at newer bytes.
+class RingFileSink : public LogSink {
+public:
+    // Constructor creates a ring of capacity bytes (rounded up to whole
+    // pages), or continues an existing ring of the same size; throws if the
+    // path holds something else
+    RingFileSink(const std::string& path, size_t capacity);
+
+    // Destructor closes the file
+    ~RingFileSink() override;
+
+    // Non-copyable
+    RingFileSink(const RingFileSink&) = delete;
+    RingFileSink& operator=(const RingFileSink&) = delete;
+
+    // Write at the tail, overwriting the oldest bytes; returns false on error
+    bool write(const char* data, size_t size) override;
+
+    const std::string& path() const override { return path_; }
+
+    void appendStats(std::ostream& out) const override;
+
+private:
+    // Write a piece that does not cross the end of the ring
+    bool writeAt(uint64_t offset, const char* data, size_t size);
+
+    std::string path_;
+    int fd_;
+    RingFile::Header header_{};
+
+    // Copies of head and tail for stats readers on other threads
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+};
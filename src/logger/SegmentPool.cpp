@@ -0,0 +1,87 @@
+#include "SegmentPool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SegmentPool::SegmentPool(size_t segment_size, size_t max_bytes) {
+    // Round the segment up to whole pages so madvise can release it exactly
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    segment_size_ = (std::max(segment_size, page) + page - 1) / page * page;
+    if (segment_size_ > UINT32_MAX) {
+        throw std::invalid_argument("segment size is too large");
+    }
+    max_segments_ = max_bytes / segment_size_;
+    if (max_segments_ == 0) {
+        throw std::invalid_argument("memory cap is smaller than one queue segment");
+    }
+}
+
+SegmentPool::~SegmentPool() {
+    for (void* mapping : mappings_) {
+        ::munmap(mapping, segment_size_);
+    }
+}
+
+Segment* SegmentPool::acquire() {
+    void* memory = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (in_use_.load(std::memory_order_relaxed) >= max_segments_) {
+            return nullptr;
+        }
+
+        // Prefer segments that are still resident, then released ones
+        if (!warm_.empty()) {
+            memory = warm_.back();
+            warm_.pop_back();
+        } else if (!cold_.empty()) {
+            memory = cold_.back();
+            cold_.pop_back();
+        } else {
+            memory = ::mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                return nullptr;
+            }
+            mappings_.push_back(memory);
+        }
+
+        size_t in_use = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (in_use > peak_in_use_.load(std::memory_order_relaxed)) {
+            peak_in_use_.store(in_use, std::memory_order_relaxed);
+        }
+    }
+
+    // Released pages read back as zero, so always rebuild the header
+    auto* segment = new (memory) Segment();
+    segment->capacity = static_cast<uint32_t>(payloadCapacity());
+    return segment;
+}
+
+void SegmentPool::release(Segment* segment) {
+    segment->~Segment();
+    std::lock_guard<std::mutex> lock(mutex_);
+    warm_.push_back(segment);
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t SegmentPool::trimIdle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t released = 0;
+    for (Segment* segment : warm_) {
+        if (::madvise(segment, segment_size_, MADV_DONTNEED) == 0) {
+            released += segment_size_;
+        }
+        cold_.push_back(segment);
+    }
+    warm_.clear();
+    return released;
+}
+
+size_t SegmentPool::bytesResident() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (in_use_.load(std::memory_order_relaxed) + warm_.size()) * segment_size_;
+}
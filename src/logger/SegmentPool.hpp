@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Fixed-size, page-aligned chunk of queue memory.
+// The header lives at the start of the mapping and the payload follows it.
+struct Segment {
+    std::atomic<Segment*> next{nullptr};    // Set by the producer once this segment is full
+    std::atomic<uint32_t> committed{0};     // Payload bytes published by the producer
+    uint32_t capacity = 0;                  // Payload bytes available
+
+    char* data() { return reinterpret_cast<char*>(this) + kHeaderSize; }
+
+    static constexpr size_t kHeaderSize = 64;
+};
+
+// Shared pool of queue segments with a global memory cap.
+// Segments freed by queues stay warm in the pool until trimIdle() hands
+// their pages back to the OS with madvise(MADV_DONTNEED).
+class SegmentPool {
+public:
+    // Constructor takes the segment size and the cap on segments in use (bytes)
+    SegmentPool(size_t segment_size, size_t max_bytes);
+
+    // Destructor unmaps every segment; all queues must be gone by now
+    ~SegmentPool();
+
+    // Non-copyable
+    SegmentPool(const SegmentPool&) = delete;
+    SegmentPool& operator=(const SegmentPool&) = delete;
+
+    // Get an empty segment, or nullptr if the global cap is reached
+    Segment* acquire();
+
+    // Return a segment to the pool
+    void release(Segment* segment);
+
+    // Release the pages of all free segments to the OS; returns bytes released
+    size_t trimIdle();
+
+    // Accessors
+    size_t segmentSize() const { return segment_size_; }
+    size_t payloadCapacity() const { return segment_size_ - Segment::kHeaderSize; }
+    size_t bytesInUse() const { return in_use_.load(std::memory_order_relaxed) * segment_size_; }
+    size_t peakBytesInUse() const { return peak_in_use_.load(std::memory_order_relaxed) * segment_size_; }
+    size_t bytesResident() const;
+
+private:
+    size_t segment_size_;
+    size_t max_segments_;
+
+    mutable std::mutex mutex_;
+    std::vector<Segment*> warm_;   // Free segments whose pages are resident
+    std::vector<Segment*> cold_;   // Free segments already released to the OS
+    std::vector<void*> mappings_;  // Every segment ever mapped
+
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> peak_in_use_{0};
+};
@@ -0,0 +1,101 @@
+#include "SegmentQueue.hpp"
+#include <algorithm>
+#include <thread>
+
+SegmentQueue::SegmentQueue(SegmentPool& pool, size_t max_bytes, QueueBypass* bypass)
+    : pool_(pool), max_segments_(std::max<size_t>(1, max_bytes / pool.segmentSize())), bypass_(bypass) {
+    // The first segment is taken by the first queued record
+    tail_ = head_ = nullptr;
+}
+
+SegmentQueue::~SegmentQueue() {
+    Segment* segment = head_ ? head_ : first_.load(std::memory_order_acquire);
+    while (segment) {
+        Segment* next = segment->next.load(std::memory_order_acquire);
+        pool_.release(segment);
+        segment = next;
+    }
+}
+
+bool SegmentQueue::push(const void* data, uint32_t length) {
+    if (tryPush(data, length)) {
+        return true;
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool SegmentQueue::pushWait(const void* data, uint32_t length, std::chrono::milliseconds timeout) {
+    if (kLengthSize + length > pool_.payloadCapacity()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;  // Never fits, no point waiting
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!tryPush(data, length)) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+bool SegmentQueue::tryPush(const void* data, uint32_t length) {
+    if (QueueBypass* bypass = bypass_.load(std::memory_order_acquire)) {
+        if (bypass->take(data, length)) {
+            // The bypass only takes records while nothing drains the queue,
+            // so the producer may count them as consumed too
+            pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            consumed_.store(consumed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    uint32_t needed = kLengthSize + length;
+    if (needed > pool_.payloadCapacity()) {
+        return false;
+    }
+
+    if (!tail_) {
+        // First record queued: only now take a segment
+        tail_ = pool_.acquire();
+        if (!tail_) {
+            return false;
+        }
+        segments_held_.fetch_add(1, std::memory_order_relaxed);
+        first_.store(tail_, std::memory_order_release);
+    }
+
+    if (write_pos_ + needed > tail_->capacity) {
+        // Grow: link a fresh segment if both caps allow it
+        Segment* segment = nullptr;
+        if (segments_held_.load(std::memory_order_relaxed) < max_segments_) {
+            segment = pool_.acquire();
+        }
+        if (!segment) {
+            return false;
+        }
+        segments_held_.fetch_add(1, std::memory_order_relaxed);
+        tail_->next.store(segment, std::memory_order_release);
+        tail_ = segment;
+        write_pos_ = 0;
+    }
+
+    char* out = tail_->data() + write_pos_;
+    std::memcpy(out, &length, kLengthSize);
+    std::memcpy(out + kLengthSize, data, length);
+    write_pos_ += needed;
+    tail_->committed.store(write_pos_, std::memory_order_release);
+    pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void SegmentQueue::retireHead(Segment* next) {
+    Segment* done = head_;
+    head_ = next;
+    read_pos_ = 0;
+    pool_.release(done);
+    segments_held_.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "SegmentPool.hpp"
+
+// Takes records in place of a queue, e.g. to write them straight to the log
+// while there is no writer thread yet
+class QueueBypass {
+public:
+    virtual ~QueueBypass() = default;
+
+    // Producer: consume one record, or return false to have it queued
+    virtual bool take(const void* data, uint32_t length) = 0;
+};
+
+// Single-producer/single-consumer record queue built from linked segments.
+//
+// The producer appends length-prefixed records to its tail segment and links
+// a fresh segment from the pool when it fills up, so the queue grows with
+// bursts up to its own cap and the pool's global cap. The consumer hands
+// segments back to the pool as soon as it has read past them.
+//
+// A queue takes its first segment when the first record is queued rather
+// than when it is created, so creating a queue never fails and idle threads
+// hold no queue memory. A queue with a bypass offers every record to it
+// first and only queues what the bypass refuses.
+class SegmentQueue {
+public:
+    // Constructor takes the shared pool, this queue's cap in bytes and an
+    // optional bypass
+    SegmentQueue(SegmentPool& pool, size_t max_bytes, QueueBypass* bypass = nullptr);
+
+    // Destructor returns every held segment to the pool
+    ~SegmentQueue();
+
+    // Non-copyable
+    SegmentQueue(const SegmentQueue&) = delete;
+    SegmentQueue& operator=(const SegmentQueue&) = delete;
+
+    // Producer: append one record; returns false (and counts a drop) when full
+    bool push(const void* data, uint32_t length);
+
+    // Producer: like push() but waits up to timeout for the consumer to free space
+    bool pushWait(const void* data, uint32_t length, std::chrono::milliseconds timeout);
+
+    // Consumer: pass available records to visit(const char*, uint32_t)
+    // until they run out or their payloads reach max_bytes (the record that
+    // crosses it is still passed). Returns the number of records consumed.
+    template <typename Visitor>
+    size_t drain(Visitor&& visit, size_t max_bytes = std::numeric_limits<size_t>::max());
+
+    // Statistics, safe to read from any thread
+    uint64_t pushed() const { return pushed_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t consumed() const { return consumed_.load(std::memory_order_relaxed); }
+    size_t segmentsHeld() const { return segments_held_.load(std::memory_order_relaxed); }
+
+    // Any thread: queue every record from now on
+    void clearBypass() { bypass_.store(nullptr, std::memory_order_release); }
+
+private:
+    static constexpr uint32_t kLengthSize = sizeof(uint32_t);
+
+    // Producer: append without counting a drop on failure
+    bool tryPush(const void* data, uint32_t length);
+
+    // Consumer: move past a fully read segment
+    void retireHead(Segment* next);
+
+    SegmentPool& pool_;
+    size_t max_segments_;
+    std::atomic<QueueBypass*> bypass_;
+    std::atomic<Segment*> first_{nullptr};   // Publishes a lazily taken first segment
+
+    // Producer side
+    alignas(64) Segment* tail_;
+    uint32_t write_pos_ = 0;
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    // Consumer side
+    alignas(64) Segment* head_;
+    uint32_t read_pos_ = 0;
+    std::atomic<uint64_t> consumed_{0};
+
+    std::atomic<size_t> segments_held_{0};
+};
+
+template <typename Visitor>
+size_t SegmentQueue::drain(Visitor&& visit, size_t max_bytes) {
+    size_t count = 0;
+    size_t published = 0;   // Part of count already added to consumed_
+    size_t bytes = 0;
+    if (!head_) {
+        head_ = first_.load(std::memory_order_acquire);
+        if (!head_) {
+            return 0;   // Nothing was ever queued
+        }
+    }
+    for (;;) {
+        uint32_t committed = head_->committed.load(std::memory_order_acquire);
+        while (read_pos_ < committed && bytes < max_bytes) {
+            uint32_t length;
+            std::memcpy(&length, head_->data() + read_pos_, kLengthSize);
+            visit(static_cast<const char*>(head_->data() + read_pos_ + kLengthSize), length);
+            read_pos_ += kLengthSize + length;
+            bytes += length;
+            ++count;
+        }
+        if (bytes >= max_bytes) {
+            break;
+        }
+
+        Segment* next = head_->next.load(std::memory_order_acquire);
+        if (!next) {
+            break;
+        }
+        // The producer may have committed more before linking the next segment
+        if (head_->committed.load(std::memory_order_acquire) != read_pos_) {
+            continue;
+        }
+        retireHead(next);
+        consumed_.store(consumed_.load(std::memory_order_relaxed) + count - published, std::memory_order_relaxed);
+        published = count;
+    }
+    consumed_.store(consumed_.load(std::memory_order_relaxed) + count - published, std::memory_order_relaxed);
+    return count;
+}
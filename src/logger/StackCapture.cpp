@@ -0,0 +1,64 @@
+#include "StackCapture.hpp"
+#include <pthread.h>
+
+// Bounds of the executable's image, from the default linker script
+extern "C" char __executable_start;
+extern "C" char etext;
+
+namespace {
+    // One past the highest address of the calling thread's stack, 0 if unknown.
+    // pthread_getattr_np() is slow for the main thread, so it runs once per thread.
+    uintptr_t stackTop() {
+        thread_local uintptr_t top = [] {
+            uintptr_t end = 0;
+            pthread_attr_t attr;
+            if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+                void* base = nullptr;
+                size_t size = 0;
+                if (pthread_attr_getstack(&attr, &base, &size) == 0) {
+                    end = reinterpret_cast<uintptr_t>(base) + size;
+                }
+                pthread_attr_destroy(&attr);
+            }
+            return end;
+        }();
+        return top;
+    }
+}
+
+__attribute__((noinline))
+size_t StackCapture::capture(uint64_t* frames, size_t max) {
+#if defined(__x86_64__) || defined(__aarch64__)
+    // Both keep a frame record of {caller's frame pointer, return address}
+    // at the frame pointer
+    const uintptr_t top = stackTop();
+    const uintptr_t image_begin = reinterpret_cast<uintptr_t>(&__executable_start);
+    const uintptr_t image_end = reinterpret_cast<uintptr_t>(&etext);
+    auto frame = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+    size_t count = 0;
+    while (count < max) {
+        // Only read inside the live part of this stack; a chain broken by
+        // code built without frame pointers ends the walk
+        if (frame % alignof(uintptr_t) != 0 || frame + 2 * sizeof(uintptr_t) > top) {
+            break;
+        }
+        const auto* record = reinterpret_cast<const uintptr_t*>(frame);
+        uintptr_t address = record[1];
+        if (address == 0) {
+            break;
+        }
+        frames[count++] = address >= image_begin && address < image_end ?
+            (address - image_begin) | kImageOffset : address;
+        uintptr_t next = record[0];
+        if (next <= frame) {
+            break;
+        }
+        frame = next;
+    }
+    return count;
+#else
+    (void)frames;
+    (void)max;
+    return 0;
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Raw stack capture for error records, cheap enough for a producer thread.
+//
+// capture() follows the frame-pointer chain of the calling thread and keeps
+// only return addresses: no unwinder, no symbol lookup, no allocation, no
+// lock. The release build keeps frame pointers for this. Addresses inside
+// the logger's own executable are stored as offsets from the start of its
+// image, so they stay valid under ASLR and can be symbolized offline
+// against the split debuginfo (ThreadedLogger.debug) with logcat --symbols.
+namespace StackCapture {
+    constexpr size_t kMaxFrames = 32;
+
+    // Set on a frame that is an offset into the executable; frames without
+    // it are absolute addresses (shared libraries)
+    constexpr uint64_t kImageOffset = uint64_t{1} << 63;
+
+    // Store up to max frames of the calling thread, innermost (the caller of
+    // capture()) first; returns the number stored, 0 where unsupported
+    size_t capture(uint64_t* frames, size_t max);
+}
@@ -0,0 +1,91 @@
+#include "StripeManifest.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace {
+    constexpr char kMagicLine[] = "stripe-manifest 1";
+}
+
+std::optional<StripeManifest> StripeManifest::read(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != kMagicLine) {
+        return std::nullopt;
+    }
+
+    StripeManifest manifest;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "block_bytes") {
+            fields >> manifest.block_bytes;
+        } else if (key == "stripe") {
+            std::string stripe;
+            std::getline(fields >> std::ws, stripe);
+            manifest.stripes.push_back(stripe);
+        }
+    }
+    if (manifest.block_bytes == 0 || manifest.stripes.empty()) {
+        throw std::runtime_error("Malformed stripe manifest: " + path);
+    }
+    return manifest;
+}
+
+void StripeManifest::write(const std::string& path) const {
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << kMagicLine << "\n";
+        out << "block_bytes " << block_bytes << "\n";
+        for (const auto& stripe : stripes) {
+            out << "stripe " << stripe << "\n";
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("Error writing stripe manifest: " + temp);
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Error installing stripe manifest: " + path);
+    }
+}
+
+uint64_t StripeManifest::logicalSize(const std::vector<uint64_t>& stripe_sizes) const {
+    uint64_t size = 0;
+    for (uint64_t block = 0;; ++block) {
+        size_t stripe = block % stripes.size();
+        uint64_t file_offset = block / stripes.size() * block_bytes;
+        if (stripe_sizes[stripe] <= file_offset) {
+            return size;
+        }
+        uint64_t available = stripe_sizes[stripe] - file_offset;
+        if (available < block_bytes) {
+            return size + available;
+        }
+        size += block_bytes;
+    }
+}
+
+std::vector<uint64_t> StripeManifest::stripeSizesFor(uint64_t logical_size) const {
+    uint64_t blocks = logical_size / block_bytes;
+    uint64_t rounds = blocks / stripes.size();
+    size_t partial = blocks % stripes.size();   // Stripe holding the last, partial block
+    std::vector<uint64_t> sizes(stripes.size(), rounds * block_bytes);
+    for (size_t stripe = 0; stripe < partial; ++stripe) {
+        sizes[stripe] += block_bytes;
+    }
+    sizes[partial] += logical_size % block_bytes;
+    return sizes;
+}
+
+std::vector<uint64_t> StripeManifest::stripeSizes() const {
+    std::vector<uint64_t> sizes;
+    for (const auto& stripe : stripes) {
+        struct stat st;
+        sizes.push_back(::stat(stripe.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0);
+    }
+    return sizes;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Layout of a log striped across several directories.
+//
+// The logical stream is cut into fixed-size blocks dealt round-robin to the
+// stripe files: block b lives in stripe b % N at offset (b / N) * block_bytes.
+// The manifest is a small text file at the logical log path:
+//   stripe-manifest 1
+//   block_bytes 1048576
+//   stripe /mnt/a/app.log.stripe0
+//   stripe /mnt/b/app.log.stripe1
+struct StripeManifest {
+    size_t block_bytes = 0;
+    std::vector<std::string> stripes;   // In stripe order
+
+    // Read a manifest; returns nullopt if path is not one
+    static std::optional<StripeManifest> read(const std::string& path);
+
+    // Write the manifest atomically (temp file + rename)
+    void write(const std::string& path) const;
+
+    // Where a logical offset lives
+    size_t stripeOf(uint64_t offset) const { return (offset / block_bytes) % stripes.size(); }
+    uint64_t fileOffsetOf(uint64_t offset) const {
+        return (offset / block_bytes) / stripes.size() * block_bytes + offset % block_bytes;
+    }
+
+    // Length of the readable logical stream given each stripe file's size:
+    // everything up to the first block that is missing or short
+    uint64_t logicalSize(const std::vector<uint64_t>& stripe_sizes) const;
+
+    // Size each stripe file has when the logical stream is logical_size long
+    std::vector<uint64_t> stripeSizesFor(uint64_t logical_size) const;
+
+    // Current size of each stripe file (0 if missing)
+    std::vector<uint64_t> stripeSizes() const;
+};
@@ -0,0 +1,149 @@
+#include "StripedSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // Blocks a stripe may have queued before write() waits for it
+    constexpr size_t kMaxPendingBlocks = 4;
+
+    std::string baseName(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+StripedSink::StripedSink(const std::string& manifest_path, const std::vector<std::string>& directories,
+                         size_t block_bytes)
+    : manifest_path_(manifest_path), max_pending_bytes_(block_bytes * kMaxPendingBlocks) {
+    if (directories.empty()) {
+        throw std::invalid_argument("striping needs at least one directory");
+    }
+    // Readers map the stripes block by block, so blocks are whole pages
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    if (block_bytes == 0 || block_bytes % page != 0) {
+        throw std::invalid_argument("stripe block size must be a non-zero multiple of " +
+                                    std::to_string(page / 1024) + " KiB");
+    }
+
+    // Desired layout; an existing manifest must agree with it
+    manifest_.block_bytes = block_bytes;
+    for (size_t i = 0; i < directories.size(); ++i) {
+        manifest_.stripes.push_back(directories[i] + "/" + baseName(manifest_path) + ".stripe" +
+                                    std::to_string(i));
+    }
+    if (auto existing = StripeManifest::read(manifest_path)) {
+        if (existing->block_bytes != manifest_.block_bytes || existing->stripes != manifest_.stripes) {
+            throw std::runtime_error("Stripe layout differs from existing manifest: " + manifest_path);
+        }
+    }
+
+    for (const auto& path : manifest_.stripes) {
+        auto stripe = std::make_unique<Stripe>();
+        stripe->path = path;
+        stripe->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (stripe->fd < 0) {
+            throw std::runtime_error("Error opening stripe file: " + path);
+        }
+        stripes_.push_back(std::move(stripe));
+    }
+
+    // Continue after the readable part. Anything past it (a torn block from
+    // a crash, or later blocks on other stripes) is cut off; otherwise a
+    // stripe that stays longer than the new stream would show readers stale
+    // blocks once the torn one is filled in again.
+    auto sizes = manifest_.stripeSizes();
+    logical_size_ = manifest_.logicalSize(sizes);
+    auto expected = manifest_.stripeSizesFor(logical_size_);
+    for (size_t i = 0; i < stripes_.size(); ++i) {
+        if (sizes[i] > expected[i] && ::ftruncate(stripes_[i]->fd, static_cast<off_t>(expected[i])) != 0) {
+            throw std::runtime_error("Error truncating torn stripe file: " + stripes_[i]->path);
+        }
+    }
+    manifest_.write(manifest_path);
+
+    for (auto& stripe : stripes_) {
+        stripe->thread = std::thread(&StripedSink::runStripe, this, std::ref(*stripe));
+    }
+}
+
+StripedSink::~StripedSink() {
+    for (auto& stripe : stripes_) {
+        {
+            std::lock_guard<std::mutex> lock(stripe->mutex);
+            stripe->stopping = true;
+        }
+        stripe->ready.notify_all();
+    }
+    for (auto& stripe : stripes_) {
+        if (stripe->thread.joinable()) {
+            stripe->thread.join();
+        }
+    }
+}
+
+bool StripedSink::write(const char* data, size_t size) {
+    while (size > 0) {
+        size_t in_block = logical_size_ % manifest_.block_bytes;
+        size_t piece = std::min(size, manifest_.block_bytes - in_block);
+        Stripe& stripe = *stripes_[manifest_.stripeOf(logical_size_)];
+
+        {
+            std::unique_lock<std::mutex> lock(stripe.mutex);
+            stripe.drained.wait(lock, [&] {
+                return stripe.pending_bytes < max_pending_bytes_ || failed_.load();
+            });
+            stripe.jobs.push_back({manifest_.fileOffsetOf(logical_size_), std::string(data, piece)});
+            stripe.pending_bytes += piece;
+        }
+        stripe.ready.notify_one();
+
+        logical_size_ += piece;
+        data += piece;
+        size -= piece;
+    }
+    return !failed_.load();
+}
+
+void StripedSink::runStripe(Stripe& stripe) {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(stripe.mutex);
+            stripe.ready.wait(lock, [&] { return !stripe.jobs.empty() || stripe.stopping; });
+            if (stripe.jobs.empty()) {
+                return;
+            }
+            job = std::move(stripe.jobs.front());
+            stripe.jobs.pop_front();
+        }
+
+        const char* p = job.data.data();
+        size_t left = job.data.size();
+        uint64_t offset = job.file_offset;
+        while (left > 0) {
+            ssize_t written = ::pwrite(stripe.fd, p, left, static_cast<off_t>(offset));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (!failed_.exchange(true)) {
+                    std::cerr << "Error writing stripe file " << stripe.path << "\n";
+                }
+                break;
+            }
+            p += written;
+            left -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            stripe.pending_bytes -= job.data.size();
+        }
+        stripe.drained.notify_all();
+    }
+}
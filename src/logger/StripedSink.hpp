@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "LogSink.hpp"
+#include "StripeManifest.hpp"
+
+// Sink that stripes the log round-robin across several directories.
+//
+// write() cuts the stream into StripeManifest blocks and queues each piece
+// for the stripe that owns it. Every stripe has its own thread issuing
+// pwrite() calls, so N devices absorb the load in parallel. When a stripe
+// falls too far behind, write() waits, which backs pressure up into the
+// producer queues.
+class StripedSink : public LogSink {
+public:
+    // Constructor takes the manifest path (the logical log path), the stripe
+    // directories and the block size; an existing striped log is continued
+    StripedSink(const std::string& manifest_path, const std::vector<std::string>& directories,
+                size_t block_bytes);
+
+    // Destructor finishes queued writes and stops the stripe threads
+    ~StripedSink() override;
+
+    // Non-copyable
+    StripedSink(const StripedSink&) = delete;
+    StripedSink& operator=(const StripedSink&) = delete;
+
+    // Queue data for the stripe threads; returns false once a stripe failed
+    bool write(const char* data, size_t size) override;
+
+    const std::string& path() const override { return manifest_path_; }
+
+private:
+    struct Job {
+        uint64_t file_offset;
+        std::string data;
+    };
+
+    struct Stripe {
+        std::string path;
+        int fd = -1;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable ready;     // Jobs queued or stopping
+        std::condition_variable drained;   // Pending bytes went down
+        std::deque<Job> jobs;
+        size_t pending_bytes = 0;
+        bool stopping = false;
+
+        ~Stripe() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+
+    // Stripe thread main loop
+    void runStripe(Stripe& stripe);
+
+    std::string manifest_path_;
+    StripeManifest manifest_;
+    std::vector<std::unique_ptr<Stripe>> stripes_;
+    uint64_t logical_size_ = 0;
+    size_t max_pending_bytes_;
+    std::atomic<bool> failed_{false};
+};
@@ -0,0 +1,107 @@
+#include "ThreadGroup.hpp"
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <climits>
+#include <unistd.h>
+
+namespace {
+    // Below this many threads one spawner is as fast as several
+    constexpr size_t kThreadsPerSpawner = 512;
+    constexpr size_t kMaxSpawners = 8;
+}
+
+ThreadGroup::ThreadGroup(size_t stack_bytes, size_t spawners)
+    : stack_bytes_(0), spawners_(spawners) {
+    pthread_attr_init(&attr_);
+    if (stack_bytes > 0) {
+        // Whole pages, and no less than the C library needs for TLS and itself
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        stack_bytes = std::max<size_t>(stack_bytes, PTHREAD_STACK_MIN);
+        stack_bytes = (stack_bytes + page - 1) / page * page;
+        int error = pthread_attr_setstacksize(&attr_, stack_bytes);
+        if (error != 0) {
+            pthread_attr_destroy(&attr_);
+            throw std::system_error(error, std::generic_category(), "thread stack size");
+        }
+    }
+    pthread_attr_getstacksize(&attr_, &stack_bytes_);
+}
+
+ThreadGroup::~ThreadGroup() {
+    join();
+    pthread_attr_destroy(&attr_);
+}
+
+void* ThreadGroup::trampoline(void* arg) {
+    auto* slot = static_cast<Slot*>(arg);
+    slot->group->body_(slot->index);
+    return nullptr;
+}
+
+int ThreadGroup::spawn(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        int error = pthread_create(&slots_[i].thread, &attr_, &ThreadGroup::trampoline, &slots_[i]);
+        if (error != 0) {
+            return error;
+        }
+        slots_[i].started = true;
+    }
+    return 0;
+}
+
+void ThreadGroup::start(size_t count, std::function<void(size_t)> body) {
+    join();
+    body_ = std::move(body);
+    slots_ = std::make_unique<Slot[]>(count);
+    count_ = count;
+    for (size_t i = 0; i < count; ++i) {
+        slots_[i] = Slot{this, i, pthread_t{}, false};
+    }
+
+    size_t spawners = spawners_;
+    if (spawners == 0) {
+        spawners = std::min<size_t>({std::max(1u, std::thread::hardware_concurrency()), kMaxSpawners,
+                                     (count + kThreadsPerSpawner - 1) / kThreadsPerSpawner});
+    }
+    spawners = std::max<size_t>(1, std::min(spawners, count));
+
+    // Each spawner creates one contiguous slice, so index order is kept per slice
+    std::atomic<int> failure{0};
+    if (spawners == 1) {
+        failure = spawn(0, count);
+    } else {
+        std::vector<std::thread> creators;
+        for (size_t s = 0; s < spawners; ++s) {
+            creators.emplace_back([this, &failure, s, spawners, count] {
+                int error = spawn(count * s / spawners, count * (s + 1) / spawners);
+                int none = 0;
+                if (error != 0) {
+                    failure.compare_exchange_strong(none, error);
+                }
+            });
+        }
+        for (auto& creator : creators) {
+            creator.join();
+        }
+    }
+
+    started_ = static_cast<size_t>(std::count_if(slots_.get(), slots_.get() + count,
+                                                 [](const Slot& slot) { return slot.started; }));
+    if (failure != 0) {
+        throw std::system_error(failure, std::generic_category(),
+                                "started only " + std::to_string(started_) + " of " + std::to_string(count) +
+                                " threads");
+    }
+}
+
+void ThreadGroup::join() {
+    for (size_t i = 0; i < count_; ++i) {
+        if (slots_[i].started) {
+            pthread_join(slots_[i].thread, nullptr);
+            slots_[i].started = false;
+        }
+    }
+    started_ = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <pthread.h>
+
+// Starts and joins a large group of producer threads.
+//
+// std::thread gives every thread the default stack (8 MiB with the usual
+// ulimit), which for thousands of producers reserves tens of GiB of address
+// space. A group creates plain pthreads with a stack of its own size, and
+// can spread the pthread_create() calls of a big group over a few spawner
+// threads so startup is not one long serial loop.
+class ThreadGroup {
+public:
+    // stack_bytes 0 keeps the system default; spawners is the number of
+    // threads creating the group (0 = pick from the CPU count and the size)
+    ThreadGroup(size_t stack_bytes, size_t spawners);
+
+    // Destructor joins whatever is still running
+    ~ThreadGroup();
+
+    // Non-copyable
+    ThreadGroup(const ThreadGroup&) = delete;
+    ThreadGroup& operator=(const ThreadGroup&) = delete;
+
+    // Start count threads running body(index) and return once all are
+    // created; throws std::system_error if one cannot be (those already
+    // started keep running until joined)
+    void start(size_t count, std::function<void(size_t)> body);
+
+    // Wait for every started thread to finish
+    void join();
+
+    // Threads started and not yet joined
+    size_t size() const { return started_; }
+
+    // Stack size the threads actually get (after rounding up)
+    size_t stackBytes() const { return stack_bytes_; }
+
+private:
+    struct Slot {
+        ThreadGroup* group;
+        size_t index;
+        pthread_t thread;
+        bool started;
+    };
+
+    static void* trampoline(void* arg);
+
+    // Create the threads of slots [begin, end); returns 0 or the first error
+    int spawn(size_t begin, size_t end);
+
+    size_t stack_bytes_;
+    size_t spawners_;
+    pthread_attr_t attr_;
+    std::function<void(size_t)> body_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t count_ = 0;
+    size_t started_ = 0;
+};
@@ -1,34 +1,98 @@
 #include "ThreadLogger.hpp"
 #include <iostream>
-#include <fstream>
 #include <thread>
 #include <chrono>
 #include <random>
-#include <format>  // C++20 format
+#include <cstring>
+#include <algorithm>
+#include "LogRecord.hpp"
+#include "StackCapture.hpp"
 
-LoggerThread::LoggerThread(int id, int jitter_ms) 
-    : thread_id_(id), jitter_ms_(jitter_ms), counter_(0) {}
+namespace {
+    int64_t nowNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+LoggerThread::LoggerThread(int id, int jitter_ms, SegmentQueue& queue, uint16_t channel) 
+    : thread_id_(id), jitter_ms_(jitter_ms), counter_(0), queue_(queue), channel_(channel) {}
+
+bool LoggerThread::enqueue(const void* record, uint32_t length) {
+    if (GlobalState::getOverflowPolicy() == OverflowPolicy::Block) {
+        return queue_.pushWait(record, length,
+                               std::chrono::milliseconds(GlobalState::getBlockTimeoutMs()));
+    }
+    return queue_.push(record, length);
+}
+
+void LoggerThread::enqueueText(const std::string& line) {
+    RecordHeader header{};
+    header.kind = RecordKind::Text;
+    header.channel = channel_;
+    header.thread_id = static_cast<uint32_t>(thread_id_);
+    header.timestamp_ns = nowNanoseconds();
+
+    std::string record(sizeof(header) + line.size(), '\0');
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), line.data(), line.size());
+    enqueue(record.data(), static_cast<uint32_t>(record.size()));
+}
+
+bool LoggerThread::enqueueError(const std::string& line) {
+    // Raw return addresses only; logcat --symbols resolves them offline
+    uint64_t frames[StackCapture::kMaxFrames];
+    size_t count = StackCapture::capture(frames, StackCapture::kMaxFrames);
+
+    TraceRecord header{};
+    header.header.kind = RecordKind::Trace;
+    header.header.channel = channel_;
+    header.header.thread_id = static_cast<uint32_t>(thread_id_);
+    header.header.timestamp_ns = nowNanoseconds();
+    header.frame_count = static_cast<uint32_t>(count);
+
+    char record[sizeof(TraceRecord) + sizeof(frames) + 256];
+    size_t text_length = std::min(line.size(), sizeof(record) - sizeof(header) - count * sizeof(uint64_t));
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), frames, count * sizeof(uint64_t));
+    std::memcpy(record + sizeof(header) + count * sizeof(uint64_t), line.data(), text_length);
+    return enqueue(record, static_cast<uint32_t>(sizeof(header) + count * sizeof(uint64_t) + text_length));
+}
+
+void LoggerThread::reportDrops() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_report_ < std::chrono::seconds(1)) {
+        return;
+    }
+    // A report that does not fit either is retried with the next record
+    if (enqueueError("Thread " + std::to_string(thread_id_) + ": Error: queue full, dropped " +
+                     std::to_string(unreported_drops_) + " records\n")) {
+        unreported_drops_ = 0;
+        last_report_ = now;
+    }
+}
     
 void LoggerThread::operator()() {
     // Apply initial jitter to stagger thread starts
     std::this_thread::sleep_for(std::chrono::milliseconds(jitter_ms_));
     
     while (GlobalState::isRunning()) {
-        // Get current time
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
-        std::tm tm_info = *std::localtime(&time_t_now);
-        
-        // Format timestamp using C++20 std::format
-        std::string timestamp = std::format("{:04d}-{:02d}-{:02d} {:02d}:{:02d}:{:02d}",
-            tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
-            tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
-
-        // Log message with mutex protection
-        {
-            std::lock_guard<std::mutex> lock(GlobalState::getFileMutex());
-            GlobalState::getLogFile() << "Thread " << thread_id_ << ": [" << timestamp 
-                     << "] Has counter " << counter_++ << std::endl;
+        // Queue space freed since the last drop goes to the report first
+        if (unreported_drops_ > 0) {
+            reportDrops();
+        }
+
+        // Capture the raw fields; the writer formats them in batches
+        CounterRecord record{};
+        record.header.kind = RecordKind::Counter;
+        record.header.channel = channel_;
+        record.header.thread_id = static_cast<uint32_t>(thread_id_);
+        record.header.timestamp_ns = nowNanoseconds();
+        record.counter = counter_++;
+
+        // Hand the message to the writer thread; no file lock on this path
+        if (!enqueue(&record, sizeof(record))) {
+            ++unreported_drops_;
         }
 
         // Sleep with random jitter
@@ -41,8 +105,5 @@ void LoggerThread::operator()() {
     }
 
     // Log thread shutdown
-    {
-        std::lock_guard<std::mutex> lock(GlobalState::getFileMutex());
-        GlobalState::getLogFile() << "Thread " << thread_id_ << ": Shutting down gracefully." << std::endl;
-    }
+    enqueueText("Thread " + std::to_string(thread_id_) + ": Shutting down gracefully.\n");
 }
\ No newline at end of file
@@ -1,28 +1,49 @@
 #pragma once
 
 #include <atomic>
-#include <mutex>
-#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "LoggerConfig.hpp"
+#include "SegmentQueue.hpp"
 
 // Forward declarations for globals accessed in ThreadLogger.cpp
 namespace GlobalState {
-    extern std::mutex& getFileMutex();
-    extern std::ofstream& getLogFile();
     extern bool isRunning();
     extern int getSleepMs();
+    extern OverflowPolicy getOverflowPolicy();
+    extern int getBlockTimeoutMs();
 }
 
 // Modern C++ class for thread management
 class LoggerThread {
 public:
-    // Constructor initializes thread with ID and jitter
-    LoggerThread(int id, int jitter_ms);
+    // Constructor initializes thread with ID, jitter, its writer queue and
+    // the channel its records are tagged with
+    LoggerThread(int id, int jitter_ms, SegmentQueue& queue, uint16_t channel = 0);
     
     // Thread function operator
     void operator()();
     
 private:
+    // Hand a record to the writer according to the overflow policy;
+    // false if it was dropped
+    bool enqueue(const void* record, uint32_t length);
+
+    // Enqueue a preformatted line
+    void enqueueText(const std::string& line);
+
+    // Enqueue an error line together with the stack that reported it
+    bool enqueueError(const std::string& line);
+
+    // Report records dropped since the last report, at most once a second
+    void reportDrops();
+
     int thread_id_;
     int jitter_ms_;
-    int counter_;
+    uint64_t counter_;
+    SegmentQueue& queue_;
+    uint16_t channel_;
+    uint64_t unreported_drops_ = 0;
+    std::chrono::steady_clock::time_point last_report_{};
 };
\ No newline at end of file
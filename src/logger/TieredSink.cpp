@@ -0,0 +1,250 @@
+#include "TieredSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // How often a failed primary is probed again
+    constexpr auto kProbeInterval = std::chrono::seconds(1);
+
+    // Backfill granularity, and how much one maintain() call may copy
+    constexpr size_t kBackfillChunk = 1u << 20;
+    constexpr size_t kBackfillBudget = 8u << 20;
+
+    std::string baseName(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    int64_t steadyNs(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+}
+
+TieredSink::TieredSink(std::unique_ptr<FileSink> primary, const std::string& spill_dir, int latency_limit_ms)
+    : primary_(std::move(primary)),
+      spill_path_(spill_dir + "/" + baseName(primary_->path()) + ".spill"),
+      backfill_path_(spill_path_ + ".backfill"),
+      latency_limit_(std::chrono::milliseconds(latency_limit_ms)) {
+    spill_fd_ = ::open(spill_path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (spill_fd_ < 0) {
+        throw std::runtime_error("Error opening spill file: " + spill_path_);
+    }
+
+    // Data spilled by an earlier run goes back first
+    struct stat st;
+    if (::fstat(spill_fd_, &st) == 0 && st.st_size > 0) {
+        spill_size_ = static_cast<uint64_t>(st.st_size);
+        backfilled_ = std::min(loadBackfill(), spill_size_);
+        pending_bytes_ = spill_size_ - backfilled_;
+        startSpill("spill file from an earlier run");
+        next_probe_ = spill_started_;
+    } else {
+        ::unlink(backfill_path_.c_str());
+    }
+}
+
+bool TieredSink::saveBackfill(uint64_t spill_offset, uint64_t primary_size, uint64_t length) {
+    // Fixed width, so each record overwrites the last in one small write
+    char record[64];
+    int size = std::snprintf(record, sizeof(record), "%20llu %20llu %20llu\n",
+                             static_cast<unsigned long long>(spill_offset),
+                             static_cast<unsigned long long>(primary_size),
+                             static_cast<unsigned long long>(length));
+    int fd = ::open(backfill_path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::pwrite(fd, record, static_cast<size_t>(size), 0) == size;
+    ::close(fd);
+    return ok;
+}
+
+uint64_t TieredSink::loadBackfill() {
+    unsigned long long spill_offset = 0;
+    unsigned long long primary_size = 0;
+    unsigned long long length = 0;
+    FILE* file = std::fopen(backfill_path_.c_str(), "r");
+    if (!file) {
+        return 0;
+    }
+    int fields = std::fscanf(file, "%llu %llu %llu", &spill_offset, &primary_size, &length);
+    std::fclose(file);
+    if (fields != 3) {
+        return 0;
+    }
+
+    // Nothing else writes the primary while spilling, so its size tells
+    // whether the recorded chunk got there
+    off_t end = ::lseek(primary_->fd(), 0, SEEK_END);
+    if (end < 0 || static_cast<uint64_t>(end) <= primary_size) {
+        return spill_offset;
+    }
+    if (static_cast<uint64_t>(end) >= primary_size + length) {
+        return spill_offset + length;
+    }
+    if (::ftruncate(primary_->fd(), static_cast<off_t>(primary_size)) != 0) {
+        std::cerr << "Error cutting a partly backfilled chunk off " << primary_->path() << "\n";
+    }
+    return spill_offset;
+}
+
+TieredSink::~TieredSink() {
+    ::close(spill_fd_);
+}
+
+bool TieredSink::write(const char* data, size_t size) {
+    if (!spilling_) {
+        Outcome outcome = writePrimary(data, size);
+        if (outcome == Outcome::Ok) {
+            return true;
+        }
+        if (outcome == Outcome::Slow) {
+            startSpill("slow writes");
+            return true;
+        }
+        startSpill(std::strerror(errno));
+    }
+    if (!writeSpill(data, size)) {
+        return false;
+    }
+    spilled_bytes_.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
+
+TieredSink::Outcome TieredSink::writePrimary(const char* data, size_t size) {
+    int fd = primary_->fd();
+    off_t before = ::lseek(fd, 0, SEEK_END);
+    auto begin = std::chrono::steady_clock::now();
+    if (!primary_->write(data, size)) {
+        int error = errno;
+        if (before >= 0 && ::ftruncate(fd, before) != 0) {
+            std::cerr << "Error rolling back partial write to " << primary_->path() << "\n";
+        }
+        errno = error;
+        return Outcome::Failed;
+    }
+    bool slow = latency_limit_.count() > 0 && std::chrono::steady_clock::now() - begin > latency_limit_;
+    return slow ? Outcome::Slow : Outcome::Ok;
+}
+
+bool TieredSink::writeSpill(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(spill_fd_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        spill_size_ += static_cast<uint64_t>(written);
+        pending_bytes_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void TieredSink::startSpill(const std::string& reason) {
+    spilling_ = true;
+    spill_started_ = std::chrono::steady_clock::now();
+    next_probe_ = spill_started_ + kProbeInterval;
+    spills_.fetch_add(1, std::memory_order_relaxed);
+    spill_started_ns_ = steadyNs(spill_started_);
+    spilling_now_ = true;
+    std::cerr << "Primary log " << primary_->path() << " unavailable (" << reason << "); spilling to "
+              << spill_path_ << "\n";
+}
+
+void TieredSink::backfill() {
+    std::vector<char> buffer(kBackfillChunk);
+    size_t budget = kBackfillBudget;
+    while (backfilled_ < spill_size_ && budget > 0) {
+        size_t want = std::min<uint64_t>(buffer.size(), spill_size_ - backfilled_);
+        ssize_t got = ::pread(spill_fd_, buffer.data(), want, static_cast<off_t>(backfilled_));
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error reading spill file " << spill_path_ << "\n";
+            next_probe_ = std::chrono::steady_clock::now() + kProbeInterval;
+            return;
+        }
+
+        off_t primary_size = ::lseek(primary_->fd(), 0, SEEK_END);
+        if (primary_size < 0 || !saveBackfill(backfilled_, static_cast<uint64_t>(primary_size),
+                                              static_cast<uint64_t>(got))) {
+            std::cerr << "Error recording backfill progress in " << backfill_path_ << "\n";
+            next_probe_ = std::chrono::steady_clock::now() + kProbeInterval;
+            return;
+        }
+        Outcome outcome = writePrimary(buffer.data(), static_cast<size_t>(got));
+        if (outcome == Outcome::Failed) {
+            next_probe_ = std::chrono::steady_clock::now() + kProbeInterval;
+            return;
+        }
+        backfilled_ += static_cast<uint64_t>(got);
+        backfilled_bytes_.fetch_add(static_cast<uint64_t>(got), std::memory_order_relaxed);
+        pending_bytes_.fetch_sub(static_cast<uint64_t>(got), std::memory_order_relaxed);
+        budget -= std::min(budget, static_cast<size_t>(got));
+        if (outcome == Outcome::Slow) {
+            // Still struggling; keep new data on the spill side for now
+            next_probe_ = std::chrono::steady_clock::now() + kProbeInterval;
+            return;
+        }
+    }
+    if (backfilled_ < spill_size_) {
+        return;   // Budget used up; continue on the next call
+    }
+
+    // Caught up in order; new batches can go straight to the primary
+    if (::ftruncate(spill_fd_, 0) != 0) {
+        std::cerr << "Error emptying spill file " << spill_path_ << "\n";
+    }
+    ::unlink(backfill_path_.c_str());
+    auto duration = std::chrono::steady_clock::now() - spill_started_;
+    spill_ns_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()),
+                        std::memory_order_relaxed);
+    spilling_now_ = false;
+    std::cerr << "Primary log " << primary_->path() << " recovered; backfilled " << backfilled_ << " bytes after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms\n";
+    spilling_ = false;
+    spill_size_ = 0;
+    backfilled_ = 0;
+}
+
+void TieredSink::markBoundary() {
+    if (!spilling_) {
+        primary_->markBoundary();
+    }
+}
+
+void TieredSink::maintain() {
+    if (spilling_ && std::chrono::steady_clock::now() >= next_probe_) {
+        backfill();
+    }
+    primary_->maintain();
+}
+
+void TieredSink::appendStats(std::ostream& out) const {
+    primary_->appendStats(out);
+
+    uint64_t spill_ns = spill_ns_.load(std::memory_order_relaxed);
+    bool spilling = spilling_now_.load();
+    if (spilling) {
+        spill_ns += static_cast<uint64_t>(steadyNs(std::chrono::steady_clock::now()) - spill_started_ns_.load());
+    }
+    out << "spill.active=" << (spilling ? 1 : 0) << "\n"
+        << "spill.count=" << spills_.load(std::memory_order_relaxed) << "\n"
+        << "spill.bytes=" << spilled_bytes_.load(std::memory_order_relaxed) << "\n"
+        << "spill.pending_bytes=" << pending_bytes_.load(std::memory_order_relaxed) << "\n"
+        << "spill.backfilled_bytes=" << backfilled_bytes_.load(std::memory_order_relaxed) << "\n"
+        << "spill.duration_ms=" << spill_ns / 1000000 << "\n";
+}
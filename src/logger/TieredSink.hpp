@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "FileSink.hpp"
+#include "LogSink.hpp"
+
+// Sink that fails over from a slow or full primary log to a spill file.
+//
+// Batches go to the primary FileSink until a write fails (ENOSPC, EIO, ...)
+// or takes longer than the latency limit. A failed write is cut back off
+// the primary so it never holds a torn batch. From then on batches are
+// appended to "<spill_dir>/<log name>.spill". Between batches the writer
+// probes the primary once a second by copying the oldest spilled data back.
+// Once the spill file is drained in order, writes return to the primary and
+// the spill file is emptied. A spill file left by a crash is backfilled
+// on startup.
+//
+// Before each chunk is copied back, "<spill file>.backfill" records where
+// the copy starts in the spill file and how long the primary was. A
+// restart resumes from there instead of copying the spill file from the
+// beginning again. A chunk cut short by the crash is cut off the primary
+// and copied again.
+class TieredSink : public LogSink {
+public:
+    // Constructor takes the primary sink, the spill directory and the write
+    // latency (ms) that counts as slow (0 = fail over on errors only)
+    TieredSink(std::unique_ptr<FileSink> primary, const std::string& spill_dir, int latency_limit_ms);
+
+    // Destructor closes the spill file
+    ~TieredSink() override;
+
+    // Non-copyable
+    TieredSink(const TieredSink&) = delete;
+    TieredSink& operator=(const TieredSink&) = delete;
+
+    // Write to the primary, or to the spill file while spilling
+    bool write(const char* data, size_t size) override;
+
+    const std::string& path() const override { return primary_->path(); }
+
+    void markBoundary() override;
+    void maintain() override;
+    void appendStats(std::ostream& out) const override;
+
+private:
+    enum class Outcome {
+        Ok,
+        Slow,     // Written, but slower than the limit
+        Failed    // Nothing written (partial writes are rolled back)
+    };
+
+    // Write to the primary and classify the result
+    Outcome writePrimary(const char* data, size_t size);
+
+    // Append to the spill file
+    bool writeSpill(const char* data, size_t size);
+
+    // Switch writes to the spill file
+    void startSpill(const std::string& reason);
+
+    // Copy spilled data back to the primary while it keeps up
+    void backfill();
+
+    // Record the chunk about to be copied back, for a restart
+    bool saveBackfill(uint64_t spill_offset, uint64_t primary_size, uint64_t length);
+
+    // Spill bytes an earlier run already copied back, from its record
+    uint64_t loadBackfill();
+
+    std::unique_ptr<FileSink> primary_;
+    std::string spill_path_;
+    std::string backfill_path_;
+    int spill_fd_;
+    std::chrono::nanoseconds latency_limit_;
+
+    bool spilling_ = false;
+    uint64_t spill_size_ = 0;            // Bytes in the spill file
+    uint64_t backfilled_ = 0;            // Spill bytes already copied back
+    std::chrono::steady_clock::time_point spill_started_;
+    std::chrono::steady_clock::time_point next_probe_;
+
+    // Stats, readable from any thread
+    std::atomic<bool> spilling_now_{false};
+    std::atomic<uint64_t> spills_{0};
+    std::atomic<uint64_t> spilled_bytes_{0};
+    std::atomic<uint64_t> backfilled_bytes_{0};
+    std::atomic<uint64_t> pending_bytes_{0};
+    std::atomic<uint64_t> spill_ns_{0};          // Finished spill episodes
+    std::atomic<int64_t> spill_started_ns_{0};   // steady_clock of the current one
+};
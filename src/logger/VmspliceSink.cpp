@@ -0,0 +1,144 @@
+#include "VmspliceSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int kPipeBytes = 1 << 20;   // Pages one vmsplice() can hand over
+}
+
+VmspliceSink::VmspliceSink(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Error opening log file: " + path);
+    }
+    // Without O_APPEND a second writer would overwrite ours or be overwritten
+    struct flock lock{};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (::fcntl(fd_, F_OFD_SETLK, &lock) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Another logger already splices into " + path);
+    }
+    int pipe_fds[2];
+    if (::lseek(fd_, 0, SEEK_END) < 0 || ::pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        int saved = errno;
+        ::close(fd_);
+        throw std::runtime_error("Error setting up vmsplice for " + path + ": " + std::strerror(saved));
+    }
+    pipe_read_ = pipe_fds[0];
+    pipe_write_ = pipe_fds[1];
+    ::fcntl(pipe_write_, F_SETPIPE_SZ, kPipeBytes);   // Best effort; capped by pipe-max-size
+    int capacity = ::fcntl(pipe_write_, F_GETPIPE_SZ);
+    pipe_bytes_ = capacity > 0 ? static_cast<size_t>(capacity) : 65536;
+}
+
+VmspliceSink::~VmspliceSink() {
+    ::close(pipe_read_);
+    ::close(pipe_write_);
+    ::close(fd_);
+}
+
+bool VmspliceSink::write(const char* data, size_t size) {
+    if (spliceable_ && !ownsEnd()) {
+        // Someone else appended: from now on append the plain way as well
+        std::cerr << "Log file " << path_ << " has another writer; switching from splice to O_APPEND writes\n";
+        ::fcntl(fd_, F_SETFL, O_APPEND);
+        spliceable_ = false;
+    }
+    if (!spliceable_) {
+        return writePlain(data, size);
+    }
+    while (size > 0) {
+        iovec iov{const_cast<char*>(data), std::min(size, pipe_bytes_)};
+        ssize_t mapped = ::vmsplice(pipe_write_, &iov, 1, 0);
+        if (mapped < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        size_t moved = 0;
+        if (!drainPipe(static_cast<size_t>(mapped), moved)) {
+            discardPipe();
+            if (spliceable_) {
+                return false;
+            }
+            // The descriptor stopped accepting splice(); write the rest the
+            // plain way
+            return writePlain(data + moved, size - moved);
+        }
+        data += mapped;
+        size -= static_cast<size_t>(mapped);
+    }
+    return true;
+}
+
+bool VmspliceSink::drainPipe(size_t size, size_t& moved_total) {
+    while (size > 0) {
+        ssize_t moved = ::splice(pipe_read_, nullptr, fd_, nullptr, size, SPLICE_F_MOVE);
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EINVAL) {
+                spliceable_ = false;
+            }
+            return false;
+        }
+        if (moved == 0) {
+            return false;
+        }
+        spliced_bytes_.fetch_add(static_cast<uint64_t>(moved), std::memory_order_relaxed);
+        moved_total += static_cast<size_t>(moved);
+        size -= static_cast<size_t>(moved);
+    }
+    return true;
+}
+
+bool VmspliceSink::ownsEnd() const {
+    struct stat st;
+    off_t position = ::lseek(fd_, 0, SEEK_CUR);
+    return position < 0 || ::fstat(fd_, &st) != 0 || st.st_size == position;
+}
+
+void VmspliceSink::discardPipe() {
+    // The pipe still references the caller's pages; empty it before the
+    // caller reuses them
+    char scratch[65536];
+    int available = 0;
+    while (::ioctl(pipe_read_, FIONREAD, &available) == 0 && available > 0) {
+        if (::read(pipe_read_, scratch, std::min(sizeof(scratch), static_cast<size_t>(available))) <= 0) {
+            break;
+        }
+    }
+}
+
+bool VmspliceSink::writePlain(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        fallback_bytes_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void VmspliceSink::appendStats(std::ostream& out) const {
+    out << "vmsplice.spliced_bytes=" << spliced_bytes_.load(std::memory_order_relaxed) << "\n"
+        << "vmsplice.fallback_bytes=" << fallback_bytes_.load(std::memory_order_relaxed) << "\n";
+}
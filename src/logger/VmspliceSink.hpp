@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include "LogSink.hpp"
+
+// Log file written by handing the writer's batch pages to the kernel:
+// vmsplice() maps them into a private pipe without copying, and splice()
+// moves them from the pipe into the file.
+//
+// splice() refuses files opened with O_APPEND (EINVAL), so the file is
+// opened for plain writing and positioned at its end; the file position is
+// used (not a private offset) so an external hotswap of the descriptor keeps
+// working. Without O_APPEND the sink must be the only writer: it takes an
+// exclusive OFD lock on the file, so a second vmsplice logger fails to
+// start, and before each batch it checks that the file still ends at its
+// position. If another process appended, the descriptor gets O_APPEND and
+// plain writes from then on.
+// write() empties the pipe before it returns, which is the point where the
+// kernel no longer references the caller's pages and the batch buffer may
+// be reused. A descriptor that cannot be spliced into (for example one a
+// hotswap reopened with O_APPEND) is written with write(2) from then on.
+class VmspliceSink : public LogSink {
+public:
+    // Constructor opens (or creates) the file and the pipe; throws on failure
+    explicit VmspliceSink(const std::string& path);
+
+    // Destructor closes the pipe and the file
+    ~VmspliceSink() override;
+
+    // Non-copyable
+    VmspliceSink(const VmspliceSink&) = delete;
+    VmspliceSink& operator=(const VmspliceSink&) = delete;
+
+    // Write the whole buffer; returns false on error
+    bool write(const char* data, size_t size) override;
+
+    void appendStats(std::ostream& out) const override;
+
+    // Accessors
+    int fd() const { return fd_; }
+    const std::string& path() const override { return path_; }
+
+private:
+    // Move size bytes from the pipe into the file, counting them in moved
+    bool drainPipe(size_t size, size_t& moved);
+
+    // True unless the file grew past the position, i.e. someone else wrote
+    bool ownsEnd() const;
+
+    // Throw away whatever a failed splice left in the pipe
+    void discardPipe();
+
+    // Fallback path: plain write(2) of the whole buffer
+    bool writePlain(const char* data, size_t size);
+
+    std::string path_;
+    int fd_;
+    int pipe_read_ = -1;
+    int pipe_write_ = -1;
+    size_t pipe_bytes_;
+    bool spliceable_ = true;
+
+    std::atomic<uint64_t> spliced_bytes_{0};
+    std::atomic<uint64_t> fallback_bytes_{0};
+};
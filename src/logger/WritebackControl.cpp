@@ -0,0 +1,47 @@
+#include "WritebackControl.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+
+namespace {
+    // Smallest chunk worth a system call
+    constexpr uint64_t kMinChunk = 64u << 10;
+}
+
+WritebackControl::WritebackControl(int fd, size_t dirty_max_bytes)
+    : fd_(fd),
+      dirty_max_(std::max<uint64_t>(dirty_max_bytes, 2 * kMinChunk)),
+      chunk_(std::max<uint64_t>(dirty_max_ / 4 / 4096 * 4096, kMinChunk)) {
+    // Existing contents are the kernel's business; start at the current end
+    off_t end = ::lseek(fd, 0, SEEK_END);
+    started_ = completed_ = end > 0 ? static_cast<uint64_t>(end) / chunk_ * chunk_ : 0;
+}
+
+void WritebackControl::written(uint64_t end) {
+    // The file shrank (truncated, or its head collapsed) below what was
+    // already handed to writeback; start over there. end may still be past
+    // completed_, which then only has to move back as far as started_.
+    if (end < started_) {
+        started_ = end / chunk_ * chunk_;
+        completed_ = std::min(completed_, started_);
+    }
+
+    // Start writeback of every chunk that filled up
+    while (end - started_ >= chunk_) {
+        ::sync_file_range(fd_, static_cast<off_t>(started_), static_cast<off_t>(chunk_), SYNC_FILE_RANGE_WRITE);
+        started_ += chunk_;
+    }
+
+    // Over the cap: wait for the oldest chunks and drop them from the cache
+    while (end - completed_ > dirty_max_ && completed_ < started_) {
+        auto begin = std::chrono::steady_clock::now();
+        ::sync_file_range(fd_, static_cast<off_t>(completed_), static_cast<off_t>(chunk_),
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        wait_ns_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count()), std::memory_order_relaxed);
+        ::posix_fadvise(fd_, static_cast<off_t>(completed_), static_cast<off_t>(chunk_), POSIX_FADV_DONTNEED);
+        completed_ += chunk_;
+        dropped_bytes_.fetch_add(chunk_, std::memory_order_relaxed);
+    }
+    dirty_bytes_.store(end - completed_, std::memory_order_relaxed);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Keeps a log file's dirty page-cache footprint bounded.
+//
+// Left alone, the kernel lets a burst pile up dirty pages until the global
+// dirty thresholds trip, then stalls whichever write() happens to cross
+// them. Instead, every time a chunk of the file fills up its writeback is
+// started right away (sync_file_range WRITE). When more than dirty_max_bytes
+// are not yet known to be on disk, the oldest chunk is waited for and then
+// dropped from the cache with posix_fadvise(DONTNEED), since a log is
+// rarely read back. The writer pays small, regular waits instead of a rare
+// long one, and the file's cache use stays near the cap.
+class WritebackControl {
+public:
+    // Constructor takes the file and the dirty byte cap
+    WritebackControl(int fd, size_t dirty_max_bytes);
+
+    // Account for data written up to file offset end
+    void written(uint64_t end);
+
+    // Accessors for stats; safe from any thread
+    uint64_t dirtyBytes() const { return dirty_bytes_.load(std::memory_order_relaxed); }
+    uint64_t waitNs() const { return wait_ns_.load(std::memory_order_relaxed); }
+    uint64_t droppedBytes() const { return dropped_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    int fd_;
+    uint64_t dirty_max_;
+    uint64_t chunk_;            // Writeback is started and waited for in chunks
+    uint64_t started_ = 0;      // Writeback started below this offset
+    uint64_t completed_ = 0;    // Written back and dropped below this offset
+
+    std::atomic<uint64_t> dirty_bytes_{0};
+    std::atomic<uint64_t> wait_ns_{0};
+    std::atomic<uint64_t> dropped_bytes_{0};
+};
@@ -0,0 +1,741 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "FileSink.hpp"
+#include "LogRecord.hpp"
+#include "LogWriter.hpp"
+#include "StackCapture.hpp"
+#include "ThreadGroup.hpp"
+#include "VmspliceSink.hpp"
+
+// Micro-benchmarks for the log output path.
+// Each scenario runs the same workload under the configurations it compares
+// and prints one row per configuration.
+
+namespace {
+    struct Options {
+        std::string scenario;
+        std::string path = "./logbench.tmp";
+        size_t total_bytes = 256u << 20;
+        size_t write_bytes = 1u << 20;
+        size_t dirty_max_bytes = 8u << 20;
+        size_t threads = 0;       // 0 = the scenario's default
+        size_t stack_bytes = 256u << 10;
+        size_t lines = 10;
+        size_t runs = 200;
+        int seconds = 3;
+        uint64_t io_rate = 16u << 20;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <scenario> [options]\n";
+        std::cout << "Scenarios:\n";
+        std::cout << "  writeback        Write stall and page-cache use with and without --dirty-max-kb\n";
+        std::cout << "  sink             Throughput and CPU per GiB of write(2), vmsplice+splice and io_uring\n";
+        std::cout << "  fairness         Share of a throttled writer each producer thread gets, drained in turn\n"
+                  << "                   or by (weighted) deficit round robin\n";
+        std::cout << "  stack            Cost of a raw stack capture against backtrace() and backtrace_symbols()\n";
+        std::cout << "  startup          Time until N threads with a writer queue each all run and have queued a\n"
+                  << "                   record, and the memory they take, with default or small stacks created\n"
+                  << "                   serially or in parallel\n";
+        std::cout << "  shortrun         Wall time of a process that logs a few lines and exits: plain writes,\n"
+                  << "                   the full engine and the lazy engine\n";
+        std::cout << "Options:\n";
+        std::cout << "  --path=FILE      Scratch file (default: ./logbench.tmp)\n";
+        std::cout << "  --mb=N           Data written per run (default: 256)\n";
+        std::cout << "  --write-kb=N     Size of each write (default: 1024)\n";
+        std::cout << "  --dirty-max-kb=N Dirty cap for the controlled run (default: 8192)\n";
+        std::cout << "  --threads=N      fairness: producer threads (default: 4); startup: threads (default: 10000)\n";
+        std::cout << "  --stack-kb=N     startup: small stack size (default: 256)\n";
+        std::cout << "  --lines=N        shortrun: lines each process logs (default: 10)\n";
+        std::cout << "  --runs=N         shortrun: processes per configuration (default: 200)\n";
+        std::cout << "  --seconds=N      fairness: length of each run (default: 3)\n";
+        std::cout << "  --io-rate-kb=N   fairness: writer bandwidth in KiB/s (default: 16384)\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        options.scenario = argv[1];
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--path") {
+                options.path = value;
+            } else if (name == "--mb") {
+                options.total_bytes = std::stoull(value) << 20;
+            } else if (name == "--write-kb") {
+                options.write_bytes = std::stoull(value) << 10;
+            } else if (name == "--dirty-max-kb") {
+                options.dirty_max_bytes = std::stoull(value) << 10;
+            } else if (name == "--threads") {
+                options.threads = std::stoull(value);
+            } else if (name == "--stack-kb") {
+                options.stack_bytes = std::stoull(value) << 10;
+            } else if (name == "--lines") {
+                options.lines = std::stoull(value);
+            } else if (name == "--runs") {
+                options.runs = std::stoull(value);
+            } else if (name == "--seconds") {
+                options.seconds = std::stoi(value);
+            } else if (name == "--io-rate-kb") {
+                options.io_rate = std::stoull(value) << 10;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.threads == 0) {
+            options.threads = options.scenario == "startup" ? 10000 : 4;
+        }
+        if (options.seconds <= 0 || options.io_rate == 0 || options.stack_bytes == 0 || options.runs == 0) {
+            throw std::invalid_argument("--threads, --seconds, --stack-kb, --runs and --io-rate-kb must be positive");
+        }
+        if (options.write_bytes == 0 || options.total_bytes < options.write_bytes) {
+            throw std::invalid_argument("--mb must cover at least one write");
+        }
+        return options;
+    }
+
+    double percentile(std::vector<double> samples, double p) {
+        if (samples.empty()) {
+            return 0;
+        }
+        size_t rank = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+    // Bytes of the file currently in the page cache
+    size_t cachedBytes(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return 0;
+        }
+        struct stat st;
+        size_t cached = 0;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t length = static_cast<size_t>(st.st_size);
+            void* map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                std::vector<unsigned char> pages((length + page - 1) / page);
+                if (::mincore(map, length, pages.data()) == 0) {
+                    cached = static_cast<size_t>(std::count_if(pages.begin(), pages.end(),
+                        [](unsigned char bits) { return bits & 1; })) * page;
+                }
+                ::munmap(map, length);
+            }
+        }
+        ::close(fd);
+        return cached;
+    }
+
+    // System-wide dirty + writeback memory from /proc/meminfo
+    size_t systemDirtyBytes() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        size_t kb = 0;
+        size_t total = 0;
+        std::string unit;
+        while (meminfo >> key >> kb) {
+            if (key == "Dirty:" || key == "Writeback:") {
+                total += kb * 1024;
+            }
+            std::getline(meminfo, unit);
+        }
+        return total;
+    }
+
+    void printHeader(const std::string& first_column) {
+        std::cout << std::left << std::setw(22) << first_column << std::right
+                  << std::setw(10) << "p50_us" << std::setw(10) << "p99_us" << std::setw(10) << "max_us"
+                  << std::setw(10) << "MiB/s" << std::setw(12) << "close_ms"
+                  << std::setw(12) << "cached_MiB" << std::setw(12) << "dirty_MiB" << "\n";
+    }
+
+    // Write the workload through a FileSink and report per-write latency,
+    // the final fsync, file cache residency and peak system dirty memory
+    void runWriteback(const Options& options, const std::string& label, size_t dirty_max_bytes) {
+        ::unlink(options.path.c_str());
+        std::string chunk(options.write_bytes, 'x');
+        for (size_t i = 79; i < chunk.size(); i += 80) {
+            chunk[i] = '\n';
+        }
+
+        std::vector<double> latencies;
+        size_t peak_dirty = 0;
+        double close_ms = 0;
+        size_t cached = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            FileSink sink(options.path);
+            if (dirty_max_bytes > 0) {
+                sink.enableWriteback(dirty_max_bytes);
+            }
+            for (size_t written = 0; written + chunk.size() <= options.total_bytes; written += chunk.size()) {
+                auto begin = std::chrono::steady_clock::now();
+                if (!sink.write(chunk.data(), chunk.size())) {
+                    throw std::runtime_error("Error writing " + options.path);
+                }
+                latencies.push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - begin).count());
+                if (latencies.size() % 16 == 0) {
+                    peak_dirty = std::max(peak_dirty, systemDirtyBytes());
+                }
+            }
+            cached = cachedBytes(options.path);
+
+            // What is still dirty has to be paid for eventually
+            auto sync_begin = std::chrono::steady_clock::now();
+            ::fdatasync(sink.fd());
+            close_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sync_begin).count();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << percentile(latencies, 0.50)
+                  << std::setw(10) << percentile(latencies, 0.99)
+                  << std::setw(10) << percentile(latencies, 1.0)
+                  << std::setw(10) << static_cast<double>(options.total_bytes >> 20) / seconds
+                  << std::setw(12) << std::setprecision(1) << close_ms
+                  << std::setw(12) << static_cast<double>(cached) / (1 << 20)
+                  << std::setw(12) << static_cast<double>(peak_dirty) / (1 << 20) << "\n";
+
+        // Leave the next run a clean page cache
+        int fd = ::open(options.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+        ::unlink(options.path.c_str());
+    }
+
+    // Minimal io_uring writer on the raw system calls: keeps up to depth
+    // writes of the same buffer in flight at increasing file offsets
+    class UringWriter {
+    public:
+        UringWriter(int fd, unsigned depth) : fd_(fd) {
+            io_uring_params params{};
+            ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+            if (ring_fd_ < 0) {
+                throw std::runtime_error("io_uring_setup failed: " + std::string(std::strerror(errno)));
+            }
+            sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            sq_ring_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd_, IORING_OFF_SQ_RING);
+            cq_ring_ = ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd_, IORING_OFF_CQ_RING);
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+            if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+                throw std::runtime_error("io_uring mmap failed");
+            }
+            auto* sq = static_cast<char*>(sq_ring_);
+            auto* cq = static_cast<char*>(cq_ring_);
+            sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            depth_ = params.sq_entries;
+        }
+
+        ~UringWriter() {
+            ::munmap(sqes_, sqes_size_);
+            ::munmap(cq_ring_, cq_size_);
+            ::munmap(sq_ring_, sq_size_);
+            ::close(ring_fd_);
+        }
+
+        // Write size bytes of data total_bytes / size times
+        void writeRepeated(const char* data, size_t size, size_t total_bytes) {
+            uint64_t offset = 0;
+            unsigned in_flight = 0;
+            while (offset < total_bytes || in_flight > 0) {
+                unsigned queued = 0;
+                while (in_flight + queued < depth_ && offset + size <= total_bytes) {
+                    unsigned tail = *sq_tail_;
+                    unsigned index = tail & sq_mask_;
+                    io_uring_sqe& sqe = sqes_[index];
+                    std::memset(&sqe, 0, sizeof(sqe));
+                    sqe.opcode = IORING_OP_WRITE;
+                    sqe.fd = fd_;
+                    sqe.addr = reinterpret_cast<uint64_t>(data);
+                    sqe.len = static_cast<uint32_t>(size);
+                    sqe.off = offset;
+                    sq_array_[index] = index;
+                    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+                    offset += size;
+                    ++queued;
+                }
+                if (offset + size > total_bytes) {
+                    offset = total_bytes;
+                }
+                if (::syscall(__NR_io_uring_enter, ring_fd_, queued, 1, IORING_ENTER_GETEVENTS,
+                              nullptr, 0) < 0 && errno != EINTR) {
+                    throw std::runtime_error("io_uring_enter failed: " + std::string(std::strerror(errno)));
+                }
+                in_flight += queued;
+
+                unsigned head = *cq_head_;
+                while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                    if (cqe.res != static_cast<int>(size)) {
+                        throw std::runtime_error("io_uring write failed or was short");
+                    }
+                    ++head;
+                    --in_flight;
+                }
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            }
+        }
+
+    private:
+        int fd_;
+        int ring_fd_;
+        unsigned depth_;
+        size_t sq_size_;
+        size_t cq_size_;
+        size_t sqes_size_;
+        void* sq_ring_;
+        void* cq_ring_;
+        io_uring_sqe* sqes_;
+        unsigned* sq_tail_;
+        unsigned sq_mask_;
+        unsigned* sq_array_;
+        unsigned* cq_head_;
+        unsigned* cq_tail_;
+        unsigned cq_mask_;
+        io_uring_cqe* cqes_;
+    };
+
+    double cpuSeconds() {
+        rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+               static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    // Write the workload with one backend and report throughput and CPU
+    // time (user + system, this process and its io_uring workers) per GiB
+    template <typename WriteAll>
+    void runSink(const Options& options, const std::string& label, WriteAll&& write_all) {
+        ::unlink(options.path.c_str());
+        double cpu_begin = cpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        write_all();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = cpuSeconds() - cpu_begin;
+
+        struct stat st{};
+        ::stat(options.path.c_str(), &st);
+        if (static_cast<size_t>(st.st_size) != options.total_bytes / options.write_bytes * options.write_bytes) {
+            throw std::runtime_error(label + " wrote " + std::to_string(st.st_size) + " bytes");
+        }
+        double gib = static_cast<double>(st.st_size) / (1u << 30);
+        std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << static_cast<double>(st.st_size >> 20) / seconds
+                  << std::setw(14) << std::setprecision(3) << cpu / gib << "\n";
+
+        int fd = ::open(options.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+        ::unlink(options.path.c_str());
+    }
+
+    void benchSink(const Options& options) {
+        std::cout << "sink: " << (options.total_bytes >> 20) << " MiB in " << (options.write_bytes >> 10)
+                  << " KiB writes to " << options.path << " (page cache, no fsync)\n";
+        std::cout << std::left << std::setw(22) << "backend" << std::right
+                  << std::setw(10) << "MiB/s" << std::setw(14) << "cpu_s_per_GiB" << "\n";
+
+        // A page-aligned buffer, as vmsplice() hands over whole pages
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        std::vector<char> storage(options.write_bytes + page);
+        char* chunk = storage.data() + (page - reinterpret_cast<uintptr_t>(storage.data()) % page) % page;
+        for (size_t i = 0; i < options.write_bytes; ++i) {
+            chunk[i] = (i % 80 == 79) ? '\n' : 'x';
+        }
+        size_t writes = options.total_bytes / options.write_bytes;
+
+        runSink(options, "write", [&] {
+            FileSink sink(options.path);
+            for (size_t i = 0; i < writes; ++i) {
+                if (!sink.write(chunk, options.write_bytes)) {
+                    throw std::runtime_error("Error writing " + options.path);
+                }
+            }
+        });
+        runSink(options, "vmsplice+splice", [&] {
+            VmspliceSink sink(options.path);
+            for (size_t i = 0; i < writes; ++i) {
+                if (!sink.write(chunk, options.write_bytes)) {
+                    throw std::runtime_error("Error writing " + options.path);
+                }
+            }
+        });
+        for (unsigned depth : {1u, 8u}) {
+            try {
+                runSink(options, "io_uring qd=" + std::to_string(depth), [&] {
+                    int fd = ::open(options.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                    if (fd < 0) {
+                        throw std::runtime_error("Error opening " + options.path);
+                    }
+                    try {
+                        UringWriter ring(fd, depth);
+                        ring.writeRepeated(chunk, options.write_bytes, writes * options.write_bytes);
+                    } catch (...) {
+                        ::close(fd);
+                        throw;
+                    }
+                    ::close(fd);
+                });
+            } catch (const std::exception& e) {
+                std::cout << std::left << std::setw(22) << ("io_uring qd=" + std::to_string(depth))
+                          << "unavailable: " << e.what() << "\n";
+            }
+        }
+    }
+
+    // Producer threads push counter records as fast as their queues take
+    // them into a writer throttled to options.io_rate, and the writer's
+    // fairness stats are reported
+    void runFairness(const Options& options, const std::string& label, size_t quantum_bytes,
+                     const std::vector<uint32_t>& weights) {
+        ::unlink(options.path.c_str());
+        LoggerConfig config;
+        config.drain_quantum_bytes = quantum_bytes;
+        FileSink sink(options.path);
+        SegmentPool pool(config.segment_bytes, config.poolBytes(options.threads));
+        IoGovernor governor(options.io_rate, 0);
+        LogWriter writer(sink, pool, config, &governor);
+
+        std::vector<SegmentQueue*> queues;
+        for (size_t i = 0; i < options.threads; ++i) {
+            queues.push_back(&writer.createQueue(weights.empty() ? 1 : weights[i % weights.size()]));
+        }
+        writer.start();
+        std::atomic<bool> running{true};
+        std::vector<std::thread> producers;
+        for (size_t i = 0; i < options.threads; ++i) {
+            producers.emplace_back([&, i] {
+                CounterRecord record{};
+                record.header.kind = RecordKind::Counter;
+                record.header.thread_id = static_cast<uint32_t>(i);
+                while (running.load(std::memory_order_relaxed)) {
+                    record.header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                    if (queues[i]->push(&record, sizeof(record))) {
+                        ++record.counter;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+        running = false;
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        uint64_t consumed = 0;
+        uint64_t offered = 0;
+        for (const SegmentQueue* queue : queues) {
+            consumed += queue->consumed();
+            offered += queue->pushed() + queue->dropped();
+        }
+        WriterStats stats = writer.stats();
+        writer.stop(false);
+        ::unlink(options.path.c_str());
+        std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(12) << static_cast<double>(consumed) / options.seconds
+                  << std::setw(10) << std::setprecision(1)
+                  << (offered ? 100.0 * static_cast<double>(stats.dropped) / static_cast<double>(offered) : 0.0)
+                  << std::setw(10) << std::setprecision(3) << stats.fairness
+                  << std::setw(12) << std::setprecision(0) << stats.min_rate
+                  << std::setw(12) << stats.max_rate << "\n";
+    }
+
+    void benchFairness(const Options& options) {
+        std::cout << "fairness: " << options.threads << " producer threads, writer throttled to "
+                  << (options.io_rate >> 10) << " KiB/s, " << options.seconds << " s per run\n";
+        std::cout << std::left << std::setw(22) << "drain" << std::right
+                  << std::setw(12) << "records/s" << std::setw(10) << "drop_%" << std::setw(10) << "jain"
+                  << std::setw(12) << "min_rate" << std::setw(12) << "max_rate" << "\n";
+        runFairness(options, "in turn", 0, {});
+        runFairness(options, "round robin 16K", 16u << 10, {});
+        std::vector<uint32_t> weights;
+        std::string label = "weighted ";
+        for (size_t i = 0; i < options.threads; ++i) {
+            weights.push_back(static_cast<uint32_t>(i + 1));
+            label += (i ? ":" : "") + std::to_string(i + 1);
+        }
+        runFairness(options, label.size() > 22 ? "weighted 1:2:..." : label, 16u << 10, weights);
+    }
+
+    // Recurse depth frames deep, then time capture() there
+    __attribute__((noinline)) double timeAtDepth(int depth, const std::function<void()>& capture) {
+        if (depth > 0) {
+            double ns = timeAtDepth(depth - 1, capture);
+            asm volatile("" ::: "memory");   // Keep the recursion from becoming a loop
+            return ns;
+        }
+        constexpr int kRuns = 20000;
+        capture();   // First call per thread sets up caches
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRuns; ++i) {
+            capture();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / kRuns;
+    }
+
+    void benchStack() {
+        constexpr int kDepth = 12;
+        std::cout << "stack: capture " << kDepth << " frames below the benchmark's own\n";
+        std::cout << std::left << std::setw(26) << "method" << std::right << std::setw(10) << "frames"
+                  << std::setw(14) << "ns/capture" << "\n";
+        uint64_t frames[StackCapture::kMaxFrames];
+        void* addresses[StackCapture::kMaxFrames];
+        size_t count = 0;
+        auto row = [&](const std::string& label, const std::function<void()>& capture) {
+            double ns = timeAtDepth(kDepth, capture);
+            std::cout << std::left << std::setw(26) << label << std::right << std::setw(10) << count
+                      << std::setw(14) << std::fixed << std::setprecision(0) << ns << "\n";
+        };
+        row("frame pointers", [&] { count = StackCapture::capture(frames, StackCapture::kMaxFrames); });
+        row("backtrace()", [&] {
+            count = static_cast<size_t>(backtrace(addresses, StackCapture::kMaxFrames));
+        });
+        row("backtrace_symbols()", [&] {
+            count = static_cast<size_t>(backtrace(addresses, StackCapture::kMaxFrames));
+            std::free(backtrace_symbols(addresses, static_cast<int>(count)));
+        });
+    }
+
+    // VmRSS and VmSize of this process in KiB
+    std::pair<size_t, size_t> processMemoryKb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        size_t rss = 0;
+        size_t size = 0;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmRSS:", 0) == 0) {
+                rss = std::stoull(line.substr(6));
+            } else if (line.rfind("VmSize:", 0) == 0) {
+                size = std::stoull(line.substr(7));
+            }
+        }
+        return {rss, size};
+    }
+
+    // Startup the way LoggerApp::run does it: a writer queue per thread
+    // first, then the threads, each of which queues one record once running
+    void runStartup(const Options& options, const std::string& label, size_t stack_bytes, size_t spawners) {
+        ::unlink(options.path.c_str());
+        std::atomic<size_t> running{0};
+        std::atomic<bool> release{false};
+        auto before = processMemoryKb();
+        auto start = std::chrono::steady_clock::now();
+        double created_ms = 0;
+        double running_ms = 0;
+        std::pair<size_t, size_t> after;
+        size_t queue_bytes = 0;
+        {
+            LoggerConfig config;
+            FileSink sink(options.path);
+            SegmentPool pool(config.segment_bytes, config.poolBytes(options.threads));
+            LogWriter writer(sink, pool, config);
+            writer.start();
+            std::vector<SegmentQueue*> queues;
+            for (size_t i = 0; i < options.threads; ++i) {
+                queues.push_back(&writer.createQueue());
+            }
+
+            ThreadGroup group(stack_bytes, spawners);
+            try {
+                group.start(options.threads, [&](size_t i) {
+                    CounterRecord record{};
+                    record.header.kind = RecordKind::Counter;
+                    record.header.thread_id = static_cast<uint32_t>(i);
+                    record.counter = i;
+                    queues[i]->push(&record, sizeof(record));
+                    running.fetch_add(1, std::memory_order_release);
+                    release.wait(false, std::memory_order_acquire);
+                });
+            } catch (...) {
+                release = true;
+                release.notify_all();
+                throw;
+            }
+            created_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            while (running.load(std::memory_order_acquire) < options.threads) {
+                std::this_thread::yield();
+            }
+            running_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            after = processMemoryKb();
+            queue_bytes = pool.peakBytesInUse();
+            release = true;
+            release.notify_all();
+            group.join();
+            stack_bytes = group.stackBytes();
+            writer.stop();
+        }
+        ::unlink(options.path.c_str());
+        std::cout << std::left << std::setw(24) << label << std::right << std::setw(10) << (stack_bytes >> 10)
+                  << std::fixed << std::setprecision(1) << std::setw(12) << created_ms << std::setw(12) << running_ms
+                  << std::setw(12) << static_cast<double>(after.first - std::min(after.first, before.first)) / 1024
+                  << std::setw(12) << static_cast<double>(after.second - std::min(after.second, before.second)) / 1024
+                  << std::setw(12) << static_cast<double>(queue_bytes) / (1 << 20) << "\n";
+    }
+
+    void benchStartup(const Options& options) {
+        size_t parallel = std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 8);
+        std::cout << "startup: " << options.threads << " threads with a writer queue each, that queue one record "
+                  << "and wait once running\n";
+        std::cout << std::left << std::setw(24) << "config" << std::right << std::setw(10) << "stack_kb"
+                  << std::setw(12) << "created_ms" << std::setw(12) << "running_ms" << std::setw(12) << "rss_mb"
+                  << std::setw(12) << "vsize_mb" << std::setw(12) << "queue_mb" << "\n";
+        runStartup(options, "default stack, serial", 0, 1);
+        runStartup(options, "small stack, serial", options.stack_bytes, 1);
+        runStartup(options, "small stack, " + std::to_string(parallel) + " spawners", options.stack_bytes, parallel);
+    }
+
+    // Child process body: log options.lines lines the way the label says
+    void logShortRun(const Options& options, const std::string& label, size_t lazy_records) {
+        if (label == "plain write") {
+            int fd = ::open(options.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            for (size_t i = 0; i < options.lines; ++i) {
+                std::string line = "Thread 0: line " + std::to_string(i) + "\n";
+                if (::write(fd, line.data(), line.size()) < 0) {
+                    break;
+                }
+            }
+            ::close(fd);
+            return;
+        }
+        LoggerConfig config;
+        config.lazy_records = lazy_records;
+        FileSink sink(options.path);
+        SegmentPool pool(config.segment_bytes, config.poolBytes(1));
+        LogWriter writer(sink, pool, config);
+        writer.start();
+        SegmentQueue& queue = writer.createQueue();
+        CounterRecord record{};
+        record.header.kind = RecordKind::Counter;
+        for (size_t i = 0; i < options.lines; ++i) {
+            record.header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            record.counter = i;
+            queue.push(&record, sizeof(record));
+        }
+        writer.stop();
+    }
+
+    void runShortRun(const Options& options, const std::string& label, size_t lazy_records) {
+        std::vector<double> wall_us;
+        long max_rss_kb = 0;
+        for (size_t run = 0; run < options.runs; ++run) {
+            ::unlink(options.path.c_str());
+            auto start = std::chrono::steady_clock::now();
+            pid_t pid = ::fork();
+            if (pid < 0) {
+                throw std::runtime_error("fork failed");
+            }
+            if (pid == 0) {
+                logShortRun(options, label, lazy_records);
+                ::_exit(0);
+            }
+            int status = 0;
+            rusage usage{};
+            ::wait4(pid, &status, 0, &usage);
+            wall_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            max_rss_kb = std::max(max_rss_kb, usage.ru_maxrss);
+        }
+        struct stat st{};
+        ::stat(options.path.c_str(), &st);
+        ::unlink(options.path.c_str());
+        std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << percentile(wall_us, 0.50) << std::setw(10) << percentile(wall_us, 0.90)
+                  << std::setw(12) << max_rss_kb << std::setw(10) << st.st_size << "\n";
+    }
+
+    void benchShortRun(const Options& options) {
+        std::cout << "shortrun: " << options.runs << " processes per config, each logging " << options.lines
+                  << " lines to " << options.path << " and exiting\n";
+        std::cout << std::left << std::setw(22) << "config" << std::right << std::setw(10) << "p50_us"
+                  << std::setw(10) << "p90_us" << std::setw(12) << "max_rss_kb" << std::setw(10) << "bytes" << "\n";
+        runShortRun(options, "plain write", 0);
+        runShortRun(options, "full engine", 0);
+        runShortRun(options, "lazy engine (100)", 100);
+    }
+
+    void benchWriteback(const Options& options) {
+        std::cout << "writeback: " << (options.total_bytes >> 20) << " MiB in " << (options.write_bytes >> 10)
+                  << " KiB writes to " << options.path << "\n";
+        printHeader("config");
+        runWriteback(options, "kernel default", 0);
+        runWriteback(options, "dirty-max=" + std::to_string(options.dirty_max_bytes >> 10) + "K",
+                     options.dirty_max_bytes);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        if (options.scenario == "writeback") {
+            benchWriteback(options);
+        } else if (options.scenario == "sink") {
+            benchSink(options);
+        } else if (options.scenario == "fairness") {
+            benchFairness(options);
+        } else if (options.scenario == "stack") {
+            benchStack();
+        } else if (options.scenario == "startup") {
+            benchStartup(options);
+        } else if (options.scenario == "shortrun") {
+            benchShortRun(options);
+        } else {
+            throw std::invalid_argument("unknown scenario: " + options.scenario);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
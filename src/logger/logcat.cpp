@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <unordered_map>
+#include <elf.h>
+#include <unistd.h>
+#include "FrameRecovery.hpp"
+#include "LogImage.hpp"
+#include "RecordFrame.hpp"
+
+// Prints the logical stream of a log to stdout.
+// Works on plain files, stripe manifests (reassembling the stripes) and ring
+// files (oldest to newest),
+// can seek by byte offset or frame sequence, and can strip framing.
+// With --symbols the stacks of error records are resolved to functions and
+// source lines against the logger's debuginfo.
+
+namespace {
+    struct Options {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t length = UINT64_MAX;
+        bool frames = false;
+        uint64_t from_sequence = 0;
+        std::string symbols;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <logfile_or_manifest> [options]\n";
+        std::cout << "  --offset=N      Start at logical byte offset N\n";
+        std::cout << "  --length=N      Stop after N bytes\n";
+        std::cout << "  --frames        Print only the payloads of valid frames (always on for ring files)\n";
+        std::cout << "  --from-seq=N    With --frames, start at the first frame with sequence >= N\n";
+        std::cout << "  --symbols=FILE  Resolve [stack ...] frames with FILE: the unstripped binary that\n"
+                  << "                  wrote the log or its debuginfo (ThreadedLogger.debug); needs addr2line\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--offset=", 0) == 0) {
+                options.offset = std::stoull(arg.substr(9));
+            } else if (arg.rfind("--length=", 0) == 0) {
+                options.length = std::stoull(arg.substr(9));
+            } else if (arg == "--frames") {
+                options.frames = true;
+            } else if (arg.rfind("--from-seq=", 0) == 0) {
+                options.frames = true;
+                options.from_sequence = std::stoull(arg.substr(11));
+            } else if (arg.rfind("--symbols=", 0) == 0) {
+                options.symbols = arg.substr(10);
+            } else if (!arg.empty() && arg[0] != '-' && options.path.empty()) {
+                options.path = arg;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.path.empty()) {
+            throw std::invalid_argument("missing logfile_path");
+        }
+        return options;
+    }
+
+    void write_all(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(STDOUT_FILENO, data, size);
+            if (written < 0) {
+                throw std::runtime_error("Error writing to stdout");
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    // Passes text through and prints the frames of every line ending in a
+    // " [stack ...]" suffix underneath it, one per line. "+0x" frames are
+    // offsets into the logger's executable and are resolved with addr2line;
+    // absolute addresses belong to shared libraries and are printed as is.
+    class Symbolizer {
+    public:
+        explicit Symbolizer(const std::string& path) : path_(path), base_(loadBase(path)) {}
+
+        void write(const char* data, size_t size) {
+            while (size > 0) {
+                const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+                size_t length = newline ? static_cast<size_t>(newline - data) + 1 : size;
+                line_.append(data, length);
+                data += length;
+                size -= length;
+                if (newline) {
+                    writeLine();
+                }
+            }
+        }
+
+        // Write a last line without a newline
+        void finish() {
+            if (!line_.empty()) {
+                writeLine();
+            }
+        }
+
+    private:
+        static constexpr char kStackOpen[] = " [stack";
+
+        // Link-time address the image starts at (where offset 0 lies)
+        static uint64_t loadBase(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            Elf64_Ehdr header;
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+                std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_ident[EI_CLASS] != ELFCLASS64) {
+                throw std::runtime_error("not a 64-bit ELF file: " + path);
+            }
+            uint64_t base = UINT64_MAX;
+            for (unsigned i = 0; i < header.e_phnum; ++i) {
+                Elf64_Phdr segment;
+                in.seekg(static_cast<std::streamoff>(header.e_phoff + i * header.e_phentsize));
+                if (!in.read(reinterpret_cast<char*>(&segment), sizeof(segment))) {
+                    break;
+                }
+                if (segment.p_type == PT_LOAD) {
+                    base = std::min<uint64_t>(base, segment.p_vaddr);
+                }
+            }
+            return base == UINT64_MAX ? 0 : base;
+        }
+
+        void writeLine() {
+            write_all(line_.data(), line_.size());
+            size_t end = line_.size();
+            while (end > 0 && (line_[end - 1] == '\n' || line_[end - 1] == '\r')) {
+                --end;
+            }
+            size_t open = line_.rfind(kStackOpen, end);
+            if (open != std::string::npos && end > 0 && line_[end - 1] == ']') {
+                size_t first = open + sizeof(kStackOpen) - 1;
+                std::string frames = line_.substr(first, end - 1 - first);
+                std::string out;
+                size_t start = 0;
+                int index = 0;
+                while ((start = frames.find_first_not_of(' ', start)) != std::string::npos) {
+                    size_t stop = std::min(frames.find(' ', start), frames.size());
+                    std::string frame = frames.substr(start, stop - start);
+                    out += "    #" + std::to_string(index++) + " " + frame;
+                    if (frame.rfind("+0x", 0) == 0) {
+                        out += " " + resolve(std::stoull(frame.substr(3), nullptr, 16));
+                    }
+                    out += "\n";
+                    start = stop;
+                }
+                write_all(out.data(), out.size());
+            }
+            line_.clear();
+        }
+
+        // "function at file:line" of the call that returned to offset, with
+        // the functions it was inlined into on the following lines
+        const std::string& resolve(uint64_t offset) {
+            auto found = cache_.find(offset);
+            if (found != cache_.end()) {
+                return found->second;
+            }
+            // A return address is just past its call; look up the call itself
+            char address[32];
+            std::snprintf(address, sizeof(address), "0x%llx",
+                          static_cast<unsigned long long>(base_ + (offset > 0 ? offset - 1 : 0)));
+            std::string quoted = "'";
+            for (char c : path_) {
+                quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+            }
+            quoted += "'";
+            std::string command = "addr2line -f -C -i -p -e " + quoted + " " + address + " 2>/dev/null";
+            std::string result;
+            if (FILE* pipe = ::popen(command.c_str(), "r")) {
+                char buffer[4096];
+                while (std::fgets(buffer, sizeof(buffer), pipe)) {
+                    if (!result.empty() && result.back() == '\n') {
+                        result += "       ";
+                    }
+                    result += buffer;
+                }
+                ::pclose(pipe);
+            }
+            while (!result.empty() && result.back() == '\n') {
+                result.pop_back();
+            }
+            return cache_.emplace(offset, result.empty() ? "??" : result).first->second;
+        }
+
+        std::string path_;
+        uint64_t base_;
+        std::string line_;
+        std::unordered_map<uint64_t, std::string> cache_;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        LogImage image(options.path);
+        std::unique_ptr<Symbolizer> symbolizer;
+        if (!options.symbols.empty()) {
+            symbolizer = std::make_unique<Symbolizer>(options.symbols);
+        }
+        auto emit = [&](const char* data, size_t size) {
+            if (symbolizer) {
+                symbolizer->write(data, size);
+            } else {
+                write_all(data, size);
+            }
+        };
+
+        uint64_t begin = std::min<uint64_t>(options.offset, image.size());
+        uint64_t end = image.size() - begin > options.length ? begin + options.length : image.size();
+
+        // A ring is always framed and starts mid-record; show the records
+        if (!options.frames && !image.ring()) {
+            emit(image.data() + begin, end - begin);
+            if (symbolizer) {
+                symbolizer->finish();
+            }
+            return 0;
+        }
+
+        // Frames are in sequence order, so seek with a binary search
+        RecoveryReport report = FrameRecovery().scan(image.data(), image.size());
+        if (image.ring()) {
+            FrameRecovery::dropOverwrittenHead(report);
+        }
+        auto first = std::lower_bound(report.frames.begin(), report.frames.end(), options.from_sequence,
+            [](const FrameExtent& frame, uint64_t sequence) { return frame.sequence < sequence; });
+        for (auto it = first; it != report.frames.end(); ++it) {
+            if (it->offset < begin) {
+                continue;
+            }
+            if (it->offset + it->size > end) {
+                break;
+            }
+            emit(image.data() + it->offset + RecordFrame::kHeaderSize, it->size - RecordFrame::kHeaderSize);
+        }
+        if (symbolizer) {
+            symbolizer->finish();
+        }
+        if (!report.lost.empty()) {
+            std::cerr << "Warning: skipped " << report.lost_bytes << " corrupt bytes in "
+                      << report.lost.size() << " region(s)\n";
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,554 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "CollectorProtocol.hpp"
+#include "ControlServer.hpp"
+#include "FileSink.hpp"
+
+// Local log collector: many logger and logship processes connect over one
+// SOCK_SEQPACKET socket and their batches are merged into one file per
+// application.
+//
+// A single event loop reads every client with recvmmsg(). Each application
+// file has its own writer thread, which writes what has accumulated since
+// its last write in one call and then acks those batches to their clients.
+// When an application's backlog passes --high-water-kb, its clients are no
+// longer read (their socket buffers fill and their sends block) and are
+// sent a Pace message asking them to slow down; both are undone once the
+// backlog drops below --low-water-kb.
+
+namespace {
+    struct Options {
+        std::string socket;
+        std::string dir = ".";
+        std::string control;
+        size_t high_water = 8u << 20;
+        size_t low_water = 2u << 20;
+        uint64_t pace_us = 2000;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <socket> [options]\n";
+        std::cout << "  --dir=DIR           Directory of the per-application logs (default: .)\n";
+        std::cout << "  --control=PATH      Control socket for per-client stats\n";
+        std::cout << "  --high-water-kb=N   Backlog per application that pauses its clients (default: 8192)\n";
+        std::cout << "  --low-water-kb=N    Backlog at which they resume (default: 2048)\n";
+        std::cout << "  --pace-us=N         Delay between batches asked of paused clients (default: 2000)\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--dir") {
+                options.dir = value;
+            } else if (name == "--control") {
+                options.control = value;
+            } else if (name == "--high-water-kb") {
+                options.high_water = std::stoull(value) << 10;
+            } else if (name == "--low-water-kb") {
+                options.low_water = std::stoull(value) << 10;
+            } else if (name == "--pace-us") {
+                options.pace_us = std::stoull(value);
+            } else if (!arg.empty() && arg[0] != '-' && options.socket.empty()) {
+                options.socket = arg;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.socket.empty()) {
+            throw std::invalid_argument("missing socket path");
+        }
+        if (options.low_water >= options.high_water) {
+            throw std::invalid_argument("--low-water-kb must be below --high-water-kb");
+        }
+        return options;
+    }
+
+    std::atomic<bool> running{true};
+
+    void handle_signal(int) {
+        running = false;
+    }
+
+    // Application names become file names
+    std::string fileName(const std::string& app) {
+        std::string name;
+        for (char c : app) {
+            bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                         c == '-' || c == '_' || c == '.';
+            name += plain ? c : '_';
+        }
+        if (name.empty() || name[0] == '.') {
+            name.insert(name.begin(), '_');
+        }
+        return name + ".log";
+    }
+
+    void sendMessage(int fd, CollectorProtocol::MessageType type, uint64_t sequence) {
+        std::string message;
+        CollectorProtocol::encode(message, type, sequence);
+        // Never wait on a client; one that does not read its acks loses them
+        ::send(fd, message.data(), message.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
+    class AppFile;
+
+    // One connected process
+    struct Client {
+        explicit Client(int fd_value, uint64_t id_value) : fd(fd_value), id(id_value) {}
+        ~Client() { ::close(fd); }
+
+        int fd;
+        uint64_t id;
+        std::string app;
+        AppFile* file = nullptr;
+        uint64_t last_bytes = 0;   // For the rate, sampled once a second
+
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> batches{0};
+        std::atomic<uint64_t> rate{0};     // Bytes per second over the last second
+        std::atomic<uint64_t> pauses{0};
+        std::atomic<bool> paused{false};   // Not read until its backlog drains
+    };
+
+    // One output file and the thread that writes it
+    class AppFile {
+    public:
+        // Constructor takes the file, and the eventfd to signal once a backlog
+        // that paused clients has drained below low_water
+        AppFile(const std::string& path, int drained_fd, size_t low_water)
+            : sink_(path), drained_fd_(drained_fd), low_water_(low_water) {
+            thread_ = std::thread(&AppFile::run, this);
+        }
+
+        ~AppFile() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            thread_.join();
+        }
+
+        AppFile(const AppFile&) = delete;
+        AppFile& operator=(const AppFile&) = delete;
+
+        // Event loop: queue a batch; it is acked once written
+        void append(const std::shared_ptr<Client>& client, uint64_t sequence, std::string_view lines) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_.append(lines.data(), lines.size());
+                if (!acks_.empty() && acks_.back().client == client) {
+                    acks_.back().sequence = sequence;
+                } else {
+                    acks_.push_back(Ack{client, sequence});
+                }
+            }
+            pending_bytes_.fetch_add(lines.size(), std::memory_order_relaxed);
+            wake_.notify_one();
+        }
+
+        // Event loop: ask for the drained signal; false if already below
+        bool watchDrain() {
+            watching_.store(true);
+            if (pendingBytes() >= low_water_) {
+                return true;
+            }
+            watching_.store(false);
+            return false;
+        }
+
+        size_t pendingBytes() const { return pending_bytes_.load(std::memory_order_relaxed); }
+        uint64_t writtenBytes() const { return written_bytes_.load(std::memory_order_relaxed); }
+        uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+        const std::string& path() const { return sink_.path(); }
+
+    private:
+        struct Ack {
+            std::shared_ptr<Client> client;
+            uint64_t sequence;
+        };
+
+        void run() {
+            std::string writing;
+            std::vector<Ack> acks;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+                    if (pending_.empty()) {
+                        return;
+                    }
+                    writing.swap(pending_);
+                    acks.swap(acks_);
+                }
+
+                if (sink_.write(writing.data(), writing.size())) {
+                    written_bytes_.fetch_add(writing.size(), std::memory_order_relaxed);
+                    writes_.fetch_add(1, std::memory_order_relaxed);
+                    for (const auto& ack : acks) {
+                        sendMessage(ack.client->fd, CollectorProtocol::MessageType::Ack, ack.sequence);
+                    }
+                } else {
+                    // Acks are cumulative, so a later one would cover these lost
+                    // batches too. Disconnect their clients instead: a client
+                    // that reconnects sends again from its last ack.
+                    std::cerr << "Error writing " << sink_.path() << ": " << std::strerror(errno) << "\n";
+                    for (const auto& ack : acks) {
+                        ::shutdown(ack.client->fd, SHUT_RDWR);
+                    }
+                }
+                size_t left = pending_bytes_.fetch_sub(writing.size()) - writing.size();
+                if (left < low_water_ && watching_.exchange(false)) {
+                    uint64_t one = 1;
+                    ssize_t ignored = ::write(drained_fd_, &one, sizeof(one));
+                    (void)ignored;
+                }
+                writing.clear();
+                acks.clear();
+            }
+        }
+
+        FileSink sink_;
+        int drained_fd_;
+        size_t low_water_;
+        std::atomic<bool> watching_{false};
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::string pending_;
+        std::vector<Ack> acks_;
+        bool stopping_ = false;
+        std::thread thread_;
+
+        std::atomic<size_t> pending_bytes_{0};
+        std::atomic<uint64_t> written_bytes_{0};
+        std::atomic<uint64_t> writes_{0};
+    };
+
+    class Collector {
+    public:
+        explicit Collector(const Options& options) : options_(options) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (options.socket.size() >= sizeof(address.sun_path)) {
+                throw std::invalid_argument("socket path too long: " + options.socket);
+            }
+            std::memcpy(address.sun_path, options.socket.c_str(), options.socket.size() + 1);
+            ::unlink(options.socket.c_str());
+
+            listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                ::listen(listen_fd_, 128) != 0) {
+                throw std::runtime_error("Error listening on " + options.socket + ": " + std::strerror(errno));
+            }
+            epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+            drained_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = kListenId;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+            event.data.u64 = kDrainedId;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, drained_fd_, &event);
+
+            // Receive buffers for one recvmmsg() call
+            buffers_.resize(kBatchMessages * CollectorProtocol::kMaxMessageBytes);
+            for (size_t i = 0; i < kBatchMessages; ++i) {
+                iovecs_[i].iov_base = buffers_.data() + i * CollectorProtocol::kMaxMessageBytes;
+                iovecs_[i].iov_len = CollectorProtocol::kMaxMessageBytes;
+                messages_[i] = mmsghdr{};
+                messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+                messages_[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            if (!options.control.empty()) {
+                control_ = std::make_unique<ControlServer>(options.control);
+                control_->addCommand("stats", [this](const std::string&) { return formatStats(); });
+                control_->start();
+            }
+        }
+
+        ~Collector() {
+            if (control_) {
+                control_->stop();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                clients_.clear();
+            }
+            files_.clear();   // Writes out and acks what is still pending
+            ::close(drained_fd_);
+            ::close(epoll_fd_);
+            ::close(listen_fd_);
+            ::unlink(options_.socket.c_str());
+        }
+
+        void run() {
+            std::cout << "Collecting on " << options_.socket << " into " << options_.dir << "\n";
+            epoll_event events[64];
+            auto last_sample = std::chrono::steady_clock::now();
+            while (running) {
+                int ready = ::epoll_wait(epoll_fd_, events, 64, 100);
+                for (int i = 0; i < ready; ++i) {
+                    if (events[i].data.u64 == kListenId) {
+                        acceptClients();
+                    } else if (events[i].data.u64 == kDrainedId) {
+                        uint64_t count;
+                        ssize_t ignored = ::read(drained_fd_, &count, sizeof(count));
+                        (void)ignored;
+                        resumeClients();
+                    } else {
+                        readClient(events[i].data.u64);
+                    }
+                }
+                if (recheck_paused_) {
+                    recheck_paused_ = false;
+                    resumeClients();
+                }
+
+                auto now = std::chrono::steady_clock::now();
+                if (now - last_sample >= std::chrono::seconds(1)) {
+                    double seconds = std::chrono::duration<double>(now - last_sample).count();
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    for (auto& [id, client] : clients_) {
+                        uint64_t bytes = client->bytes.load(std::memory_order_relaxed);
+                        client->rate = static_cast<uint64_t>(static_cast<double>(bytes - client->last_bytes) / seconds);
+                        client->last_bytes = bytes;
+                    }
+                    last_sample = now;
+                }
+            }
+        }
+
+    private:
+        static constexpr size_t kBatchMessages = 32;
+        static constexpr uint64_t kListenId = 0;    // epoll ids; clients count from 1
+        static constexpr uint64_t kDrainedId = UINT64_MAX;
+
+        void acceptClients() {
+            for (;;) {
+                int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    return;
+                }
+                uint64_t id = next_id_++;
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.u64 = id;
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+                std::lock_guard<std::mutex> lock(mutex_);
+                clients_[id] = std::make_shared<Client>(fd, id);
+            }
+        }
+
+        void readClient(uint64_t id) {
+            std::shared_ptr<Client> client;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = clients_.find(id);
+                if (it == clients_.end()) {
+                    return;
+                }
+                client = it->second;
+            }
+
+            // Take what the socket holds, a vector of messages per call, but
+            // stop once the application falls behind
+            while (!client->paused) {
+                int count = ::recvmmsg(client->fd, messages_, kBatchMessages, MSG_DONTWAIT, nullptr);
+                if (count < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                        return;
+                    }
+                    closeClient(client);
+                    return;
+                }
+                if (count == 0) {
+                    closeClient(client);
+                    return;
+                }
+                for (int i = 0; i < count; ++i) {
+                    size_t length = messages_[i].msg_len;
+                    if (length == 0) {
+                        closeClient(client);   // Orderly shutdown by the peer
+                        return;
+                    }
+                    if (!handleMessage(client, static_cast<const char*>(iovecs_[i].iov_base), length)) {
+                        std::cerr << "Warning: dropping client " << client->id << " after a bad message\n";
+                        closeClient(client);
+                        return;
+                    }
+                }
+                if (client->file && client->file->pendingBytes() > options_.high_water) {
+                    pause(client);
+                    if (!client->file->watchDrain()) {
+                        recheck_paused_ = true;   // Drained in the meantime
+                    }
+                }
+                if (static_cast<size_t>(count) < kBatchMessages) {
+                    return;
+                }
+            }
+        }
+
+        bool handleMessage(const std::shared_ptr<Client>& client, const char* data, size_t length) {
+            CollectorProtocol::Message message;
+            if (!CollectorProtocol::decode(data, length, message)) {
+                return false;
+            }
+            if (message.type == CollectorProtocol::MessageType::Hello) {
+                std::string app(message.payload);
+                std::string path = options_.dir + "/" + fileName(app);
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& file = files_[path];
+                if (!file) {
+                    file = std::make_unique<AppFile>(path, drained_fd_, options_.low_water);
+                }
+                client->app = app;
+                client->file = file.get();
+                return true;
+            }
+            if (message.type != CollectorProtocol::MessageType::Batch || !client->file) {
+                return false;
+            }
+            std::string_view source;
+            std::string_view lines;
+            if (!CollectorProtocol::splitBatch(message.payload, source, lines)) {
+                return false;
+            }
+            client->file->append(client, message.sequence, lines);
+            client->bytes.fetch_add(lines.size(), std::memory_order_relaxed);
+            client->batches.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Stop reading a client until its application's backlog drains
+        void pause(const std::shared_ptr<Client>& client) {
+            // Removed rather than muted: a hangup is reported regardless
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client->fd, nullptr);
+            client->paused = true;
+            client->pauses.fetch_add(1, std::memory_order_relaxed);
+            sendMessage(client->fd, CollectorProtocol::MessageType::Pace, options_.pace_us);
+            paused_.push_back(client);
+            paused_count_ = paused_.size();
+        }
+
+        void resumeClients() {
+            for (size_t i = 0; i < paused_.size();) {
+                auto& client = paused_[i];
+                if (client->file->pendingBytes() >= options_.low_water && client->file->watchDrain()) {
+                    ++i;
+                    continue;
+                }
+                client->paused = false;
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.u64 = client->id;
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client->fd, &event);
+                sendMessage(client->fd, CollectorProtocol::MessageType::Pace, 0);
+                paused_.erase(paused_.begin() + static_cast<long>(i));
+                paused_count_ = paused_.size();
+            }
+        }
+
+        void closeClient(const std::shared_ptr<Client>& client) {
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client->fd, nullptr);
+            for (size_t i = 0; i < paused_.size(); ++i) {
+                if (paused_[i] == client) {
+                    paused_.erase(paused_.begin() + static_cast<long>(i));
+                    paused_count_ = paused_.size();
+                    break;
+                }
+            }
+            // Pending acks keep the descriptor open until they are sent
+            std::lock_guard<std::mutex> lock(mutex_);
+            clients_.erase(client->id);
+        }
+
+        std::string formatStats() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::ostringstream out;
+            out << "clients=" << clients_.size() << "\n"
+                << "paused=" << paused_count_.load() << "\n";
+            for (const auto& [id, client] : clients_) {
+                std::string prefix = "client." + std::to_string(id) + ".";
+                out << prefix << "app=" << client->app << "\n"
+                    << prefix << "bytes=" << client->bytes.load() << "\n"
+                    << prefix << "batches=" << client->batches.load() << "\n"
+                    << prefix << "bytes_per_sec=" << client->rate.load() << "\n"
+                    << prefix << "pauses=" << client->pauses.load() << "\n"
+                    << prefix << "paused=" << client->paused.load() << "\n";
+            }
+            for (const auto& [path, file] : files_) {
+                std::string prefix = "file." + path + ".";
+                out << prefix << "pending_bytes=" << file->pendingBytes() << "\n"
+                    << prefix << "written_bytes=" << file->writtenBytes() << "\n"
+                    << prefix << "writes=" << file->writes() << "\n";
+            }
+            return out.str();
+        }
+
+        const Options& options_;
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        int drained_fd_ = -1;    // Signalled by AppFile writers
+        bool recheck_paused_ = false;
+        uint64_t next_id_ = 1;
+
+        std::vector<char> buffers_;
+        iovec iovecs_[kBatchMessages];
+        mmsghdr messages_[kBatchMessages];
+
+        std::mutex mutex_;   // Guards clients_ and files_ against the control thread
+        std::map<uint64_t, std::shared_ptr<Client>> clients_;
+        std::map<std::string, std::unique_ptr<AppFile>> files_;
+        std::vector<std::shared_ptr<Client>> paused_;   // Event loop only
+        std::atomic<size_t> paused_count_{0};
+
+        std::unique_ptr<ControlServer> control_;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::signal(SIGPIPE, SIG_IGN);
+        Collector collector(options);
+        collector.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Crc32c.hpp"
+#include "FrameRecovery.hpp"
+#include "LogImage.hpp"
+
+// Scans a framed log for torn or corrupt regions and optionally repairs it.
+// Striped logs are verified through their manifest.
+//
+// Exit codes: 0 = log is clean, 2 = corruption found (and reported), 1 = error.
+
+namespace {
+    struct Options {
+        std::string path;
+        std::string output_path;
+        unsigned threads = 0;
+        bool truncate = false;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <logfile_or_manifest> [options]\n";
+        std::cout << "  --threads=N      Scanner threads (default: hardware concurrency)\n";
+        std::cout << "  --truncate       Truncate the log at the first corrupt byte\n";
+        std::cout << "  --output=PATH    Write all valid frames to PATH, skipping corrupt regions\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--threads=", 0) == 0) {
+                options.threads = static_cast<unsigned>(std::stoul(arg.substr(10)));
+            } else if (arg == "--truncate") {
+                options.truncate = true;
+            } else if (arg.rfind("--output=", 0) == 0) {
+                options.output_path = arg.substr(9);
+            } else if (!arg.empty() && arg[0] != '-' && options.path.empty()) {
+                options.path = arg;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.path.empty()) {
+            throw std::invalid_argument("missing logfile_path");
+        }
+        return options;
+    }
+
+    void write_all(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                throw std::runtime_error("Error writing recovered log");
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void print_report(const RecoveryReport& report) {
+        std::cout << "Scanned " << report.scanned_bytes << " bytes in " << report.chunks
+                  << " chunk(s) (crc32c: " << (Crc32c::isHardwareAccelerated() ? "sse4.2" : "software")
+                  << ")\n";
+        std::cout << "Valid frames: " << report.frames.size() << " (" << report.valid_bytes << " bytes)";
+        if (!report.frames.empty()) {
+            std::cout << ", sequences " << report.frames.front().sequence
+                      << ".." << report.frames.back().sequence;
+        }
+        std::cout << "\n";
+
+        for (size_t i = 0; i < report.lost.size(); ++i) {
+            const auto& region = report.lost[i];
+            std::cout << "Lost region " << i + 1 << ": bytes [" << region.offset << ", "
+                      << region.offset + region.length << ") " << region.length << " bytes, ";
+            if (region.sequence_known) {
+                std::cout << "sequences " << region.first_sequence << ".." << region.last_sequence
+                          << " missing\n";
+            } else if (region.offset + region.length == report.scanned_bytes && !report.frames.empty()) {
+                std::cout << "torn tail after sequence " << report.frames.back().sequence << "\n";
+            } else {
+                std::cout << "sequence range unknown\n";
+            }
+        }
+        std::cout << "Lost: " << report.lost_bytes << " bytes in " << report.lost.size() << " region(s)\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+
+        LogImage image(options.path);
+        if (options.truncate && (image.striped() || image.ring())) {
+            throw std::invalid_argument("--truncate is only supported for plain log files; use --output");
+        }
+        const char* data = image.data();
+        size_t size = image.size();
+
+        RecoveryReport report = FrameRecovery(options.threads).scan(data, size);
+        uint64_t overwritten = image.ring() ? FrameRecovery::dropOverwrittenHead(report) : 0;
+        print_report(report);
+        if (overwritten > 0) {
+            std::cout << "Ring: skipped " << overwritten << " overwritten bytes before the oldest frame\n";
+        }
+
+        if (!options.output_path.empty()) {
+            int out = ::open(options.output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out < 0) {
+                throw std::runtime_error("Error opening output file: " + options.output_path);
+            }
+            for (const auto& frame : report.frames) {
+                write_all(out, data + frame.offset, frame.size);
+            }
+            ::fsync(out);
+            ::close(out);
+            std::cout << "Wrote " << report.frames.size() << " valid frame(s) to "
+                      << options.output_path << "\n";
+        }
+
+        if (options.truncate && !report.lost.empty()) {
+            uint64_t cut = image.start() + report.lost.front().offset;
+            size_t dropped = 0;
+            for (const auto& frame : report.frames) {
+                dropped += frame.offset >= cut;
+            }
+            int fd = ::open(options.path.c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(cut)) != 0 || ::fsync(fd) != 0) {
+                throw std::runtime_error("Error truncating log file: " + options.path);
+            }
+            ::close(fd);
+            std::cout << "Truncated " << options.path << " to " << cut << " bytes";
+            if (dropped > 0) {
+                std::cout << " (discarded " << dropped << " valid frame(s) after the corruption)";
+            }
+            std::cout << "\n";
+        }
+
+        return report.lost.empty() ? 0 : 2;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
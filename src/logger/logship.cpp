@@ -0,0 +1,398 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "CollectorProtocol.hpp"
+#include "LineScan.hpp"
+#include "LogFollower.hpp"
+
+// Follows log files and forwards their lines to a local collector.
+//
+// Each file is followed by inode and offset, so rotation and hotswap do not
+// lose or repeat data. Lines go out in Batch messages of whole lines; the
+// collector acks them and the acked positions are checkpointed to a state
+// file with fsync + rename, so after a crash or restart shipping resumes at
+// the last acked batch (at-least-once delivery).
+
+namespace {
+    struct Options {
+        std::vector<std::string> paths;
+        std::string collector;
+        std::string app;
+        std::string state;
+        size_t buffer_bytes = 1u << 20;
+        size_t window = 64;
+        int poll_ms = 5000;
+        int checkpoint_ms = 1000;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " --collector=SOCKET <logfile>... [options]\n";
+        std::cout << "  --collector=PATH    Collector socket (SOCK_SEQPACKET)\n";
+        std::cout << "  --app=NAME          Application name sent to the collector (default: first file's name)\n";
+        std::cout << "  --state=FILE        Checkpoint file (default: <first logfile>.ship)\n";
+        std::cout << "  --buffer-kb=N       Read buffer per file (default: 1024)\n";
+        std::cout << "  --window=N          Batches in flight before waiting for acks (default: 64)\n";
+        std::cout << "  --poll-ms=N         Rescan idle files at least this often; inotify wakes it sooner (default: 5000)\n";
+        std::cout << "  --checkpoint-ms=N   Save acked positions this often (default: 1000)\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--collector") {
+                options.collector = value;
+            } else if (name == "--app") {
+                options.app = value;
+            } else if (name == "--state") {
+                options.state = value;
+            } else if (name == "--buffer-kb") {
+                options.buffer_bytes = std::stoull(value) << 10;
+            } else if (name == "--window") {
+                options.window = std::stoull(value);
+            } else if (name == "--poll-ms") {
+                options.poll_ms = std::stoi(value);
+            } else if (name == "--checkpoint-ms") {
+                options.checkpoint_ms = std::stoi(value);
+            } else if (!arg.empty() && arg[0] != '-') {
+                options.paths.push_back(arg);
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.paths.empty() || options.collector.empty()) {
+            throw std::invalid_argument("need --collector and at least one logfile");
+        }
+        if (options.buffer_bytes < CollectorProtocol::kMaxMessageBytes || options.window == 0) {
+            throw std::invalid_argument("--buffer-kb must be at least 64 and --window at least 1");
+        }
+        if (options.app.empty()) {
+            auto slash = options.paths[0].rfind('/');
+            options.app = slash == std::string::npos ? options.paths[0] : options.paths[0].substr(slash + 1);
+        }
+        if (options.state.empty()) {
+            options.state = options.paths[0] + ".ship";
+        }
+        return options;
+    }
+
+    std::atomic<bool> running{true};
+
+    void handle_signal(int) {
+        running = false;
+    }
+
+    // One followed file and the position the collector has confirmed
+    struct Source {
+        std::unique_ptr<LogFollower> follower;
+        FollowPosition acked;
+    };
+
+    // A batch sent but not acked yet, and where its source stands after it
+    struct InFlight {
+        uint64_t sequence;
+        size_t source;
+        FollowPosition after;
+    };
+
+    // State file: one "device inode offset path" line per source. The path
+    // goes last and runs to the end of the line, so it may hold spaces.
+    std::vector<FollowPosition> loadCheckpoint(const std::string& state,
+                                               const std::vector<std::string>& paths) {
+        std::vector<FollowPosition> positions(paths.size());
+        std::ifstream in(state);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string path;
+            FollowPosition position;
+            if (!(fields >> position.device >> position.inode >> position.offset) || fields.get() != ' ' ||
+                    !std::getline(fields, path)) {
+                continue;
+            }
+            for (size_t i = 0; i < paths.size(); ++i) {
+                if (paths[i] == path) {
+                    positions[i] = position;
+                }
+            }
+        }
+        return positions;
+    }
+
+    void saveCheckpoint(const std::string& state, const std::vector<Source>& sources) {
+        std::ostringstream out;
+        for (const auto& source : sources) {
+            out << source.acked.device << " " << source.acked.inode << " " << source.acked.offset << " "
+                << source.follower->path() << "\n";
+        }
+        std::string text = out.str();
+
+        // Durable replace: the new state is on disk before it takes the name
+        std::string temp = state + ".tmp";
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Error writing state file " + temp + ": " + std::strerror(errno));
+        }
+        bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size()) &&
+                  ::fsync(fd) == 0;
+        ::close(fd);
+        if (!ok || ::rename(temp.c_str(), state.c_str()) != 0) {
+            throw std::runtime_error("Error writing state file " + state + ": " + std::strerror(errno));
+        }
+        auto slash = state.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : state.substr(0, slash + 1);
+        int dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+
+    class Shipper {
+    public:
+        explicit Shipper(const Options& options) : options_(options) {
+            std::vector<FollowPosition> positions = loadCheckpoint(options.state, options.paths);
+            for (size_t i = 0; i < options.paths.size(); ++i) {
+                Source source;
+                source.follower = std::make_unique<LogFollower>(options.paths[i], options.buffer_bytes);
+                source.follower->seek(positions[i]);
+                source.acked = positions[i].inode != 0 ? source.follower->position() : FollowPosition{};
+                sources_.push_back(std::move(source));
+            }
+        }
+
+        ~Shipper() {
+            disconnect();
+        }
+
+        void run() {
+            auto last_checkpoint = std::chrono::steady_clock::now();
+            while (running) {
+                if (fd_ < 0 && !connect()) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+
+                bool sent = false;
+                for (size_t i = 0; i < sources_.size() && fd_ >= 0; ++i) {
+                    while (in_flight_.size() < options_.window && fd_ >= 0 && sendBatch(i)) {
+                        sent = true;
+                        if (pace_us_ > 0) {
+                            std::this_thread::sleep_for(std::chrono::microseconds(pace_us_));
+                        }
+                    }
+                }
+                if (fd_ >= 0) {
+                    // Nothing to send, or the window is full: wait for acks
+                    bool window_full = in_flight_.size() >= options_.window;
+                    if (!sent || window_full) {
+                        waitReadable(window_full ? 100 : options_.poll_ms, !window_full);
+                    }
+                    receive();
+                }
+
+                auto now = std::chrono::steady_clock::now();
+                if (dirty_ && now - last_checkpoint >= std::chrono::milliseconds(options_.checkpoint_ms)) {
+                    saveCheckpoint(options_.state, sources_);
+                    dirty_ = false;
+                    last_checkpoint = now;
+                }
+            }
+
+            // Give outstanding batches a moment to be acked before the last save
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (fd_ >= 0 && !in_flight_.empty() && std::chrono::steady_clock::now() < deadline) {
+                waitReadable(100, false);
+                receive();
+            }
+            if (dirty_) {
+                saveCheckpoint(options_.state, sources_);
+            }
+            std::cout << "Shipped " << lines_ << " lines (" << bytes_ << " bytes) in " << batches_
+                      << " batches; " << reconnects_ << " reconnects, line scan: "
+                      << LineScan::implementation() << "\n";
+        }
+
+    private:
+        bool connect() {
+            try {
+                fd_ = CollectorProtocol::connect(options_.collector);
+            } catch (const std::exception& e) {
+                if (!warned_) {
+                    std::cerr << "Warning: " << e.what() << "; retrying\n";
+                    warned_ = true;
+                }
+                return false;
+            }
+            warned_ = false;
+            CollectorProtocol::encode(message_, CollectorProtocol::MessageType::Hello, 0, options_.app);
+            if (!CollectorProtocol::send(fd_, message_)) {
+                disconnect();
+                return false;
+            }
+
+            // Whatever was in flight on the old connection goes again
+            for (auto& source : sources_) {
+                source.follower->seek(source.acked);
+            }
+            in_flight_.clear();
+            next_sequence_ = 1;
+            pace_us_ = 0;
+            reconnects_ += connected_ ? 1 : 0;
+            connected_ = true;
+            return true;
+        }
+
+        void disconnect() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        // Send the next batch of whole lines of one source; false if there
+        // is nothing to send yet
+        bool sendBatch(size_t index) {
+            Source& source = sources_[index];
+            LogFollower::Chunk chunk = source.follower->peek();
+            const std::string& name = source.follower->path();
+            size_t capacity = CollectorProtocol::batchCapacity(name);
+            std::string_view data = chunk.data.substr(0, capacity);
+            if (data.empty()) {
+                return false;
+            }
+
+            LineScan::Result scan = LineScan::scan(data.data(), data.size());
+            size_t take = scan.end;
+            if (take == 0) {
+                // A line longer than a batch goes out in pieces; the
+                // unterminated end of a rotated file goes out as it is
+                if (data.size() == capacity || (chunk.final && data.size() == chunk.data.size())) {
+                    take = data.size();
+                } else {
+                    return false;
+                }
+            } else if (chunk.final && data.size() == chunk.data.size()) {
+                take = data.size();
+            }
+
+            CollectorProtocol::encodeBatch(message_, next_sequence_, name, data.substr(0, take));
+            if (!CollectorProtocol::send(fd_, message_)) {
+                std::cerr << "Warning: lost the collector connection; reconnecting\n";
+                disconnect();
+                return false;
+            }
+            source.follower->consume(take);
+            in_flight_.push_back(InFlight{next_sequence_++, index, source.follower->position()});
+            ++batches_;
+            bytes_ += take;
+            lines_ += scan.lines;
+            return true;
+        }
+
+        // Wait for the collector, and with watch_files for changes to the
+        // followed files
+        void waitReadable(int timeout_ms, bool watch_files) {
+            std::vector<pollfd> ready{pollfd{fd_, POLLIN, 0}};
+            auto timeout = std::chrono::milliseconds(timeout_ms);
+            if (watch_files) {
+                for (const auto& source : sources_) {
+                    ready.push_back(pollfd{source.follower->watchFd(), POLLIN, 0});
+                    timeout = source.follower->pollTimeout(timeout);
+                }
+            }
+            if (::poll(ready.data(), ready.size(), static_cast<int>(timeout.count())) <= 0) {
+                return;
+            }
+            for (size_t i = 1; i < ready.size(); ++i) {
+                if (ready[i].revents & POLLIN) {
+                    sources_[i - 1].follower->handleEvents();
+                }
+            }
+        }
+
+        // Apply acks and pacing requests that have arrived
+        void receive() {
+            char buffer[CollectorProtocol::kMaxMessageBytes];
+            while (fd_ >= 0) {
+                ssize_t got = ::recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+                if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                    return;
+                }
+                if (got <= 0) {
+                    std::cerr << "Warning: the collector closed the connection; reconnecting\n";
+                    disconnect();
+                    return;
+                }
+                CollectorProtocol::Message message;
+                if (!CollectorProtocol::decode(buffer, static_cast<size_t>(got), message)) {
+                    continue;
+                }
+                if (message.type == CollectorProtocol::MessageType::Ack) {
+                    while (!in_flight_.empty() && in_flight_.front().sequence <= message.sequence) {
+                        sources_[in_flight_.front().source].acked = in_flight_.front().after;
+                        in_flight_.pop_front();
+                        dirty_ = true;
+                    }
+                } else if (message.type == CollectorProtocol::MessageType::Pace) {
+                    pace_us_ = message.sequence;
+                }
+            }
+        }
+
+        const Options& options_;
+        std::vector<Source> sources_;
+        std::deque<InFlight> in_flight_;
+        std::string message_;
+        int fd_ = -1;
+        uint64_t next_sequence_ = 1;
+        uint64_t pace_us_ = 0;
+        bool dirty_ = false;
+        bool warned_ = false;
+        bool connected_ = false;
+
+        uint64_t batches_ = 0;
+        uint64_t bytes_ = 0;
+        uint64_t lines_ = 0;
+        uint64_t reconnects_ = 0;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        Shipper shipper(options);
+        shipper.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
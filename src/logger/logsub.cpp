@@ -0,0 +1,147 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include "LiveRing.hpp"
+
+// Live subscriber: prints the batches a logger started with --live=NAME
+// writes, straight from its shared-memory ring instead of the log file.
+//
+// The subscriber never slows the logger down. If it falls a whole ring
+// behind, the batches it missed are reported on stderr and it carries on
+// with the oldest one still in the ring. When the logger exits or upgrades
+// its binary, the subscriber attaches to the next ring under the same name.
+
+namespace {
+    struct Options {
+        std::string ring;
+        std::string name = "logsub";
+        std::string grep;
+        bool from_oldest = false;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <ring> [options]\n";
+        std::cout << "  --grep=TEXT         Only lines containing TEXT\n";
+        std::cout << "  --name=NAME         Subscriber name shown in the logger's stats (default: logsub)\n";
+        std::cout << "  --from-oldest       Start with the oldest batch in the ring instead of the next one\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--grep") {
+                options.grep = value;
+            } else if (name == "--name") {
+                options.name = value;
+            } else if (name == "--from-oldest") {
+                options.from_oldest = true;
+            } else if (!arg.empty() && arg[0] != '-' && options.ring.empty()) {
+                options.ring = arg;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.ring.empty()) {
+            throw std::invalid_argument("missing ring name");
+        }
+        return options;
+    }
+
+    std::atomic<bool> running{true};
+
+    void handle_signal(int) {
+        running = false;
+    }
+
+    bool writeOut(std::string_view data) {
+        while (!data.empty()) {
+            ssize_t wrote = ::write(STDOUT_FILENO, data.data(), data.size());
+            if (wrote < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(wrote));
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        LiveCursor::Filter filter;
+        if (!options.grep.empty()) {
+            filter = [text = options.grep](std::string_view line) {
+                return line.find(text) != std::string_view::npos;
+            };
+        }
+
+        std::unique_ptr<LiveCursor> cursor;
+        bool waiting_reported = false;
+        bool from_oldest = options.from_oldest;
+        uint64_t skipped = 0;
+        std::string batch;
+        while (running) {
+            if (!cursor) {
+                try {
+                    cursor = std::make_unique<LiveCursor>(options.ring, options.name, filter, from_oldest);
+                    skipped = 0;
+                    waiting_reported = false;
+                    from_oldest = true;   // A later ring is read from its start
+                } catch (const std::exception& e) {
+                    if (!waiting_reported) {
+                        std::cerr << "logsub: " << e.what() << "; waiting for it\n";
+                        waiting_reported = true;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                    continue;
+                }
+            }
+
+            if (cursor->next(batch)) {
+                if (!writeOut(batch)) {
+                    break;
+                }
+            } else if (cursor->closed()) {
+                cursor.reset();
+                continue;
+            } else {
+                cursor->wait(std::chrono::seconds(1));
+            }
+            if (cursor->skippedBytes() != skipped) {
+                std::cerr << "logsub: fell behind, skipped " << cursor->skippedBytes() - skipped << " bytes\n";
+                skipped = cursor->skippedBytes();
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LogFollower.hpp"
+#include "LogIndex.hpp"
+
+// "tail -F" for hotswapped and rotated logs.
+//
+// The file is followed by inode through LogFollower, which sleeps on inotify
+// rather than polling: a write, truncation, rename or new file under the
+// name wakes it at once, so an idle tail costs no CPU. After a hotswap or
+// rotation the old file is read to its end before the new one, so nothing
+// written around the switch is missed. New data goes to stdout in chunks of
+// up to the read buffer.
+
+namespace {
+    struct Options {
+        std::string path;
+        size_t lines = 10;
+        bool from_start = false;
+        size_t buffer_bytes = 1u << 20;
+    };
+
+    void print_usage(const std::string& program_name) {
+        std::cout << "Usage: " << program_name << " <logfile> [options]\n";
+        std::cout << "  --lines=N           Print the last N lines before following (default: 10)\n";
+        std::cout << "  --from-start        Print the whole file before following\n";
+        std::cout << "  --buffer-kb=N       Read buffer (default: 1024)\n";
+    }
+
+    Options parse_args(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string name = arg.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--lines") {
+                options.lines = std::stoull(value);
+            } else if (name == "--from-start") {
+                options.from_start = true;
+            } else if (name == "--buffer-kb") {
+                options.buffer_bytes = std::stoull(value) << 10;
+            } else if (!arg.empty() && arg[0] != '-' && options.path.empty()) {
+                options.path = arg;
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (options.path.empty()) {
+            throw std::invalid_argument("missing logfile");
+        }
+        if (options.buffer_bytes == 0) {
+            throw std::invalid_argument("--buffer-kb must be at least 1");
+        }
+        return options;
+    }
+
+    std::atomic<bool> running{true};
+
+    void handle_signal(int) {
+        running = false;
+    }
+
+    // Where the last lines of the file begin (empty position if it is missing).
+    // The file is scanned by file offset; positions add what retention has
+    // collapsed off its head.
+    FollowPosition tailStart(const std::string& path, size_t lines) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return {};
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return {};
+        }
+        auto index = LogIndex::read(path);
+        uint64_t collapsed = index ? index->collapsed : 0;
+        FollowPosition position{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino),
+                                static_cast<uint64_t>(st.st_size) + collapsed};
+        if (lines == 0) {
+            ::close(fd);
+            return position;
+        }
+
+        // The last lines start after the lines-th newline from the end, not
+        // counting one that ends the file
+        std::vector<char> block(64 * 1024);
+        uint64_t end = static_cast<uint64_t>(st.st_size);
+        size_t seen = 0;
+        bool skip_last = true;
+        while (end > 0) {
+            size_t size = static_cast<size_t>(std::min<uint64_t>(end, block.size()));
+            ssize_t got = ::pread(fd, block.data(), size, static_cast<off_t>(end - size));
+            if (got != static_cast<ssize_t>(size)) {
+                break;
+            }
+            for (size_t i = size; i-- > 0;) {
+                if (block[i] != '\n') {
+                    skip_last = false;
+                    continue;
+                }
+                if (skip_last) {
+                    skip_last = false;
+                    continue;
+                }
+                if (++seen == lines) {
+                    position.offset = collapsed + end - size + i + 1;
+                    ::close(fd);
+                    return position;
+                }
+            }
+            end -= size;
+        }
+        ::close(fd);
+        position.offset = collapsed;   // Fewer lines than asked for
+        return position;
+    }
+
+    // Write all of data to stdout; false once stdout is gone
+    bool writeOut(std::string_view data) {
+        while (!data.empty()) {
+            ssize_t wrote = ::write(STDOUT_FILENO, data.data(), data.size());
+            if (wrote < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(wrote));
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Options options = parse_args(argc, argv);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        LogFollower follower(options.path, options.buffer_bytes);
+        follower.seek(options.from_start ? FollowPosition{} : tailStart(options.path, options.lines));
+        uint64_t rotations = 0;
+        uint64_t truncations = 0;
+        while (running) {
+            LogFollower::Chunk chunk = follower.peek();
+            if (follower.rotations() != rotations) {
+                rotations = follower.rotations();
+                std::cerr << "logtail: " << options.path << " was replaced; following the new file\n";
+            }
+            if (follower.truncations() != truncations) {
+                truncations = follower.truncations();
+                std::cerr << "logtail: " << options.path << " was truncated\n";
+            }
+            if (chunk.data.empty()) {
+                follower.wait(std::chrono::seconds(60));
+                continue;
+            }
+            if (!writeOut(chunk.data)) {
+                break;
+            }
+            follower.consume(chunk.data.size());
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,29 +1,271 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <exception>
+#include <stdexcept>
+#include <unistd.h>
 #include "LoggerApp.hpp"
 
 void print_usage(const std::string& program_name) {
-    std::cout << "Usage: " << program_name << " <logfile_path> <thread_count> <sleep_ms>\n";
+    std::cout << "Usage: " << program_name << " <logfile_path> <thread_count> <sleep_ms> [options]\n";
     std::cout << "  logfile_path: Path to the log file\n";
-    std::cout << "  thread_count: Number of threads to create\n";
+    std::cout << "  thread_count: Number of threads to create (0 with --exec: only log the children)\n";
     std::cout << "  sleep_ms: Milliseconds to sleep between log entries\n";
+    std::cout << "Options:\n";
+    std::cout << "  --thread-stack-kb=N          Stack size of each producer thread, 0 = system default (default: 256)\n";
+    std::cout << "  --spawn-threads=N            Threads creating the producers in parallel (default: auto)\n";
+    std::cout << "  --framing=none|record|block  Checksum each record or each writer batch (default: none)\n";
+    std::cout << "  --stripe=DIR1,DIR2,...       Stripe the log across directories; logfile_path becomes the manifest\n";
+    std::cout << "  --stripe-block-kb=N          Stripe block size (default: 1024)\n";
+    std::cout << "  --mirror=PATH1,...           Keep identical copies of the log in these files too\n";
+    std::cout << "  --mirror-quorum=N            Copies that must be synced for durability (default: all)\n";
+    std::cout << "  --mirror-lag-kb=N            Detach and resync a copy lagging this far (default: 16384)\n";
+    std::cout << "  --file-io=write|vmsplice     Write a plain log file with write(2) or vmsplice+splice (default: write)\n";
+    std::cout << "  --collector=SOCKET           Send the log to a logcollect daemon; logfile_path is the fallback\n";
+    std::cout << "  --collector-app=NAME         Application name at the collector (default: log file name)\n";
+    std::cout << "  --ring-kb=N                  Fixed-size circular log file of N KiB (implies --framing=record)\n";
+    std::cout << "  --retain-mb=N                Free the head of the log in place beyond N MiB\n";
+    std::cout << "  --retain-sec=N               Free the head of the log in place once older than N seconds\n";
+    std::cout << "  --retain-mode=punch|collapse Punch holes, or collapse the range if supported (default: punch)\n";
+    std::cout << "  --dirty-max-kb=N             Keep at most N KiB of the log dirty in the page cache\n";
+    std::cout << "  --spill=DIR                  Spill to DIR while the log file fails or is slow, then backfill\n";
+    std::cout << "  --spill-latency-ms=N         Write latency that triggers spilling, 0 = errors only (default: 1000)\n";
+    std::cout << "  --segment-kb=N               Queue segment size (default: 64)\n";
+    std::cout << "  --queue-max-kb=N             Memory cap per thread queue (default: 4096)\n";
+    std::cout << "  --memory-max-kb=N            Memory cap for all queues (default: 65536, or 2 segments per queue)\n";
+    std::cout << "  --idle-release-ms=N          Return idle queue memory to the OS after N ms (default: 5000)\n";
+    std::cout << "  --drain-quantum-kb=N         Bytes each producer may drain per round, 0 = each queue in full (default: 16)\n";
+    std::cout << "  --weights=W0,W1,...          Drain weight of each producer thread (default: 1)\n";
+    std::cout << "  --lazy[=N]                   Write the first N records directly and start the writer thread and\n"
+              << "                               queue memory only after them (default N: 100)\n";
+    std::cout << "  --overflow=drop|block        Full queue behaviour (default: drop)\n";
+    std::cout << "  --block-timeout-ms=N         Longest wait with --overflow=block (default: 100)\n";
+    std::cout << "  --io-rate-kb=N               Writer bandwidth limit in KiB/s (default: unlimited)\n";
+    std::cout << "  --io-iops=N                  Writer write() calls per second limit (default: unlimited)\n";
+    std::cout << "  --io-cgroup[=PERCENT]        Default limits to PERCENT of the cgroup io.max (default: 100)\n";
+    std::cout << "  --exec=COMMAND               Run COMMAND under /bin/sh and log its stdout and stderr (repeatable)\n";
+    std::cout << "  --channel=NAME:PATH[,...]    Route channel NAME to its own file; settings flush-ms=N, rotate-mb=N,\n"
+              << "                               keep=N (default: 5) and sync (repeatable)\n";
+    std::cout << "  --route=SOURCE:NAME          Tag the records of threads, stdout or stderr (of --exec children)\n"
+              << "                               with channel NAME\n";
+    std::cout << "  --live=NAME                  Publish written batches to shared memory /NAME for live subscribers\n";
+    std::cout << "  --live-kb=N                  Size of the live ring (default: 16384)\n";
+    std::cout << "  --control=PATH               Control socket for stats and runtime settings\n";
+}
+
+// Parse a non-negative integer option value
+size_t parse_size(const std::string& name, const std::string& value) {
+    size_t used = 0;
+    long long parsed = std::stoll(value, &used);
+    if (used != value.size() || parsed < 0) {
+        throw std::invalid_argument(name + " must be a non-negative integer");
+    }
+    return static_cast<size_t>(parsed);
+}
+
+// Split a comma separated option value, skipping empty items
+std::vector<std::string> parse_list(const std::string& value) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        std::string item = value.substr(start, comma - start);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return items;
+}
+
+// Parse "NAME:PATH[,flush-ms=N][,rotate-mb=N][,keep=N][,sync]"
+ChannelConfig parse_channel(const std::string& value) {
+    auto colon = value.find(':');
+    if (colon == std::string::npos || colon == 0) {
+        throw std::invalid_argument("--channel needs NAME:PATH");
+    }
+    std::vector<std::string> items = parse_list(value.substr(colon + 1));
+    if (items.empty()) {
+        throw std::invalid_argument("--channel needs NAME:PATH");
+    }
+    ChannelConfig channel;
+    channel.name = value.substr(0, colon);
+    channel.path = items[0];
+    for (size_t i = 1; i < items.size(); ++i) {
+        auto eq = items[i].find('=');
+        std::string key = items[i].substr(0, eq);
+        std::string setting = eq == std::string::npos ? "" : items[i].substr(eq + 1);
+        if (key == "flush-ms") {
+            channel.flush_ms = static_cast<int>(parse_size(key, setting));
+        } else if (key == "rotate-mb") {
+            channel.rotate_bytes = parse_size(key, setting) << 20;
+        } else if (key == "keep") {
+            channel.keep = static_cast<int>(parse_size(key, setting));
+        } else if (key == "sync" && eq == std::string::npos) {
+            channel.sync = true;
+        } else {
+            throw std::invalid_argument("unknown channel setting: " + items[i]);
+        }
+    }
+    return channel;
+}
+
+// Apply one "--name=value" option to the configuration
+void parse_option(const std::string& arg, LoggerConfig& config) {
+    auto eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (name == "--thread-stack-kb") {
+        config.thread_stack_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--spawn-threads") {
+        config.spawn_threads = parse_size(name, value);
+    } else if (name == "--framing") {
+        config.framing = RecordFrame::parseMode(value);
+    } else if (name == "--stripe") {
+        config.stripe_dirs = parse_list(value);
+    } else if (name == "--stripe-block-kb") {
+        config.stripe_block_bytes = parse_size(name, value) * 1024;
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        if (config.stripe_block_bytes == 0 || config.stripe_block_bytes % page != 0) {
+            throw std::invalid_argument("--stripe-block-kb must be a non-zero multiple of " +
+                                        std::to_string(page / 1024));
+        }
+    } else if (name == "--mirror") {
+        config.mirror_paths = parse_list(value);
+    } else if (name == "--mirror-quorum") {
+        config.mirror_quorum = parse_size(name, value);
+    } else if (name == "--mirror-lag-kb") {
+        config.mirror_max_lag_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--file-io") {
+        if (value == "write") {
+            config.file_io = FileIo::Write;
+        } else if (value == "vmsplice") {
+            config.file_io = FileIo::Vmsplice;
+        } else {
+            throw std::invalid_argument("unknown file I/O mode: " + value);
+        }
+    } else if (name == "--collector") {
+        config.collector_path = value;
+    } else if (name == "--collector-app") {
+        config.collector_app = value;
+    } else if (name == "--ring-kb") {
+        config.ring_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--retain-mb") {
+        config.retain_bytes = parse_size(name, value) << 20;
+    } else if (name == "--retain-sec") {
+        config.retain_sec = parse_size(name, value);
+    } else if (name == "--retain-mode") {
+        if (value == "punch") {
+            config.retain_collapse = false;
+        } else if (value == "collapse") {
+            config.retain_collapse = true;
+        } else {
+            throw std::invalid_argument("unknown retention mode: " + value);
+        }
+    } else if (name == "--dirty-max-kb") {
+        config.dirty_max_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--spill") {
+        config.spill_dir = value;
+    } else if (name == "--spill-latency-ms") {
+        config.spill_latency_ms = static_cast<int>(parse_size(name, value));
+    } else if (name == "--segment-kb") {
+        config.segment_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--queue-max-kb") {
+        config.queue_max_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--memory-max-kb") {
+        config.memory_max_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--idle-release-ms") {
+        config.idle_release_ms = static_cast<int>(parse_size(name, value));
+    } else if (name == "--drain-quantum-kb") {
+        config.drain_quantum_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--weights") {
+        config.thread_weights.clear();
+        for (const std::string& item : parse_list(value)) {
+            size_t weight = parse_size(name, item);
+            if (weight == 0 || weight > 1000) {
+                throw std::invalid_argument("--weights must be between 1 and 1000");
+            }
+            config.thread_weights.push_back(static_cast<uint32_t>(weight));
+        }
+    } else if (name == "--lazy") {
+        config.lazy_records = value.empty() ? 100 : parse_size(name, value);
+    } else if (name == "--overflow") {
+        if (value == "drop") {
+            config.overflow = OverflowPolicy::Drop;
+        } else if (value == "block") {
+            config.overflow = OverflowPolicy::Block;
+        } else {
+            throw std::invalid_argument("unknown overflow policy: " + value);
+        }
+    } else if (name == "--block-timeout-ms") {
+        config.block_timeout_ms = static_cast<int>(parse_size(name, value));
+    } else if (name == "--io-rate-kb") {
+        config.io_bytes_per_sec = parse_size(name, value) * 1024;
+    } else if (name == "--io-iops") {
+        config.io_iops = parse_size(name, value);
+    } else if (name == "--io-cgroup") {
+        config.io_from_cgroup = true;
+        if (!value.empty()) {
+            config.io_cgroup_percent = static_cast<int>(parse_size(name, value));
+        }
+    } else if (name == "--exec") {
+        if (value.empty()) {
+            throw std::invalid_argument("--exec needs a command");
+        }
+        config.exec_commands.push_back(value);
+    } else if (name == "--channel") {
+        config.channels.push_back(parse_channel(value));
+    } else if (name == "--route") {
+        auto colon = value.find(':');
+        std::string source = value.substr(0, colon);
+        std::string channel = colon == std::string::npos ? "" : value.substr(colon + 1);
+        if (source == "threads") {
+            config.threads_channel = channel;
+        } else if (source == "stdout") {
+            config.stdout_channel = channel;
+        } else if (source == "stderr") {
+            config.stderr_channel = channel;
+        } else {
+            throw std::invalid_argument("--route takes threads, stdout or stderr: " + value);
+        }
+    } else if (name == "--live") {
+        config.live_name = value;
+    } else if (name == "--live-kb") {
+        config.live_bytes = parse_size(name, value) * 1024;
+    } else if (name == "--control") {
+        config.control_path = value;
+    } else {
+        throw std::invalid_argument("unknown option: " + arg);
+    }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
+    if (argc < 4) {
         print_usage(argv[0]);
         return 1;
     }
 
     try {
         // Parse command line arguments
-        std::string logfile_path = argv[1];
-        int thread_count = std::stoi(argv[2]);
-        int sleep_ms = std::stoi(argv[3]);
+        LoggerConfig config;
+        config.logfile_path = argv[1];
+        config.thread_count = std::stoi(argv[2]);
+        config.sleep_ms = std::stoi(argv[3]);
+        config.command_line.assign(argv, argv + argc);
+        for (int i = 4; i < argc; ++i) {
+            parse_option(argv[i], config);
+        }
+        // Readers find the oldest record in a ring by its frame
+        if (config.ring_bytes > 0 && config.framing == FramingMode::None) {
+            config.framing = FramingMode::Record;
+        }
         
         // Run the application
-        LoggerApp app(logfile_path, thread_count, sleep_ms);
+        LoggerApp app(config);
         app.run();
     }
     catch (const std::exception& e) {
@@ -32,4 +274,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
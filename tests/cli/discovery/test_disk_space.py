@@ -0,0 +1,130 @@
+"""
+Tests for the DiskSpaceDiscovery plugin.
+"""
+from unittest.mock import MagicMock, patch
+
+from src.cli.discovery.disk_space import DiskSpaceDiscovery
+
+GB = 1 << 30
+MB = 1 << 20
+
+
+class FakeSystem:
+    """Just enough of ConfigSystem for the plugin."""
+
+    def __init__(self, name, properties):
+        self.name = name
+        self.endpoint = MagicMock(hostname="localhost")
+        self.tags = set()
+        self.roles = {}
+        self.properties = dict(properties)
+
+    def add_tag(self, tag):
+        self.tags.add(tag)
+
+    def remove_tag(self, tag):
+        self.tags.discard(tag)
+
+    def add_role(self, name, description=None):
+        self.roles[name] = MagicMock()
+        return self.roles[name]
+
+    def remove_role(self, name):
+        self.roles.pop(name, None)
+
+    def add_property(self, key, value):
+        self.properties[key] = value
+
+    def get_property(self, key, default=None):
+        return self.properties.get(key, default)
+
+
+def make_store(system, settings=None):
+    settings = settings or {}
+    store = MagicMock()
+    store.list_systems.return_value = [system]
+    store.get_global_setting.side_effect = lambda key, default=None: settings.get(key, default)
+    return store
+
+
+def mount(path, total, avail):
+    return {"mount": path, "total": total, "used": total - avail, "avail": avail}
+
+
+def logger(pid, path, rate):
+    return {"pid": pid, "log_path": path, "files": [path], "write_bytes_per_sec": rate}
+
+
+class TestDiskSpaceDiscovery:
+    """Test suite for DiskSpaceDiscovery."""
+
+    def test_depends_on_logger_rates(self):
+        assert "logger_processes" in DiskSpaceDiscovery().get_dependencies()
+
+    def test_forecast_and_relocation_plan(self):
+        # /var fills in 10 GB / 2.25 MB/s, about 75 minutes; /data has room
+        system = FakeSystem("web1", {
+            "mount_points": ["/var", "/data", "/backup"],
+            "nfs_mounts": ["/backup"],
+            "loggers": [logger(1, "/var/log/hot.log", 2 * MB), logger(2, "/var/log/cold.log", MB // 4)],
+        })
+        usage = {
+            "/var": mount("/var", 100 * GB, 10 * GB),
+            "/data": mount("/data", 500 * GB, 400 * GB),
+            "/backup": mount("/backup", 1000 * GB, 1000 * GB),
+            "/var/log/hot.log": mount("/var", 100 * GB, 10 * GB),
+            "/var/log/cold.log": mount("/var", 100 * GB, 10 * GB),
+        }
+        with patch.object(DiskSpaceDiscovery, "probe", return_value=usage):
+            results = DiskSpaceDiscovery().discover(make_store(system))
+
+        var = system.properties["disk_usage"]["/var"]
+        assert var["log_write_bytes_per_sec"] == 2.25 * MB
+        assert var["seconds_to_full"] == 10 * GB / (2.25 * MB)
+        assert system.properties["disk_usage"]["/data"]["seconds_to_full"] is None
+        assert "disk_filling" in system.tags
+        assert results["filling_mounts_found"] == 1
+
+        # Only the hottest file has to move, and not to the NFS mount
+        moves = system.properties["disk_forecast"]
+        assert len(moves) == 1
+        assert moves[0]["pid"] == 1
+        assert moves[0]["to_mount"] == "/data"
+        assert moves[0]["to"] == "/data/hotswap-logs/hot.log"
+        assert moves[0]["command"] == "hotswap --pid 1 --from /var/log/hot.log --to /data/hotswap-logs/hot.log"
+        system.roles["log_relocation_needed"].add_property.assert_called_once_with("moves", moves)
+
+    def test_no_move_without_headroom(self):
+        system = FakeSystem("web1", {
+            "mount_points": ["/var", "/data"],
+            "loggers": [logger(1, "/var/log/hot.log", 2 * MB)],
+        })
+        usage = {
+            "/var": mount("/var", 100 * GB, GB),
+            "/data": mount("/data", 100 * GB, GB),
+            "/var/log/hot.log": mount("/var", 100 * GB, GB),
+        }
+        with patch.object(DiskSpaceDiscovery, "probe", return_value=usage):
+            DiskSpaceDiscovery().discover(make_store(system))
+        assert "disk_filling" in system.tags
+        assert system.properties["disk_forecast"] == []
+        assert "log_relocation_needed" not in system.roles
+
+    def test_auto_hotswap_runs_the_plan(self):
+        system = FakeSystem("web1", {
+            "mount_points": ["/var", "/data"],
+            "loggers": [logger(7, "/var/log/app.log", 2 * MB)],
+        })
+        usage = {
+            "/var": mount("/var", 100 * GB, GB),
+            "/data": mount("/data", 500 * GB, 400 * GB),
+            "/var/log/app.log": mount("/var", 100 * GB, GB),
+        }
+        settings = {"disk_forecast_auto_hotswap": True, "hotswap_command": "/opt/bin/hotswap"}
+        with patch.object(DiskSpaceDiscovery, "probe", return_value=usage), \
+             patch("src.cli.discovery.disk_space.run_command", return_value="done\n") as run:
+            results = DiskSpaceDiscovery().discover(make_store(system, settings))
+        run.assert_called_once_with(system, ["/opt/bin/hotswap", "--pid", "7", "--from", "/var/log/app.log",
+                                             "--to", "/data/hotswap-logs/app.log"])
+        assert results["relocations_triggered"] == 1
+        assert system.properties["disk_forecast"][0]["output"] == "done"
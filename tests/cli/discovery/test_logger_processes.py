@@ -0,0 +1,105 @@
+"""
+Tests for the LoggerProcessesDiscovery plugin.
+"""
+import pytest
+from unittest.mock import MagicMock, patch
+
+from src.cli.discovery.base import DiscoveryError
+from src.cli.discovery.logger_processes import LoggerProcessesDiscovery
+
+
+class FakeSystem:
+    """Just enough of ConfigSystem for the plugin."""
+
+    def __init__(self, name, hostname="localhost"):
+        self.name = name
+        self.endpoint = MagicMock(hostname=hostname)
+        self.tags = set()
+        self.roles = {}
+        self.properties = {}
+
+    def add_tag(self, tag):
+        self.tags.add(tag)
+
+    def remove_tag(self, tag):
+        self.tags.discard(tag)
+
+    def add_role(self, name, description=None):
+        self.roles[name] = MagicMock()
+        return self.roles[name]
+
+    def remove_role(self, name):
+        self.roles.pop(name, None)
+
+    def add_property(self, key, value):
+        self.properties[key] = value
+
+    def is_connected(self):
+        return False
+
+
+def make_store(system, settings=None):
+    settings = settings or {}
+    store = MagicMock()
+    store.list_systems.return_value = [system]
+    store.get_global_setting.side_effect = lambda key, default=None: settings.get(key, default)
+    return store
+
+
+def logger(pid, rate, **stats):
+    entry = {"pid": pid, "name": "ThreadedLogger", "log_path": f"/var/log/app{pid}.log",
+             "files": [f"/var/log/app{pid}.log"], "write_bytes_per_sec": rate}
+    entry.update(stats)
+    return entry
+
+
+class TestLoggerProcessesDiscovery:
+    """Test suite for LoggerProcessesDiscovery."""
+
+    def test_metadata(self):
+        plugin = LoggerProcessesDiscovery()
+        assert plugin.get_name() == "logger_processes"
+        assert plugin.get_tags_added() == {"log_hot", "log_backpressured"}
+        assert plugin.get_roles_added() == {"hotswap_target"}
+
+    def test_tags_hot_and_backpressured_loggers(self):
+        system = FakeSystem("web1")
+        loggers = [logger(1, 10), logger(2, 4 << 20), logger(3, 10, dropped_per_sec=5.0)]
+        with patch.object(LoggerProcessesDiscovery, "probe", return_value=loggers):
+            results = LoggerProcessesDiscovery().discover(make_store(system))
+
+        assert results["loggers_found"] == 3
+        assert results["hot_loggers"] == 1
+        assert results["backpressured_loggers"] == 1
+        assert system.tags == {"log_hot", "log_backpressured"}
+        assert [entry["pid"] for entry in system.properties["loggers"]] == [2, 1, 3]
+        system.roles["hotswap_target"].add_property.assert_called_once_with(
+            "files", ["/var/log/app2.log", "/var/log/app3.log"])
+
+    def test_thresholds_come_from_global_settings(self):
+        system = FakeSystem("web1")
+        loggers = [logger(1, 2048, queue_growth_bytes=4096)]
+        settings = {"log_hot_bytes_per_sec": 1024, "log_backpressure_queue_bytes": 4096}
+        with patch.object(LoggerProcessesDiscovery, "probe", return_value=loggers):
+            LoggerProcessesDiscovery().discover(make_store(system, settings))
+        assert system.tags == {"log_hot", "log_backpressured"}
+
+    def test_stale_tags_are_cleared(self):
+        system = FakeSystem("web1")
+        system.tags = {"log_hot", "other"}
+        system.roles["hotswap_target"] = MagicMock()
+        with patch.object(LoggerProcessesDiscovery, "probe", return_value=[logger(1, 10)]):
+            LoggerProcessesDiscovery().discover(make_store(system))
+        assert system.tags == {"other"}
+        assert "hotswap_target" not in system.roles
+
+    def test_unusable_probe_output_is_reported(self):
+        system = FakeSystem("db1", hostname="db1.example.com")
+        agent = MagicMock()
+        agent.execute.return_value = "Executed: python3 -c ..."
+        system.connect = MagicMock(return_value=agent)
+        results = LoggerProcessesDiscovery().discover(make_store(system))
+        assert results["systems_updated"] == 0
+        assert results["errors"][0]["system"] == "db1"
+        with pytest.raises(DiscoveryError):
+            LoggerProcessesDiscovery().probe(system, 0.1)
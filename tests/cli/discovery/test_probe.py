@@ -0,0 +1,88 @@
+"""
+Tests for the probe helpers the discovery plugins share.
+"""
+import socket
+import sys
+
+import pytest
+from unittest.mock import MagicMock, patch
+
+from src.cli.discovery import probe
+from src.cli.discovery.base import DiscoveryError
+
+
+class FakeSystem:
+    """Just enough of ConfigSystem for the helpers."""
+
+    def __init__(self, hostname="localhost", connected=False):
+        self.endpoint = MagicMock(hostname=hostname)
+        self.connected = connected
+        self.agent = MagicMock()
+        self.endpoint.agent = self.agent
+
+    def is_connected(self):
+        return self.connected
+
+    def connect(self):
+        self.connected = True
+        return self.agent
+
+
+class TestIsLocal:
+    """Test suite for is_local."""
+
+    @pytest.mark.parametrize("hostname", ["localhost", "127.0.0.1", "::1"])
+    def test_loopback_names(self, hostname):
+        assert probe.is_local(FakeSystem(hostname))
+
+    def test_own_hostname(self):
+        assert probe.is_local(FakeSystem(socket.gethostname()))
+
+    def test_other_host(self):
+        assert not probe.is_local(FakeSystem("db7.example.com"))
+
+
+class TestRunCommand:
+    """Test suite for run_command."""
+
+    def test_local_command_runs_directly(self):
+        system = FakeSystem()
+        output = probe.run_command(system, [sys.executable, "-c", "print('hi there')"])
+        assert output == "hi there\n"
+        system.agent.execute.assert_not_called()
+
+    def test_remote_command_connects_and_quotes(self):
+        system = FakeSystem("db7.example.com")
+        system.agent.execute.return_value = "out"
+        output = probe.run_command(system, ["ls", "-l", "/var/log/my app"])
+        assert output == "out"
+        assert system.connected
+        system.agent.execute.assert_called_once_with("ls -l '/var/log/my app'")
+
+    def test_remote_command_reuses_the_connection(self):
+        system = FakeSystem("db7.example.com", connected=True)
+        with patch.object(system, "connect") as connect:
+            probe.run_command(system, ["true"])
+        connect.assert_not_called()
+        system.agent.execute.assert_called_once_with("true")
+
+
+class TestRunProbe:
+    """Test suite for run_probe."""
+
+    def test_local_probe_returns_the_json(self):
+        script = "import json, sys; print(json.dumps({'args': sys.argv[1:]}))"
+        assert probe.run_probe(FakeSystem(), script, ["a", "b c"]) == {"args": ["a", "b c"]}
+
+    def test_remote_probe_uses_python3(self):
+        system = FakeSystem("db7.example.com")
+        system.agent.execute.return_value = "[1, 2]"
+        assert probe.run_probe(system, "print([1, 2])", ["x"]) == [1, 2]
+        system.agent.execute.assert_called_once_with("python3 -c 'print([1, 2])' x")
+
+    @pytest.mark.parametrize("output", ["", "Traceback (most recent call last):", None])
+    def test_missing_output_raises(self, output):
+        system = FakeSystem("db7.example.com")
+        system.agent.execute.return_value = output
+        with pytest.raises(DiscoveryError, match="db7.example.com"):
+            probe.run_probe(system, "pass", [])
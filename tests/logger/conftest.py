@@ -0,0 +1,34 @@
+"""
+Shared fixtures for the logger binaries; build them first with make in src/logger.
+"""
+import os
+import signal
+import subprocess
+import time
+
+import pytest
+
+BIN_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../../bin"))
+
+
+@pytest.fixture
+def binary():
+    """Path of a built logger binary; skips the test if it is missing."""
+    def find(name):
+        path = os.path.join(BIN_DIR, name)
+        if not os.access(path, os.X_OK):
+            pytest.skip(f"{name} is not built (run make in src/logger)")
+        return path
+    return find
+
+
+@pytest.fixture
+def run_for():
+    """Run a command, interrupt it after some seconds as Ctrl+C would, and return (exit code, output)."""
+    def run(args, seconds, **kwargs):
+        process = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, **kwargs)
+        time.sleep(seconds)
+        process.send_signal(signal.SIGINT)
+        output, _ = process.communicate(timeout=30)
+        return process.returncode, output
+    return run
@@ -0,0 +1,89 @@
+"""
+Tests for a logger sending its log to logcollect.
+"""
+import fcntl
+import os
+import signal
+import socket
+import subprocess
+import threading
+import time
+
+
+def control(path, command):
+    with socket.socket(socket.AF_UNIX) as client:
+        client.connect(str(path))
+        client.sendall(command.encode() + b"\n")
+        client.shutdown(socket.SHUT_WR)
+        return client.makefile().read()
+
+
+def wait_for(path, timeout=5):
+    deadline = time.monotonic() + timeout
+    while not os.path.exists(path):
+        assert time.monotonic() < deadline, f"{path} never appeared"
+        time.sleep(0.05)
+
+
+class TestCollector:
+    """Backpressure from the collector is waited out, not failed over."""
+
+    def test_long_pause_keeps_the_log_at_the_collector(self, binary, tmp_path):
+        # The application file is a FIFO, so not reading it stalls the
+        # collector's writes and it pauses the logger for as long as we like
+        out = tmp_path / "out"
+        out.mkdir()
+        app_file = out / "app.log"
+        os.mkfifo(app_file)
+        reader = os.open(app_file, os.O_RDONLY | os.O_NONBLOCK)
+        fcntl.fcntl(reader, fcntl.F_SETPIPE_SZ, 4096)
+        sock = tmp_path / "c.sock"
+        collector_control = tmp_path / "ctl.sock"
+        fallback = tmp_path / "local.log"
+
+        collector = subprocess.Popen([binary("logcollect"), str(sock), f"--dir={out}", "--high-water-kb=16",
+                                      "--low-water-kb=4", f"--control={collector_control}"],
+                                     stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        logger = None
+        try:
+            wait_for(sock)
+            wait_for(collector_control)
+            logger = subprocess.Popen([binary("ThreadedLogger"), str(fallback), "2", "0", f"--collector={sock}",
+                                       "--collector-app=app"],
+                                      stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+            # Long enough to fill the socket and then outlast the sink's
+            # five second timeout
+            time.sleep(12)
+            assert "paused=1" in control(collector_control, "stats")
+            assert logger.poll() is None
+
+            stop = threading.Event()
+
+            def drain():
+                while not stop.is_set():
+                    try:
+                        if not os.read(reader, 1 << 16):
+                            time.sleep(0.01)
+                    except BlockingIOError:
+                        time.sleep(0.01)
+
+            drainer = threading.Thread(target=drain)
+            drainer.start()
+            try:
+                time.sleep(1)
+                logger.send_signal(signal.SIGINT)
+                output, _ = logger.communicate(timeout=30)
+            finally:
+                stop.set()
+                drainer.join()
+        finally:
+            if logger and logger.poll() is None:
+                logger.kill()
+            collector.send_signal(signal.SIGINT)
+            collector.wait(timeout=30)
+            os.close(reader)
+
+        assert logger.returncode == 0, output
+        assert "connection lost" not in output
+        assert not fallback.exists() or fallback.stat().st_size == 0
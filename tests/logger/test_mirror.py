@@ -0,0 +1,43 @@
+"""
+Tests for mirrored logs recovering after every replica failed at once.
+"""
+import os
+import resource
+import signal
+import subprocess
+import time
+
+
+def ignore_file_size_signal():
+    # Writes past RLIMIT_FSIZE then fail with EFBIG instead of killing the logger
+    signal.signal(signal.SIGXFSZ, signal.SIG_IGN)
+
+
+class TestMirror:
+    """Replicas rejoin from the retained backlog when none is left to copy from."""
+
+    def test_all_replicas_fail_and_recover(self, binary, tmp_path):
+        primary = tmp_path / "a.log"
+        mirror = tmp_path / "b.log"
+        process = subprocess.Popen([binary("ThreadedLogger"), str(primary), "4", "10", f"--mirror={mirror}"],
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True,
+                                   preexec_fn=ignore_file_size_signal)
+        try:
+            time.sleep(1)
+            # Both files stop growing at the same size: every replica fails
+            limit = os.path.getsize(primary) + 4096
+            resource.prlimit(process.pid, resource.RLIMIT_FSIZE, (limit, resource.RLIM_INFINITY))
+            time.sleep(2.5)
+            assert os.path.getsize(primary) <= limit
+            assert os.path.getsize(mirror) <= limit
+
+            resource.prlimit(process.pid, resource.RLIMIT_FSIZE, (resource.RLIM_INFINITY, resource.RLIM_INFINITY))
+            time.sleep(3)
+        finally:
+            process.send_signal(signal.SIGINT)
+            output, _ = process.communicate(timeout=30)
+
+        assert process.returncode == 0, output
+        assert "caught up" in output
+        assert os.path.getsize(primary) > limit
+        assert primary.read_bytes() == mirror.read_bytes()
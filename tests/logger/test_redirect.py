@@ -0,0 +1,43 @@
+"""
+Tests for redirecting the log to a pipe whose reader goes away.
+"""
+import os
+import signal
+import socket
+import subprocess
+import time
+
+
+def control(path, command):
+    with socket.socket(socket.AF_UNIX) as client:
+        client.connect(str(path))
+        client.sendall(command.encode() + b"\n")
+        client.shutdown(socket.SHUT_WR)
+        return client.makefile().read()
+
+
+class TestRedirect:
+    """Every thread that writes a redirected log survives SIGPIPE."""
+
+    def test_lazy_producers_fall_back_when_the_reader_leaves(self, binary, tmp_path):
+        fifo = tmp_path / "f"
+        os.mkfifo(fifo)
+        sock = tmp_path / "c.sock"
+        # Lazy mode: the producers write the log themselves
+        process = subprocess.Popen([binary("ThreadedLogger"), str(tmp_path / "t.log"), "16", "1",
+                                    "--lazy=1000000", f"--control={sock}"],
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        try:
+            time.sleep(0.5)
+            reader = os.open(fifo, os.O_RDONLY | os.O_NONBLOCK)
+            assert "ok" in control(sock, f"redirect fifo {fifo}")
+            time.sleep(0.5)
+            os.close(reader)
+            time.sleep(1)
+            assert process.poll() is None
+        finally:
+            process.send_signal(signal.SIGINT)
+            output, _ = process.communicate(timeout=30)
+
+        assert process.returncode == 0, output
+        assert "back to" in output
@@ -0,0 +1,52 @@
+"""
+Tests for following a log whose head retention collapses.
+"""
+import re
+import signal
+import subprocess
+import time
+
+import pytest
+
+
+class TestCollapseRetention:
+    """Followers rebase on the index instead of reading the log again."""
+
+    def test_logtail_reads_every_line_once(self, binary, tmp_path):
+        log = tmp_path / "t.log"
+        logger = subprocess.Popen([binary("ThreadedLogger"), str(log), "500", "0", "--retain-mb=1",
+                                   "--retain-mode=collapse"],
+                                  stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        tail = None
+        try:
+            time.sleep(0.3)
+            with open(tmp_path / "tail.txt", "w") as out:
+                tail = subprocess.Popen([binary("logtail"), str(log), "--from-start"], stdout=out,
+                                        stderr=subprocess.DEVNULL)
+                time.sleep(8)
+                logger.send_signal(signal.SIGINT)
+                output, _ = logger.communicate(timeout=60)
+                time.sleep(1)
+        finally:
+            if logger.poll() is None:
+                logger.kill()
+            if tail:
+                tail.terminate()
+                tail.wait(timeout=10)
+
+        if "Collapse range not supported" in output:
+            pytest.skip("the filesystem cannot collapse ranges")
+        written = int(re.search(r"Wrote \d+ records \((\d+) bytes\)", output).group(1))
+        assert log.stat().st_size < written, "nothing was collapsed"
+
+        # Each thread's counters arrive in order, without gaps or repeats
+        lines = (tmp_path / "tail.txt").read_text().splitlines()
+        assert sum(len(line) + 1 for line in lines) == written
+        last = {}
+        for line in lines:
+            match = re.match(r"Thread (\d+): .* counter (\d+)$", line)
+            if match:
+                thread, counter = int(match.group(1)), int(match.group(2))
+                assert counter == last.get(thread, -1) + 1, line
+                last[thread] = counter
+        assert last
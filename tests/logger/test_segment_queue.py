@@ -0,0 +1,31 @@
+"""
+Tests for queue memory with more producer threads than the pool has segments.
+"""
+import re
+
+
+def written_and_dropped(output):
+    match = re.search(r"Wrote (\d+) records .*dropped (\d+)", output)
+    assert match, output
+    return int(match.group(1)), int(match.group(2))
+
+
+class TestSegmentQueue:
+    """Queues take their first segment on the first push, not when created."""
+
+    def test_more_queues_than_an_explicit_cap_holds(self, binary, run_for, tmp_path):
+        # 256 KiB of 64 KiB segments is four segments for sixteen queues
+        code, output = run_for([binary("ThreadedLogger"), str(tmp_path / "t.log"), "16", "100",
+                                "--segment-kb=64", "--memory-max-kb=256"], 1.5)
+        assert code == 0, output
+        assert "cap reached" not in output
+        assert "terminated gracefully" in output
+
+    def test_default_cap_grows_with_the_thread_count(self, binary, run_for, tmp_path):
+        # The default 64 MiB holds only 64 one-MiB segments
+        code, output = run_for([binary("ThreadedLogger"), str(tmp_path / "t.log"), "100", "100",
+                                "--segment-kb=1024"], 1.5)
+        assert code == 0, output
+        written, dropped = written_and_dropped(output)
+        assert written > 0
+        assert dropped == 0
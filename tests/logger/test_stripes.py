@@ -0,0 +1,39 @@
+"""
+Tests for resuming a striped log.
+"""
+import re
+import subprocess
+
+
+def written_bytes(output):
+    return int(re.search(r"Wrote \d+ records \((\d+) bytes\)", output).group(1))
+
+
+class TestStripedResume:
+    """A torn stripe is cut back so no stale blocks reappear."""
+
+    def test_resume_from_torn_stripe(self, binary, run_for, tmp_path):
+        dirs = [tmp_path / "a", tmp_path / "b"]
+        for d in dirs:
+            d.mkdir()
+        log = tmp_path / "app.log"
+        stripe_args = ["--stripe=" + ",".join(map(str, dirs)), "--stripe-block-kb=4"]
+
+        code, output = run_for([binary("ThreadedLogger"), str(log), "200", "0"] + stripe_args, 1)
+        assert code == 0, output
+        stripe0, stripe1 = dirs[0] / "app.log.stripe0", dirs[1] / "app.log.stripe1"
+        assert stripe0.stat().st_size > 64 * 1024
+
+        # Tear the second block; the first stripe still holds later blocks
+        with open(stripe1, "r+b") as f:
+            f.truncate(100)
+        kept = 4096 + 100
+
+        code, output = run_for([binary("ThreadedLogger"), str(log), "4", "0"] + stripe_args, 1)
+        assert code == 0, output
+        resumed = written_bytes(output)
+        assert 0 < resumed < 64 * 1024
+
+        merged = subprocess.run([binary("logcat"), str(log)], capture_output=True, check=True).stdout
+        assert len(merged) == kept + resumed
+        assert stripe0.stat().st_size + stripe1.stat().st_size == len(merged)
@@ -0,0 +1,78 @@
+"""
+Tests for the "upgrade" control command.
+"""
+import re
+import signal
+import socket
+import subprocess
+import time
+
+
+def control(path, command):
+    with socket.socket(socket.AF_UNIX) as client:
+        client.connect(str(path))
+        client.sendall(command.encode() + b"\n")
+        client.shutdown(socket.SHUT_WR)
+        return client.makefile().read()
+
+
+def check_counters(log):
+    """Each thread counts up by one; producers started again begin at 0."""
+    last = {}
+    for line in log.read_text().splitlines():
+        match = re.match(r"Thread (\d+): .* counter (\d+)$", line)
+        if not match:
+            continue
+        thread, counter = int(match.group(1)), int(match.group(2))
+        assert counter == 0 or counter == last.get(thread, -1) + 1, line
+        last[thread] = counter
+    assert last
+
+
+class TestUpgrade:
+    """A failed exec() leaves the logger running and loses no records."""
+
+    def test_failed_exec_replays_the_queued_records(self, binary, tmp_path):
+        bad = tmp_path / "not-a-binary"
+        bad.write_bytes(b"\0\1\2\3")
+        bad.chmod(0o755)
+        log = tmp_path / "t.log"
+        sock = tmp_path / "c.sock"
+        process = subprocess.Popen([binary("ThreadedLogger"), str(log), "8", "1", f"--control={sock}"],
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        try:
+            time.sleep(1)
+            reply = control(sock, f"upgrade {bad}")
+            assert reply.startswith("error: exec of"), reply
+            time.sleep(1)
+            assert process.poll() is None
+            assert "ok" in control(sock, "stats")
+            size = log.stat().st_size
+            time.sleep(1)
+            assert log.stat().st_size > size
+        finally:
+            process.send_signal(signal.SIGINT)
+            output, _ = process.communicate(timeout=30)
+
+        assert process.returncode == 0, output
+        assert "Resumed after failed upgrade" in output
+        check_counters(log)
+
+    def test_upgrade_to_the_same_binary(self, binary, tmp_path):
+        log = tmp_path / "t.log"
+        sock = tmp_path / "c.sock"
+        process = subprocess.Popen([binary("ThreadedLogger"), str(log), "8", "1", f"--control={sock}"],
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        try:
+            time.sleep(1)
+            # The connection closes once the new binary has taken over
+            assert control(sock, "upgrade") == ""
+            time.sleep(1)
+            assert "ok" in control(sock, "stats")
+        finally:
+            process.send_signal(signal.SIGINT)
+            output, _ = process.communicate(timeout=30)
+
+        assert process.returncode == 0, output
+        assert "Resumed after upgrade" in output
+        check_counters(log)
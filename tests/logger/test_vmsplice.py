@@ -0,0 +1,54 @@
+"""
+Tests for the vmsplice log file, which is written without O_APPEND.
+"""
+import re
+import signal
+import subprocess
+import time
+
+
+def written_records(output):
+    return int(re.search(r"Wrote (\d+) records", output).group(1))
+
+
+class TestVmsplice:
+    """The spliced log file has no second writer overwriting it."""
+
+    def test_second_splicing_logger_is_refused(self, binary, tmp_path):
+        log = tmp_path / "t.log"
+        first = subprocess.Popen([binary("ThreadedLogger"), str(log), "4", "10", "--file-io=vmsplice"],
+                                 stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        try:
+            time.sleep(0.5)
+            second = subprocess.run([binary("ThreadedLogger"), str(log), "4", "10", "--file-io=vmsplice"],
+                                    capture_output=True, text=True, timeout=30)
+            assert second.returncode != 0
+            assert "already splices into" in second.stdout + second.stderr
+        finally:
+            first.send_signal(signal.SIGINT)
+            first.communicate(timeout=30)
+        assert first.returncode == 0
+
+    def test_appending_writer_is_not_overwritten(self, binary, tmp_path):
+        log = tmp_path / "t.log"
+        spliced = subprocess.Popen([binary("ThreadedLogger"), str(log), "4", "10", "--file-io=vmsplice"],
+                                   stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        appended = None
+        try:
+            time.sleep(0.5)
+            appended = subprocess.Popen([binary("ThreadedLogger"), str(log), "4", "10"],
+                                        stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+            time.sleep(1)
+        finally:
+            outputs = []
+            for process in (appended, spliced):
+                if process:
+                    process.send_signal(signal.SIGINT)
+                    outputs.append(process.communicate(timeout=30)[0])
+
+        assert "switching from splice to O_APPEND writes" in outputs[1]
+        records = sum(written_records(output) for output in outputs)
+        lines = log.read_text().splitlines()
+        assert len(lines) == records
+        record = re.compile(r"Thread \d+: (\[[-\d :]+\] Has counter \d+|Shutting down gracefully\.)")
+        assert all(record.fullmatch(line) for line in lines)